@@ -46,12 +46,17 @@ THE SOFTWARE.
 #include "ProceduralShapeGenerators.h"
 #include "ProceduralMultiShape.h"
 #include "ProceduralMultiShapeGenerators.h"
+#include "ProceduralShapeClipper.h"
+#include "ProceduralShapeOffsetter.h"
+#include "ProceduralPolylineSimplifier.h"
+#include "ProceduralPolylineResampler.h"
 #include "ProceduralPath.h"
 #include "ProceduralPathGenerators.h"
 #include "ProceduralTriangulator.h"
 #include "ProceduralTriangleBuffer.h"
 #include "ProceduralTrack.h"
 #include "ProceduralBoolean.h"
+#include "ProceduralCSGTree.h"
 #include "ProceduralSpringGenerator.h"
 #include "ProceduralSVG.h"
 #include "ProceduralDebugRendering.h"
@@ -0,0 +1,168 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#ifndef PROCEDURAL_CSG_TREE_INCLUDED
+#define PROCEDURAL_CSG_TREE_INCLUDED
+
+#include "ProceduralPlatform.h"
+#include "ProceduralMeshGenerator.h"
+#include "ProceduralTriangleBuffer.h"
+#include "ProceduralBoolean.h"
+
+namespace Procedural
+{
+/**
+ * Builds a mesh out of a tree of boolean operations (constructive solid geometry).
+ * Leaves are meshes, coming either from a TriangleBuffer or a mesh generator, and interior nodes are unions, intersections or differences.
+ * Nodes can have any number of operands : n-ary unions and intersections are evaluated as balanced trees,
+ * and a difference is evaluated as its first operand minus the union of the others.
+ * Independent subtrees are evaluated in parallel when the library is built with OpenMP.
+ *
+ * Intermediate results are cached by subtree hash, so that editing one leaf only recomputes its ancestors on the next build.
+ * <code>
+ * CSGTree tree;
+ * int wall = tree.addLeaf(BoxGenerator().setSize(Ogre::Vector3(10,5,1)));
+ * int window1 = tree.addLeaf(BoxGenerator().setSize(Ogre::Vector3(1,1,2)).setPosition(-2,0,0));
+ * int window2 = tree.addLeaf(BoxGenerator().setSize(Ogre::Vector3(1,1,2)).setPosition(2,0,0));
+ * std::vector<int> operands;
+ * operands.push_back(wall); operands.push_back(window1); operands.push_back(window2);
+ * tree.setRoot(tree.addOperation(Boolean::BT_DIFFERENCE, operands));
+ * tree.realizeMesh("wall");
+ * </code>
+ */
+class _ProceduralExport CSGTree : public MeshGenerator<CSGTree>
+{
+	struct Node
+	{
+		bool mIsLeaf;
+		Boolean::BooleanOperation mOperation;
+		std::vector<int> mOperands;
+		TriangleBuffer mMesh;
+		/// Hash of the mesh, for leaves
+		Ogre::uint64 mHash;
+	};
+
+	/// Nodes of the tree, each node's operands are stored before it
+	std::vector<Node> mNodes;
+
+	/// Node whose result is built
+	int mRoot;
+
+	/// Whether intermediate results are kept from one build to the next
+	bool mCacheEnabled;
+
+	/// Intermediate results, indexed by subtree hash
+	mutable std::map<Ogre::uint64, TriangleBuffer> mCache;
+
+	void _checkNode(int node, const char* origin) const;
+
+public:
+	/// Default constructor
+	CSGTree() : mRoot(-1), mCacheEnabled(true) {}
+
+	/// Adds a leaf holding a copy of the given mesh
+	/// @return the id of the new node
+	int addLeaf(const TriangleBuffer& mesh);
+
+	/// Adds a leaf holding the mesh built by the given generator
+	/// @return the id of the new node
+	template <class T>
+	int addLeaf(const MeshGenerator<T>& generator)
+	{
+		return addLeaf(generator.buildTriangleBuffer());
+	}
+
+	/// Adds a boolean operation between two existing nodes
+	/// @return the id of the new node
+	/// @exception Ogre::InvalidParametersException Operand is not a node of this tree
+	int addOperation(Boolean::BooleanOperation op, int operand1, int operand2);
+
+	/// Adds a boolean operation between any number of existing nodes.
+	/// For a difference, all operands but the first are subtracted from the first one.
+	/// @return the id of the new node
+	/// @exception Ogre::InvalidParametersException Operand list is empty, or an operand is not a node of this tree
+	int addOperation(Boolean::BooleanOperation op, const std::vector<int>& operands);
+
+	/// Replaces the mesh of a leaf. Cached results depending on it will be recomputed on next build.
+	/// @exception Ogre::InvalidParametersException Node is not a leaf of this tree
+	CSGTree& setLeaf(int node, const TriangleBuffer& mesh);
+
+	/// Replaces the mesh of a leaf with the mesh built by the given generator
+	/// @exception Ogre::InvalidParametersException Node is not a leaf of this tree
+	template <class T>
+	CSGTree& setLeaf(int node, const MeshGenerator<T>& generator)
+	{
+		return setLeaf(node, generator.buildTriangleBuffer());
+	}
+
+	/// Changes the operation of an interior node
+	/// @exception Ogre::InvalidParametersException Node is not an operation of this tree
+	CSGTree& setOperation(int node, Boolean::BooleanOperation op);
+
+	/// Sets the node whose result is built
+	/// @exception Ogre::InvalidParametersException Node is not a node of this tree
+	CSGTree& setRoot(int node);
+
+	/// Enables or disables the cache of intermediate results (default=true)
+	CSGTree& setCacheEnabled(bool cacheEnabled)
+	{
+		mCacheEnabled = cacheEnabled;
+		if (!cacheEnabled)
+			mCache.clear();
+		return *this;
+	}
+
+	/// Forgets all cached intermediate results
+	void clearCache() const
+	{
+		mCache.clear();
+	}
+
+	/// Removes all nodes and cached results
+	void clear()
+	{
+		mNodes.clear();
+		mCache.clear();
+		mRoot = -1;
+	}
+
+	/// Gets the number of nodes in the tree
+	size_t getNodeCount() const
+	{
+		return mNodes.size();
+	}
+
+	/**
+	 * Builds the mesh of the root node into a TriangleBuffer.
+	 * Only the results which are not cached yet are computed, and the cache is then trimmed to the results used by the current tree.
+	 * @param buffer The TriangleBuffer on where to append the mesh.
+	 * @exception Ogre::InvalidStateException Root node is not set
+	 */
+	void addToTriangleBuffer(TriangleBuffer& buffer) const;
+};
+}
+#endif
@@ -37,6 +37,30 @@ namespace Procedural
 {
 struct Line;
 //-----------------------------------------------------------------------
+/**
+ * Robust geometric predicates.
+ * Determinants are first evaluated in double precision, and recomputed with exact arithmetic only when
+ * the rounding error bound doesn't guarantee their sign : the sign of the result is always exact.
+ */
+class _ProceduralExport Predicates
+{
+public:
+	/// Returns a positive value if a, b and c are in counter-clockwise order, a negative value if they are clockwise, and 0 if they are collinear.
+	/// The magnitude is twice the signed area of the triangle.
+	static double orient2D(const Ogre::Vector2& a, const Ogre::Vector2& b, const Ogre::Vector2& c);
+
+	/// Returns a positive value if d is on the side of plane abc where the normal (b-a)x(c-a) points, a negative value on the other side, and 0 if it's on the plane.
+	/// The magnitude is six times the signed volume of the tetrahedron.
+	static double orient3D(const Ogre::Vector3& a, const Ogre::Vector3& b, const Ogre::Vector3& c, const Ogre::Vector3& d);
+
+	/**
+	 * Tells whether d is inside the circumcircle of a, b and c, which must be in counter-clockwise order
+	 * @param magnitude if not null, receives an upper bound of the determinant's absolute value for inputs of that scale
+	 * @return a positive value if d is inside, a negative value if it's outside, and 0 if the 4 points are cocircular
+	 */
+	static double inCircle(const Ogre::Vector2& a, const Ogre::Vector2& b, const Ogre::Vector2& c, const Ogre::Vector2& d, double* magnitude = 0);
+};
+//-----------------------------------------------------------------------
 /// Represents a 2D circle
 class _ProceduralExport Circle
 {
@@ -244,5 +268,263 @@ struct _ProceduralExport IntVector2
 {
 	size_t x, y;
 };
+//-----------------------------------------------------------------------
+/**
+ * Flat open-addressing hash map from 64 bits integer keys to positive int values.
+ * It is meant to be used as a fast replacement for std::map when keys are ids or packed coordinates.
+ */
+class _ProceduralExport IndexHashMap
+{
+	std::vector<Ogre::uint64> mKeys;
+	std::vector<int> mValues;
+	size_t mSize;
+	size_t mMask;
+
+	void _grow();
+
+	static inline size_t _hash(Ogre::uint64 key)
+	{
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		key *= 0xc4ceb9fe1a85ec53ULL;
+		key ^= key >> 33;
+		return (size_t)key;
+	}
+public:
+	/// Contructor with arguments
+	/// @param expectedCount the number of keys that will be inserted, used to pre-size the table
+	IndexHashMap(size_t expectedCount = 0) : mSize(0), mMask(0)
+	{
+		reserve(expectedCount);
+	}
+
+	/// Makes room for at least count keys without rehashing
+	void reserve(size_t count);
+
+	/// Removes all keys
+	void clear()
+	{
+		std::fill(mValues.begin(), mValues.end(), -1);
+		mSize = 0;
+	}
+
+	/// Gets the number of keys stored in the map
+	size_t size() const
+	{
+		return mSize;
+	}
+
+	/// Gets the value associated with that key, or -1 if the key is not in the map
+	int find(Ogre::uint64 key) const
+	{
+		if (mSize == 0)
+			return -1;
+		for (size_t i = _hash(key) & mMask;; i = (i + 1) & mMask)
+		{
+			if (mValues[i] == -1)
+				return -1;
+			if (mKeys[i] == key)
+				return mValues[i];
+		}
+	}
+
+	/**
+	 * Inserts a key/value couple if the key is not already in the map
+	 * @param key the key to insert
+	 * @param value the value to associate with the key (must be positive)
+	 * @return the value associated with the key after the insertion, ie the existing one if the key was already there
+	 */
+	int insert(Ogre::uint64 key, int value);
+
+	/// Associates a value to a key, replacing the existing value if any (value must be positive)
+	void set(Ogre::uint64 key, int value);
+
+	/// Builds a key out of a couple of ids, which doesn't depend on their order
+	static inline Ogre::uint64 pairKey(int i1, int i2)
+	{
+		if (i1 > i2)
+			std::swap(i1, i2);
+		return ((Ogre::uint64)(unsigned int)i1 << 32) | (Ogre::uint64)(unsigned int)i2;
+	}
+};
+//-----------------------------------------------------------------------
+/**
+ * Gives the same integer id to all the points that are closer than a given tolerance.
+ * Points are bucketed in a hash grid, so welding n points runs in O(n), instead of
+ * the O(n log n) needed by a std::map using Vector2Comparator or Vector3Comparator.
+ * @tparam T Ogre::Vector2 or Ogre::Vector3
+ * @tparam DIM the number of coordinates of T
+ */
+template <class T, int DIM>
+class PointWelder
+{
+	Ogre::Real mTolerance;
+	Ogre::Real mInvCellSize;
+	IndexHashMap mCells;
+	std::vector<int> mNext;
+	std::vector<T> mPoints;
+
+	inline int _cellCoord(Ogre::Real v) const
+	{
+		return (int)Ogre::Math::Floor(v * mInvCellSize);
+	}
+
+	static inline Ogre::uint64 _cellKey(const int* cell)
+	{
+		Ogre::uint64 key = 0;
+		for (int k = 0; k < DIM; ++k)
+			key = (key << 21) ^ (Ogre::uint64)(cell[k] & 0x1FFFFF);
+		return key;
+	}
+
+	int _findInCell(const int* cell, const T& p) const
+	{
+		Ogre::Real sqTolerance = mTolerance * mTolerance;
+		for (int id = mCells.find(_cellKey(cell)); id != -1; id = mNext[id])
+			if (mPoints[id].squaredDistance(p) < sqTolerance)
+				return id;
+		return -1;
+	}
+
+public:
+	/// Contructor with arguments
+	/// @param tolerance the distance under which two points are considered equal
+	PointWelder(Ogre::Real tolerance = 1e-3f) : mTolerance(tolerance), mInvCellSize(.5f / tolerance) {}
+
+	/// Pre-sizes the internal tables for a given number of distinct points
+	void reserve(size_t count)
+	{
+		mCells.reserve(count);
+		mNext.reserve(count);
+		mPoints.reserve(count);
+	}
+
+	/// Gets the id of an already welded point within tolerance of p, or -1 if there is none
+	int find(const T& p) const
+	{
+		// Cells are twice as big as the tolerance : only the cell containing p and
+		// its nearest neighbour along each axis may contain a matching point
+		int base[DIM], side[DIM];
+		for (int k = 0; k < DIM; ++k)
+		{
+			Ogre::Real v = p[k] * mInvCellSize;
+			base[k] = (int)Ogre::Math::Floor(v);
+			side[k] = (v - base[k] < .5f) ? -1 : 1;
+		}
+		for (int n = 0; n < (1 << DIM); ++n)
+		{
+			int cell[DIM];
+			for (int k = 0; k < DIM; ++k)
+				cell[k] = base[k] + (((n >> k) & 1) ? side[k] : 0);
+			int id = _findInCell(cell, p);
+			if (id != -1)
+				return id;
+		}
+		return -1;
+	}
+
+	/// Gets the id of p, creating a new one if no point was welded within tolerance yet
+	int weld(const T& p)
+	{
+		int id = find(p);
+		if (id != -1)
+			return id;
+		id = (int)mPoints.size();
+		int cell[DIM];
+		for (int k = 0; k < DIM; ++k)
+			cell[k] = _cellCoord(p[k]);
+		Ogre::uint64 key = _cellKey(cell);
+		int head = mCells.find(key);
+		mNext.push_back(head);
+		mPoints.push_back(p);
+		mCells.set(key, id);
+		return id;
+	}
+
+	/// Gets the position of the first point that was welded with that id
+	const T& getPoint(int id) const
+	{
+		return mPoints[id];
+	}
+
+	/// Gets the number of distinct ids
+	size_t size() const
+	{
+		return mPoints.size();
+	}
+};
+
+typedef PointWelder<Ogre::Vector2, 2> Vector2Welder;
+typedef PointWelder<Ogre::Vector3, 3> Vector3Welder;
+//-----------------------------------------------------------------------
+/**
+ * Uniform grid over a set of 2D segments, to quickly find the segments lying near another segment or a box.
+ * Each segment is registered only in the cells it actually crosses, and cells are sized so that
+ * there is about one of them per segment.
+ */
+class _ProceduralExport SegmentGrid2D
+{
+	Ogre::Vector2 mOrigin;
+	Ogre::Real mCellSize;
+	int mCellsX;
+	int mCellsY;
+	/// Segments of cell c are mCellSegments[mCellStart[c]] to mCellSegments[mCellStart[c+1]-1]
+	std::vector<size_t> mCellStart;
+	std::vector<size_t> mCellSegments;
+	/// Segments added by insert, per cell, only allocated by the first insertion
+	std::vector<std::vector<size_t> > mInsertedSegments;
+
+	int _cellX(Ogre::Real x) const;
+	int _cellY(Ogre::Real y) const;
+	/// Calls functor(cell) for each cell crossed by a segment
+	template <class F>
+	void _forEachCell(const Ogre::Vector2& a, const Ogre::Vector2& b, F& functor) const;
+
+	struct CellCounter;
+	struct CellFiller;
+	struct CellCollector;
+	struct CellInserter;
+public:
+	SegmentGrid2D() : mOrigin(Ogre::Vector2::ZERO), mCellSize(1), mCellsX(0), mCellsY(0) {}
+
+	/// Builds the grid over those segments, which are then referred to by their index
+	void build(const std::vector<Segment2D>& segments);
+
+	/// Builds the grid over those segments, covering the box from boxMin to boxMax, which must contain all of them
+	/// and all the segments that will be inserted later
+	void build(const std::vector<Segment2D>& segments, const Ogre::Vector2& boxMin, const Ogre::Vector2& boxMax);
+
+	/**
+	 * Registers one more segment, which must lie in the box of the grid.
+	 * A segment may be inserted again under the same index once it changed : it then stays in the cells of its
+	 * previous position, which only costs extra results in queries.
+	 */
+	void insert(const Segment2D& segment, size_t index);
+
+	/// Appends to result the indices of the segments sharing a cell with that segment, in increasing order and without duplicates
+	void query(const Segment2D& segment, std::vector<size_t>& result) const;
+
+	/// Appends to result the indices of the segments sharing a cell with that box, in increasing order and without duplicates
+	void query(const Ogre::Vector2& boxMin, const Ogre::Vector2& boxMax, std::vector<size_t>& result) const;
+};
+//-----------------------------------------------------------------------
+/**
+ * Chains a soup of segments into polylines, in linear time.
+ * Segments are given by the ids of their ends, as produced by a PointWelder, and
+ * each chain grows at both ends until no unused segment touches them.
+ */
+class _ProceduralExport SegmentChainer
+{
+public:
+	/**
+	 * Appends to chains the polylines made by the segments, as lists of vertex ids.
+	 * A closed chain ends with the id it starts with.
+	 * @param segmentEnds ids of the ends of the segments, 2 per segment
+	 * @param vertexCount number of distinct ids
+	 * @param chains the list to append the chains to
+	 */
+	static void chain(const std::vector<int>& segmentEnds, size_t vertexCount, std::vector<std::vector<int> >& chains);
+};
 }
 #endif
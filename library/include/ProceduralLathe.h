@@ -50,7 +50,7 @@ class _ProceduralExport Lathe : public MeshGenerator<Lathe>
 	bool mCapped;
 
 	void _latheCapImpl(TriangleBuffer& buffer) const;
-	void _latheBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude) const;
+	void _latheBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude, const std::vector<Ogre::Vector2>& sliceRotations) const;
 
 public:
 	/// Contructor with arguments
@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "OgreRoot.h"
 #include "ProceduralPlatform.h"
 #include "ProceduralTriangleBuffer.h"
+#include "ProceduralUtils.h"
 #include "OgreException.h"
 #include "OgreMesh.h"
 
@@ -86,6 +87,9 @@ protected:
 	// Whether a transform has been defined or not
 	bool mTransform;
 
+	/// Maximum distance allowed between a curved surface and its chords, in world units (0 means segment counts are used as given)
+	Ogre::Real mChordError;
+
 public:
 	/// Default constructor
 	/// \exception Ogre::InvalidStateException Scene Manager is not set in OGRE root object
@@ -98,7 +102,8 @@ public:
 		mOrientation(Ogre::Quaternion::IDENTITY),
 		mScale(1,1,1),
 		mPosition(0,0,0),
-		mTransform(false)
+		mTransform(false),
+		mChordError(0)
 	{
 	}
 
@@ -130,6 +135,29 @@ public:
 		return tbuffer;
 	}
 
+	/**
+	 * Outputs one triangle buffer per level of detail, level 0 being the finest.
+	 * Each level is built with a chord error multiplied by ratio compared to the previous one.
+	 * @param lods the vector to which the levels are appended
+	 * @param chordError the chord error of the finest level, in world units
+	 * @param numLevels the number of levels to build
+	 * @param ratio the factor between the chord errors of two consecutive levels
+	 * \exception Ogre::InvalidParametersException Chord error must be strictly positive and ratio larger than 1
+	 */
+	void buildLodTriangleBuffers(std::vector<TriangleBuffer>& lods, Ogre::Real chordError, unsigned int numLevels, Ogre::Real ratio = 2.f) const
+	{
+		if (chordError <= 0 || ratio <= 1)
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Chord error must be strictly positive and ratio larger than 1", "Procedural::MeshGenerator::buildLodTriangleBuffers(std::vector<TriangleBuffer>&, Ogre::Real, unsigned int, Ogre::Real)");
+		T generator(static_cast<const T&>(*this));
+		lods.reserve(lods.size() + numLevels);
+		for (unsigned int i = 0; i < numLevels; ++i)
+		{
+			generator.setChordError(chordError);
+			lods.push_back(generator.buildTriangleBuffer());
+			chordError *= ratio;
+		}
+	}
+
 	/**
 	 * Overloaded by each generator to implement the specifics
 	 */
@@ -238,6 +266,21 @@ public:
 		return static_cast<T&>(*this);
 	}
 
+	/**
+	 * Sets the maximum distance between curved surfaces and the chords approximating them, in world units (default=0).
+	 * When strictly positive, the segment counts along curved directions are derived from it, taking scale into account,
+	 * instead of being taken from the generator's settings. Each curved direction gets at most 1024 segments.
+	 * Only generators of curved primitives (sphere, torus, cylinder, capsule, cone, rounded box) make use of it.
+	 * \exception Ogre::InvalidParametersException Chord error must be positive
+	 */
+	inline T& setChordError(Ogre::Real chordError)
+	{
+		if (chordError < 0)
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Chord error must be positive", "Procedural::MeshGenerator::setChordError(Ogre::Real)");
+		mChordError = chordError;
+		return static_cast<T&>(*this);
+	}
+
 	/// Resets all transforms (orientation, position and scale) that would have been applied to the mesh to their default values
 	inline T& resetTransforms()
 	{
@@ -249,6 +292,19 @@ public:
 	}
 
 protected:
+	/// Gets the number of segments needed by an arc so that its chords stay within mChordError of it, once scaled.
+	/// @param radius the radius of the arc, before scale
+	/// @param angle the angle covered by the arc
+	/// @param minSeg the minimum number of segments to return
+	/// The count is capped, as surfaces take the square of it and a tiny chord error would otherwise exhaust memory.
+	inline unsigned int _getArcSegmentCount(Ogre::Real radius, Ogre::Radian angle, unsigned int minSeg) const
+	{
+		Ogre::Real scale = 1;
+		if (mTransform)
+			scale = std::max(Ogre::Math::Abs(mScale.x), std::max(Ogre::Math::Abs(mScale.y), Ogre::Math::Abs(mScale.z)));
+		return std::max(minSeg, Utils::computeArcSegmentCount(radius * scale, angle, minSeg, mChordError, Ogre::Radian(Ogre::Math::PI), 1024));
+	}
+
 	/// Adds a new point to a triangle buffer, using the format defined for that MeshGenerator
 	/// @param buffer the triangle buffer to update
 	/// @param position the position of the new point
@@ -275,6 +331,34 @@ protected:
 				buffer.textureCoord(mUVOrigin.x + uv.x*mUTile, mUVOrigin.y+uv.y*mVTile);
 	}
 
+	/// Writes a point into a vertex already allocated in a triangle buffer, exactly as addPoint would have added it.
+	/// As it does not touch the buffer itself, several threads may write distinct vertices at once.
+	/// @param vertex the vertex to write
+	/// @param position the position of the point
+	/// @param normal the normal of the point
+	/// @param uv the uv texcoord of the point
+	inline void setPoint(TriangleBuffer::Vertex& vertex, const Ogre::Vector3& position, const Ogre::Vector3& normal, const Ogre::Vector2& uv) const
+	{
+		if (mTransform)
+			vertex.mPosition = mPosition + mOrientation * (mScale * position);
+		else
+			vertex.mPosition = position;
+		if (mEnableNormals)
+		{
+			if (mTransform)
+				vertex.mNormal = mOrientation * normal;
+			else
+				vertex.mNormal = normal;
+		}
+		if (mNumTexCoordSet > 0)
+		{
+			if (mSwitchUV)
+				vertex.mUV = Ogre::Vector2(mUVOrigin.x + uv.y*mUTile, mUVOrigin.y+uv.x*mVTile);
+			else
+				vertex.mUV = Ogre::Vector2(mUVOrigin.x + uv.x*mUTile, mUVOrigin.y+uv.y*mVTile);
+		}
+	}
+
 };
 //
 }
@@ -29,6 +29,7 @@ THE SOFTWARE.
 #define PROCEDURAL_MULTISHAPE_INCLUDED
 
 #include "ProceduralGeometryHelpers.h"
+#include "ProceduralPolylineSimplifier.h"
 
 namespace Procedural
 {
@@ -131,6 +132,104 @@ public:
 
 	void buildFromSegmentSoup(const std::vector<Segment2D>& segList);
 
+	/**
+	 * Computes the union between this multishape and another one, using the non-zero fill rule.
+	 * All shapes must be closed. Overlapping shapes of the same multishape are merged together.
+	 * @see ShapeClipper
+	 * @exception Ogre::InvalidParametersException All shapes must be closed
+	 */
+	MultiShape booleanUnion(const MultiShape& other) const;
+
+	/**
+	 * Computes the intersection between this multishape and another one, using the non-zero fill rule.
+	 * All shapes must be closed.
+	 * @see ShapeClipper
+	 * @exception Ogre::InvalidParametersException All shapes must be closed
+	 */
+	MultiShape booleanIntersect(const MultiShape& other) const;
+
+	/**
+	 * Computes the difference between this multishape and another one, using the non-zero fill rule.
+	 * All shapes must be closed.
+	 * @see ShapeClipper
+	 * @exception Ogre::InvalidParametersException All shapes must be closed
+	 */
+	MultiShape booleanDifference(const MultiShape& other) const;
+
+	/**
+	 * Removes the points that don't change the shapes by more than a given tolerance.
+	 * Shapes are simplified in parallel when the library is built with OpenMP, then points are put back
+	 * wherever simplified shapes would cross themselves or each other.
+	 * @param tolerance The simplification tolerance, whose meaning depends on the method
+	 * @param method The simplification algorithm
+	 * @see Shape::simplify
+	 */
+	MultiShape& simplify(Ogre::Real tolerance, SimplificationMethod method = SM_DOUGLAS_PEUCKER);
+
+};
+//-----------------------------------------------------------------------
+/**
+ * \ingroup shapegrp
+ * Answers point-in-multishape queries against a fixed multishape, much faster than MultiShape::isPointInside when
+ * many points are tested.
+ * The segments are sorted once into horizontal slabs, so that a query only scans the segments overlapping its own slab.
+ * Results are the same as MultiShape::isPointInside, including the user-defined outside given by isOutsideRealOutside.
+ * <code>
+ * PreparedMultiShape district(outlines);
+ * std::vector<bool> inside;
+ * district.arePointsInside(candidates, inside);
+ * </code>
+ */
+class _ProceduralExport PreparedMultiShape
+{
+	MultiShape mMultiShape;
+
+	/// Result for points whose horizontal line doesn't cross any segment
+	bool mIsOutsideInside;
+
+	Ogre::Real mOriginY;
+	Ogre::Real mInvSlabHeight;
+	int mSlabCount;
+
+	/// Segments of slab s are stored from mSlabStart[s] to mSlabStart[s+1]-1, in the same order as MultiShape::isPointInside scans them
+	std::vector<size_t> mSlabStart;
+	std::vector<Ogre::Real> mAX;
+	std::vector<Ogre::Real> mAY;
+	std::vector<Ogre::Real> mBX;
+	std::vector<Ogre::Real> mBY;
+	std::vector<unsigned int> mShapeIndex;
+	std::vector<unsigned int> mSegmentIndex;
+
+	int _slab(Ogre::Real y) const;
+
+public:
+	/// Default constructor, with an empty multishape
+	PreparedMultiShape() : mIsOutsideInside(false), mOriginY(0), mInvSlabHeight(0), mSlabCount(0) {}
+
+	/// Constructor from the multishape to query
+	PreparedMultiShape(const MultiShape& multiShape) : mIsOutsideInside(false), mOriginY(0), mInvSlabHeight(0), mSlabCount(0)
+	{
+		prepare(multiShape);
+	}
+
+	/// Builds the index for a multishape, replacing the previous one
+	void prepare(const MultiShape& multiShape);
+
+	/// Gets the multishape being queried
+	const MultiShape& getMultiShape() const
+	{
+		return mMultiShape;
+	}
+
+	/// Tells whether a point is located inside the multishape
+	/// @see MultiShape::isPointInside
+	bool isPointInside(const Ogre::Vector2& point) const;
+
+	/// Tells whether each of the points is located inside the multishape.
+	/// Points are processed in parallel when the library is built with OpenMP.
+	/// @param points The points to test
+	/// @param result Receives one value per point
+	void arePointsInside(const std::vector<Ogre::Vector2>& points, std::vector<bool>& result) const;
 };
 }
 #endif
@@ -29,6 +29,8 @@ THE SOFTWARE.
 #define PROCEDURAL_MULTISHAPE_GENERATORS_INCLUDED
 
 #include "ProceduralMultiShape.h"
+#include "ProceduralShape.h"
+#include <list>
 
 namespace Procedural
 {
@@ -38,6 +40,90 @@ namespace Procedural
  */
 #ifdef PROCEDURAL_USE_FREETYPE
 //-----------------------------------------------------------------------
+/**
+ * Shared cache of font faces and glyph outlines, used by TextShape.
+ * Each font file is opened once, and each glyph is decomposed once per font size, then copied from the cache.
+ * All accesses are serialised, so that several threads may build texts at once, provided the library is built with
+ * OpenMP or Ogre with thread support. Otherwise, only one thread at a time may use it, or build TextShapes.
+ * Once glyphs take more memory than the budget, the least recently used ones are dropped.
+ */
+class _ProceduralExport GlyphCache
+{
+public:
+	/// Outline and advance of a glyph, in pixels
+	struct Glyph
+	{
+		Shape mOutline;
+		int mAdvanceX;
+		int mAdvanceY;
+	};
+
+private:
+	struct GlyphKey
+	{
+		Ogre::String mFontFile;
+		unsigned int mFontSize;
+		unsigned long mCodePoint;
+
+		bool operator<(const GlyphKey& other) const;
+	};
+	struct GlyphEntry
+	{
+		Glyph mGlyph;
+		/// Position of the glyph in mRecentGlyphs
+		std::list<GlyphKey>::iterator mRecent;
+		size_t mMemory;
+		/// Whether the font has that glyph, missing glyphs being cached as well
+		bool mFound;
+	};
+	struct FontFace;
+	struct FontLibrary;
+	struct OpenMPLock;
+
+	FontLibrary* mLibrary;
+	std::map<Ogre::String, FontFace*> mFaces;
+	std::map<GlyphKey, GlyphEntry> mGlyphs;
+	/// Glyphs from the most to the least recently used
+	std::list<GlyphKey> mRecentGlyphs;
+	size_t mMemoryUsage;
+	size_t mMemoryBudget;
+	OGRE_MUTEX(mMutex);
+	/// Serialises accesses when built with OpenMP, as OGRE_MUTEX does nothing without Ogre's thread support
+	OpenMPLock* mOpenMPLock;
+
+	GlyphCache();
+	~GlyphCache();
+	GlyphCache(const GlyphCache&);
+	GlyphCache& operator=(const GlyphCache&);
+
+	FontFace* _getFace(const Ogre::String& fontFile);
+	void _evict();
+
+public:
+	/// Gets the cache shared by all TextShapes
+	static GlyphCache& getSingleton();
+
+	/**
+	 * Gets a glyph, loading it from the font file on the first request.
+	 * @param fontFile path of the font file
+	 * @param fontSize size of the font [px]
+	 * @param codePoint the character to get
+	 * @param glyph where to copy the glyph
+	 * @return false if the font has no such glyph
+	 * \exception Ogre::InternalErrorException Freetype error
+	 */
+	bool getGlyph(const Ogre::String& fontFile, unsigned int fontSize, unsigned long codePoint, Glyph& glyph);
+
+	/// Sets the memory the glyphs may take, in bytes (default 8MB)
+	void setMemoryBudget(size_t memoryBudget);
+
+	/// Gets the approximate memory taken by the cached glyphs, in bytes
+	size_t getMemoryUsage() const;
+
+	/// Drops all glyphs and closes all font files
+	void clear();
+};
+//-----------------------------------------------------------------------
 /**
  * Produces a multishape from a given text
  * \image html shape_text.png
@@ -95,6 +181,7 @@ public:
 
 	/**
 	 * Build a MultiShape from chars (one Shape per character)
+	 * Glyphs are taken from the GlyphCache, so repeated characters and fonts are only loaded once.
 	 * \exception Ogre::InternalErrorException Freetype error
 	 * \todo Need to split shapes of multi region chars. For example the letter \c O
 	 * has two shapes, but they are connected to one shape.
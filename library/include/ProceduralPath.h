@@ -54,13 +54,21 @@ class _ProceduralExport Path
 {
 	std::vector<Ogre::Vector3> mPoints;
 	bool mClosed;
+	/// Lineic position of each point, empty when it has to be computed again
+	mutable std::vector<Ogre::Real> mLengths;
+	/// Rotation minimizing frame at each point, empty when it has to be computed again
+	mutable std::vector<Ogre::Quaternion> mFrames;
+	/// Whether mFrames was computed with twist distribution
+	mutable bool mFramesTwistDistributed;
 public:
 	/// Default constructor
-	Path() : mClosed(false)	{}
+	Path() : mClosed(false), mFramesTwistDistributed(false)	{}
 
 	/** Adds a point to the path, as a Vector3 */
 	Path& addPoint(const Ogre::Vector3& pt)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		mPoints.push_back(pt);
 		return *this;
 	}
@@ -68,6 +76,8 @@ public:
 	/** Adds a point to the path, using its 3 coordinates */
 	Path& addPoint(Ogre::Real x, Ogre::Real y, Ogre::Real z)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		mPoints.push_back(Ogre::Vector3(x,y,z));
 		return *this;
 	}
@@ -79,6 +89,8 @@ public:
 	/// @param z new point's z coordinate
 	inline Path& insertPoint(size_t index, Ogre::Real x, Ogre::Real y, Ogre::Real z)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		mPoints.insert(mPoints.begin()+index, Ogre::Vector3(x, y, z));
 		return *this;
 	}
@@ -88,6 +100,8 @@ public:
 	/// @param pt new point's position
 	inline Path& insertPoint(size_t index, const Ogre::Vector3& pt)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		mPoints.insert(mPoints.begin()+index, pt);
 		return *this;
 	}
@@ -95,6 +109,8 @@ public:
 	/// Appends another path at the end of this one
 	inline Path& appendPath(const Path& other)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		mPoints.insert(mPoints.end(), other.mPoints.begin(), other.mPoints.end());
 		return *this;
 	}
@@ -102,6 +118,8 @@ public:
 	/// Appends another path at the end of this one, relative to the last point of this path
 	inline Path& appendPathRel(const Path& other)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		if (mPoints.empty())
 			appendPath(other);
 		else
@@ -118,6 +136,8 @@ public:
 	/** Clears the content of the Path */
 	Path& reset()
 	{
+		mLengths.clear();
+		mFrames.clear();
 		mPoints.clear();
 		return *this;
 	}
@@ -128,6 +148,8 @@ public:
 	*/
 	Path& close()
 	{
+		mLengths.clear();
+		mFrames.clear();
 		if (mPoints.empty())
 			OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "Cannot close an empty path", "Procedural::Path::close()");
 		mClosed = true;
@@ -149,6 +171,8 @@ public:
 	/// Gets raw vector data of this path as a non-const reference
 	inline std::vector<Ogre::Vector3>& getPointsReference()
 	{
+		mLengths.clear();
+		mFrames.clear();
 		return mPoints;
 	}
 
@@ -207,11 +231,33 @@ public:
 		return (getDirectionAfter(i) + getDirectionBefore(i)).normalisedCopy();
 	}
 
+	/**
+	 * Gets the lineic position of each point, from the first point.
+	 * For closed paths, an extra position is given for the return to the first point.
+	 * The positions are computed on first use and kept until the path is modified.
+	 * Since the first use fills a cache, call it once before sharing the path between threads.
+	 */
+	const std::vector<Ogre::Real>& getLineicPositions() const;
+
+	/**
+	 * Gets a rotation minimizing frame at each point, computed by the double reflection method.
+	 * Each frame maps UNIT_Z to the local direction of the path, and UNIT_Y to an up vector which turns as little as possible along the path.
+	 * The first up vector is the closest to UNIT_Y, as with Utils::_computeQuaternion.
+	 * For closed paths, an extra frame is given for the return to the first point.
+	 * The frames are computed on first use and kept until the path is modified.
+	 * @param distributeTwist for closed paths, spreads the twist accumulated over the loop along the path, so that the last frame matches the first one
+	 */
+	const std::vector<Ogre::Quaternion>& getRotationMinimizingFrames(bool distributeTwist = true) const;
+
 	/// Returns the total lineic length of that shape
 	Ogre::Real getTotalLength() const;
 
-
-	Ogre::Real getLengthAtPoint(size_t index) const;
+	/// Gets the lineic position of a point
+	/// @param index index of the point, or the point count to get the length of a closed path
+	Ogre::Real getLengthAtPoint(size_t index) const
+	{
+		return getLineicPositions()[index];
+	}
 
 	/// Gets a position on the shape with index of the point and a percentage of position on the segment
 	/// @param i index of the segment
@@ -229,11 +275,18 @@ public:
 		return A + coord*(B-A);
 	}
 
-	/// Gets a position on the shape from lineic coordinate
+	/// Gets a position on the shape from lineic coordinate.
+	/// Beyond the end, open paths give their last point and closed paths loop.
 	/// @param coord lineic coordinate
 	/// @exception Ogre::InvalidStateException The path must at least contain 2 points
 	Ogre::Vector3 getPosition(Ogre::Real coord) const;
 
+	/// Gets the positions on the path at several lineic coordinates, in any order
+	/// @param coords lineic coordinates
+	/// @param positions receives one position per coordinate
+	/// @exception Ogre::InvalidStateException The path must at least contain 2 points
+	void getPositions(const std::vector<Ogre::Real>& coords, std::vector<Ogre::Vector3>& positions) const;
+
 	/**
 	 * Outputs a mesh representing the path.
 	 * Mostly for debugging purposes
@@ -243,6 +296,31 @@ public:
 	/// Creates a path with the keys of this path and extra keys coming from a track
 	Path mergeKeysWithTrack(const Track& track) const;
 
+	/**
+	 * Removes the points that don't change the path by more than a given tolerance.
+	 * Closed paths keep at least 3 points.
+	 * @param tolerance The simplification tolerance, whose meaning depends on the method
+	 * @param method The simplification algorithm
+	 */
+	Path& simplify(Ogre::Real tolerance, SimplificationMethod method = SM_DOUGLAS_PEUCKER);
+
+	/**
+	 * Builds a path whose points are evenly spaced along this one.
+	 * The step is adjusted so that the length is divided evenly.
+	 * @param step The targeted distance between two points
+	 * @param lineicPositions If not null, receives the lineic position of each new point along this path, usable as Track keys in AM_ABSOLUTE_LINEIC mode
+	 */
+	Path resample(Ogre::Real step, std::vector<Ogre::Real>* lineicPositions = 0) const;
+
+	/**
+	 * Builds a path whose points are closer together where this one bends.
+	 * Corners turning by more than the angle tolerance are kept.
+	 * @param maxStep The maximal distance between two points
+	 * @param angleTolerance The maximal change of direction between two points
+	 * @param lineicPositions If not null, receives the lineic position of each new point along this path, usable as Track keys in AM_ABSOLUTE_LINEIC mode
+	 */
+	Path resampleAdaptive(Ogre::Real maxStep, Ogre::Radian angleTolerance, std::vector<Ogre::Real>* lineicPositions = 0) const;
+
 	/**
 	* Applies the given translation to all the points already defined.
 	* Has strictly no effect on the points defined after that
@@ -250,6 +328,8 @@ public:
 	*/
 	Path& translate(const Ogre::Vector3& translation)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		for (std::vector<Ogre::Vector3>::iterator it = mPoints.begin(); it!=mPoints.end(); ++it)
 			*it+=translation;
 		return *this;
@@ -286,6 +366,8 @@ public:
 	 */
 	Path& scale(Ogre::Real scaleX, Ogre::Real scaleY, Ogre::Real scaleZ)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		for (std::vector<Ogre::Vector3>::iterator it = mPoints.begin(); it!=mPoints.end(); ++it)
 		{
 			it->x *= scaleX;
@@ -311,6 +393,8 @@ public:
 	 */
 	Path& reflect(const Ogre::Vector3& normal)
 	{
+		mLengths.clear();
+		mFrames.clear();
 		for (std::vector<Ogre::Vector3>::iterator it = mPoints.begin(); it!=mPoints.end(); ++it)
 		{
 			*it = it->reflect(normal);
@@ -334,6 +418,8 @@ public:
 	/// Reverses direction of the path
 	inline Path& reverse()
 	{
+		mLengths.clear();
+		mFrames.clear();
 		std::reverse(mPoints.begin(), mPoints.end());
 		return *this;
 	}
@@ -394,13 +480,25 @@ public:
 		return mPaths.size();
 	}
 
-	Path getPath(unsigned int i) const
+	const Path& getPath(unsigned int i) const
 	{
 		return mPaths[i];
 	}
 
+	/**
+	 * Finds the points shared by several paths, or appearing several times in a path, within 1e-3 of each other.
+	 * Points are welded through a spatial hash, in linear time.
+	 */
 	void _calcIntersections();
 
+	/**
+	 * Adds a point to every path where it crosses another path, or where another path ends on it, then updates intersections.
+	 * Crossings are searched in the XZ plane through a uniform grid over the segments, and only kept where both paths are at the same height.
+	 * @param tolerance distance under which a crossing is merged with an existing point
+	 * @param maxHeightDifference maximal difference of Y between both paths at the crossing
+	 */
+	MultiPath& splitAtCrossings(Ogre::Real tolerance = 1e-3f, Ogre::Real maxHeightDifference = 1e-3f);
+
 	inline const std::map<PathCoordinate, PathIntersection>& getIntersectionsMap() const
 	{
 		return mIntersectionsMap;
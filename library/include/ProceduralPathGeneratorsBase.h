@@ -44,10 +44,14 @@ class BaseSpline3
 protected:
 	/// The number of segments between 2 control points
 	unsigned int mNumSeg;
+	/// The maximal distance between the spline and its segments, 0 to use a fixed number of segments
+	Ogre::Real mTolerance;
+	/// The maximal change of direction between 2 segments, when tolerance is used
+	Ogre::Radian mAngleTolerance;
 	/// Tells if the spline is closed or not
 	bool mClosed;
 public:
-	BaseSpline3() : mNumSeg(4), mClosed(false) {}
+	BaseSpline3() : mNumSeg(4), mTolerance(0), mAngleTolerance(Ogre::Degree(10)), mClosed(false) {}
 
 	/// Sets the number of segments between 2 control points
 	/// \exception Ogre::InvalidParametersException Minimum of numSeg is 1
@@ -59,6 +63,31 @@ public:
 		return (T&)*this;
 	}
 
+	/**
+	 * Sets the tessellation tolerance.
+	 * When strictly positive, each part between 2 control points is split adaptively,
+	 * until the spline is closer than tolerance to its segments and turns by less than the angle tolerance.
+	 * Straight parts then only get one segment. When 0 (the default), the number of segments is used instead.
+	 * \exception Ogre::InvalidParametersException Tolerance must not be negative
+	 */
+	inline T& setTolerance(Ogre::Real tolerance)
+	{
+		if (tolerance < 0)
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Tolerance must not be negative", "Procedural::BaseSpline3::setTolerance(Ogre::Real)");
+		mTolerance = tolerance;
+		return (T&)*this;
+	}
+
+	/// Sets the maximal change of direction between 2 segments, used along with the tolerance (default = 10 degrees)
+	/// \exception Ogre::InvalidParametersException Angle tolerance must be strictly positive
+	inline T& setAngleTolerance(Ogre::Radian angleTolerance)
+	{
+		if (angleTolerance.valueRadians() <= 0)
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Angle tolerance must be strictly positive", "Procedural::BaseSpline3::setAngleTolerance(Ogre::Radian)");
+		mAngleTolerance = angleTolerance;
+		return (T&)*this;
+	}
+
 	/// Closes the spline
 	inline T& close()
 	{
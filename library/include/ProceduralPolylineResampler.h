@@ -0,0 +1,85 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#ifndef PROCEDURAL_POLYLINE_RESAMPLER_INCLUDED
+#define PROCEDURAL_POLYLINE_RESAMPLER_INCLUDED
+
+#include "ProceduralPlatform.h"
+#include "OgreVector2.h"
+#include "OgreVector3.h"
+
+namespace Procedural
+{
+/**
+ * Places new points along polylines, in a single pass over their segments.
+ * The lineic positions of the input points must be given, as returned by Path::getLineicPositions or Shape::getLineicPositions.
+ * Output lineic positions are measured along the input polyline, so they can be used as keys of a Track in AM_ABSOLUTE_LINEIC mode.
+ */
+class _ProceduralExport PolylineResampler
+{
+public:
+	/**
+	 * Places points at regular intervals along a 2D polyline.
+	 * The step is adjusted so that the length is divided evenly, and the ends of open polylines are kept.
+	 * A polyline whose points all coincide gives a single point.
+	 * @param points The points of the polyline
+	 * @param closed Whether the last point is linked to the first one
+	 * @param lineicPositions The lineic position of each point of the polyline
+	 * @param step The targeted distance between two points
+	 * @param result Receives the new points
+	 * @param resultLineicPositions If not null, receives the lineic position of each new point along the input polyline
+	 */
+	static void resample(const std::vector<Ogre::Vector2>& points, bool closed, const std::vector<Ogre::Real>& lineicPositions, Ogre::Real step,
+	                     std::vector<Ogre::Vector2>& result, std::vector<Ogre::Real>* resultLineicPositions = 0);
+
+	/// Places points at regular intervals along a 3D polyline
+	/// @see resample
+	static void resample(const std::vector<Ogre::Vector3>& points, bool closed, const std::vector<Ogre::Real>& lineicPositions, Ogre::Real step,
+	                     std::vector<Ogre::Vector3>& result, std::vector<Ogre::Real>* resultLineicPositions = 0);
+
+	/**
+	 * Places points along a 2D polyline, closer together where it bends.
+	 * Corners turning by more than the angle tolerance are kept as they are. In between, points are spread so that
+	 * the distance between two points stays below maxStep and the direction changes by less than the angle tolerance.
+	 * @param points The points of the polyline
+	 * @param closed Whether the last point is linked to the first one
+	 * @param lineicPositions The lineic position of each point of the polyline
+	 * @param maxStep The maximal distance between two points
+	 * @param angleTolerance The maximal change of direction between two points
+	 * @param result Receives the new points
+	 * @param resultLineicPositions If not null, receives the lineic position of each new point along the input polyline
+	 */
+	static void resampleAdaptive(const std::vector<Ogre::Vector2>& points, bool closed, const std::vector<Ogre::Real>& lineicPositions, Ogre::Real maxStep,
+	                             Ogre::Radian angleTolerance, std::vector<Ogre::Vector2>& result, std::vector<Ogre::Real>* resultLineicPositions = 0);
+
+	/// Places points along a 3D polyline, closer together where it bends
+	/// @see resampleAdaptive
+	static void resampleAdaptive(const std::vector<Ogre::Vector3>& points, bool closed, const std::vector<Ogre::Real>& lineicPositions, Ogre::Real maxStep,
+	                             Ogre::Radian angleTolerance, std::vector<Ogre::Vector3>& result, std::vector<Ogre::Real>* resultLineicPositions = 0);
+};
+}
+#endif
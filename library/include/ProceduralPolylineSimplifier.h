@@ -0,0 +1,79 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#ifndef PROCEDURAL_POLYLINE_SIMPLIFIER_INCLUDED
+#define PROCEDURAL_POLYLINE_SIMPLIFIER_INCLUDED
+
+#include "ProceduralPlatform.h"
+#include "OgreVector2.h"
+#include "OgreVector3.h"
+
+namespace Procedural
+{
+/// Algorithm used to remove points from a polyline
+enum SimplificationMethod
+{
+	/// Ramer-Douglas-Peucker : keeps the points farther than the tolerance from the simplified polyline
+	SM_DOUGLAS_PEUCKER,
+	/// Visvalingam-Whyatt : removes the points forming the smallest triangles with their neighbours first,
+	/// while those triangles are smaller than tolerance * tolerance
+	SM_VISVALINGAM_WHYATT
+};
+
+/**
+ * Removes unnecessary points from polylines.
+ * Closed polylines keep at least 3 points, open ones keep their ends.
+ * 2D polylines are also checked for crossings : wherever a simplified segment crosses another one,
+ * the farthest point it had replaced is put back, until no new crossing remains.
+ */
+class _ProceduralExport PolylineSimplifier
+{
+public:
+	/**
+	 * Tells which points of a 2D polyline are kept.
+	 * @param points The points of the polyline
+	 * @param closed Whether the last point is linked to the first one
+	 * @param tolerance The simplification tolerance
+	 * @param method The simplification algorithm
+	 * @param keep Receives one flag per point, non-zero for kept points
+	 */
+	static void simplify(const std::vector<Ogre::Vector2>& points, bool closed, Ogre::Real tolerance, SimplificationMethod method, std::vector<char>& keep);
+
+	/// Tells which points of a 3D polyline are kept. Crossings aren't checked in 3D.
+	/// @see simplify
+	static void simplify(const std::vector<Ogre::Vector3>& points, bool closed, Ogre::Real tolerance, SimplificationMethod method, std::vector<char>& keep);
+
+	/**
+	 * Puts back removed points until no simplified segment crosses another one, including segments of other polylines.
+	 * @param polylines The original points of each polyline
+	 * @param closed Whether each polyline is closed
+	 * @param keep The flags given by simplify for each polyline, updated in place
+	 */
+	static void removeCrossings(const std::vector<const std::vector<Ogre::Vector2>*>& polylines, const std::vector<bool>& closed, std::vector<std::vector<char> >& keep);
+};
+}
+#endif
@@ -68,23 +68,26 @@ class _ProceduralExport SvgLoader
 {
 private:
 	unsigned int mNumSeg;
+	Ogre::Real mTolerance;
 
-	/** Internal class to parse path element */
+	/** Internal class to parse path element, reading the path data in place */
 	class SvgLoaderPath
 	{
 	private:
-		size_t index;
-		std::vector<std::string> parts;
+		const char* mCursor;
+		const char* mEnd;
 		std::vector<Ogre::Vector2> curve;
 		Ogre::Vector2 point;
 		unsigned int mNumSeg;
+		Ogre::Real mTolerance;
 
 	public:
 		Shape shape;
 		Ogre::Real px;
 		Ogre::Real py;
 
-		SvgLoaderPath(std::vector<std::string> p, unsigned int ns);
+		/// Parses size characters of path data, which need not be null-terminated
+		SvgLoaderPath(const char* data, size_t size, unsigned int ns, Ogre::Real tolerance);
 
 		inline void finishCurve(char lc);
 
@@ -129,44 +132,87 @@ private:
 
 		void parseArcTo(bool rel, bool next);
 
-		inline bool parseReal(Ogre::Real* var, Ogre::Real defaultReal = 0.0f)
-		{
-			if (var == NULL) return false;
-			if (index >= parts.size()) return false;
-			try
-			{
-				*var = Ogre::StringConverter::parseReal(parts[index], defaultReal);
-				index++;
-			}
-			catch (...)
-			{
-				return false;
-			}
-			return true;
-		}
+		/// Appends the points of a curve to the shape, skipping its first point if the shape already ends there
+		void appendPoints(const Shape& piece);
+
+		/// Reads the next number of the path data, returns false if the next token is not a number
+		bool parseReal(Ogre::Real* var);
+
+		/// Reads the next arc flag of the path data, which may not be separated from what follows it
+		bool parseFlag(bool* var);
 	};
 
 public:
 
 	/**
 	Parses a SVG file
+	Elements are flattened in parallel when OpenMP is enabled, and their shapes are added in document order.
+	Transforms of the groups an element belongs to are composed with its own and applied to its shapes.
+	translate, scale, rotate, skewX, skewY and matrix are supported.
 	@param out MultiShape object where to store shapes from svg file
 	@param fileName Filename of svg file
 	@param groupName Resource group where svg file is listed
 	@param segmentsNumber Number of segments for curves
+	@param tolerance If strictly positive, curves, arcs, circles and ellipses are subdivided until they deviate from
+	the real curve by less than tolerance once the element's transforms are applied, and segmentsNumber is ignored for them.
+	\exception Ogre::InvalidParametersException Tolerance must not be negative
 	*/
-	void parseSvgFile(MultiShape& out, const Ogre::String& fileName, const Ogre::String& groupName = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, int segmentsNumber = 8);
+	void parseSvgFile(MultiShape& out, const Ogre::String& fileName, const Ogre::String& groupName = Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, int segmentsNumber = 8, Ogre::Real tolerance = 0);
 
 private:
-	void parseChildNode(MultiShape& out, rapidxml::xml_node<char>* pChild);
+	/// A 2D affine transform, with the coefficients of svg's matrix() : x' = a*x + c*y + e, y' = b*x + d*y + f
+	struct SvgTransform
+	{
+		Ogre::Real a, b, c, d, e, f;
+
+		SvgTransform() : a(1), b(0), c(0), d(1), e(0), f(0) {}
+
+		SvgTransform(Ogre::Real a_, Ogre::Real b_, Ogre::Real c_, Ogre::Real d_, Ogre::Real e_, Ogre::Real f_) : a(a_), b(b_), c(c_), d(d_), e(e_), f(f_) {}
+
+		/// Returns the transform applying other first, then this one
+		SvgTransform operator*(const SvgTransform& other) const
+		{
+			return SvgTransform(a * other.a + c * other.b, b * other.a + d * other.b,
+			                    a * other.c + c * other.d, b * other.c + d * other.d,
+			                    a * other.e + c * other.f + e, b * other.e + d * other.f + f);
+		}
+
+		Ogre::Vector2 apply(const Ogre::Vector2& point) const
+		{
+			return Ogre::Vector2(a * point.x + c * point.y + e, b * point.x + d * point.y + f);
+		}
+
+		bool isIdentity() const
+		{
+			return a == 1 && b == 0 && c == 0 && d == 1 && e == 0 && f == 0;
+		}
+
+		/// Returns the largest factor by which the transform stretches a length, ie the largest singular value of its linear part
+		Ogre::Real getMaxScale() const
+		{
+			Ogre::Real sum = a * a + b * b + c * c + d * d;
+			Ogre::Real det = a * d - b * c;
+			return Ogre::Math::Sqrt((sum + Ogre::Math::Sqrt(std::max((Ogre::Real)0, sum * sum - 4 * det * det))) / 2);
+		}
+	};
+
+	/// A shape element of the document, with its transform composed with the ones of the groups it belongs to
+	struct SvgElement
+	{
+		rapidxml::xml_node<char>* mNode;
+		SvgTransform mTransform;
+	};
+
+	void gatherElements(std::vector<SvgElement>& elements, rapidxml::xml_node<char>* pNode, const SvgTransform& groupTransform);
+	void parseElement(MultiShape& out, const SvgElement& element);
 	void parseRect(MultiShape& out, rapidxml::xml_node<char>* pRectNode);
-	void parseCircle(MultiShape& out, rapidxml::xml_node<char>* pCircleNode);
-	void parseEllipse(MultiShape& out, rapidxml::xml_node<char>* pEllipseNode);
+	void parseCircle(MultiShape& out, rapidxml::xml_node<char>* pCircleNode, Ogre::Real tolerance);
+	void parseEllipse(MultiShape& out, rapidxml::xml_node<char>* pEllipseNode, Ogre::Real tolerance);
 	void parsePolygon(MultiShape& out, rapidxml::xml_node<char>* pPolygonNode);
-	void parsePath(MultiShape& out, rapidxml::xml_node<char>* pPathNode);
+	void parsePath(MultiShape& out, rapidxml::xml_node<char>* pPathNode, Ogre::Real tolerance);
 
 	Ogre::Real getAttribReal(rapidxml::xml_node<char>* pNode, const Ogre::String& attrib, Ogre::Real defaultValue = 0.0f);
-	Ogre::Vector2 getAttribTranslate(rapidxml::xml_node<char>* pNode);
+	SvgTransform getAttribTransform(rapidxml::xml_node<char>* pNode);
 	std::vector<std::string> split(const std::string& str, const std::string& delimiters, bool removeEmpty = true);
 	std::string xtrim(const char* val, const char* achar = " .-0123456789", char rchar = ' ');
 };
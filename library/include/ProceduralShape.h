@@ -34,6 +34,7 @@ THE SOFTWARE.
 #include "OgreMesh.h"
 #include "OgreManualObject.h"
 #include "ProceduralMultiShape.h"
+#include "ProceduralPolylineSimplifier.h"
 #include "ProceduralTrack.h"
 
 namespace Procedural
@@ -59,6 +60,8 @@ class _ProceduralExport Shape
 	std::vector<Ogre::Vector2> mPoints;
 	bool mClosed;
 	Side mOutSide;
+	/// Lineic position of each point, empty when it has to be computed again
+	mutable std::vector<Ogre::Real> mLengths;
 
 public:
 	/// Default constructor
@@ -67,6 +70,7 @@ public:
 	/// Adds a point to the shape
 	inline Shape& addPoint(const Ogre::Vector2& pt)
 	{
+		mLengths.clear();
 		mPoints.push_back(pt);
 		return *this;
 	}
@@ -74,6 +78,7 @@ public:
 	/// Adds a point to the shape
 	inline Shape& addPoint(Ogre::Real x, Ogre::Real y)
 	{
+		mLengths.clear();
 		mPoints.push_back(Ogre::Vector2(x, y));
 		return *this;
 	}
@@ -84,6 +89,7 @@ public:
 	/// @param y new point's y coordinate
 	inline Shape& insertPoint(size_t index, Ogre::Real x, Ogre::Real y)
 	{
+		mLengths.clear();
 		mPoints.insert(mPoints.begin()+index, Ogre::Vector2(x, y));
 		return *this;
 	}
@@ -93,6 +99,7 @@ public:
 	/// @param pt new point's position
 	inline Shape& insertPoint(size_t index, const Ogre::Vector2& pt)
 	{
+		mLengths.clear();
 		mPoints.insert(mPoints.begin()+index, pt);
 		return *this;
 	}
@@ -100,6 +107,7 @@ public:
 	/// Adds a point to the shape, relative to the last point added
 	inline Shape& addPointRel(const Ogre::Vector2& pt)
 	{
+		mLengths.clear();
 		if (mPoints.empty())
 			mPoints.push_back(pt);
 		else
@@ -110,6 +118,7 @@ public:
 	/// Adds a point to the shape, relative to the last point added
 	inline Shape& addPointRel(Ogre::Real x, Ogre::Real y)
 	{
+		mLengths.clear();
 		if (mPoints.empty())
 			mPoints.push_back(Ogre::Vector2(x, y));
 		else
@@ -120,6 +129,7 @@ public:
 	/// Appends another shape at the end of this one
 	inline Shape& appendShape(const Shape& other)
 	{
+		mLengths.clear();
 		mPoints.insert(mPoints.end(), other.mPoints.begin(), other.mPoints.end());
 		return *this;
 	}
@@ -127,6 +137,7 @@ public:
 	/// Appends another shape at the end of this one, relative to the last point of this shape
 	inline Shape& appendShapeRel(const Shape& other)
 	{
+		mLengths.clear();
 		if (mPoints.empty())
 			appendShape(other);
 		else
@@ -158,6 +169,7 @@ public:
 	/// The outside is preserved
 	inline Shape& reverse()
 	{
+		mLengths.clear();
 		std::reverse(mPoints.begin(), mPoints.end());
 		switchSide();
 		return *this;
@@ -166,6 +178,7 @@ public:
 	/// Clears the content of the shape
 	inline Shape& reset()
 	{
+		mLengths.clear();
 		mPoints.clear();
 		return *this;
 	}
@@ -185,6 +198,7 @@ public:
 	/// Gets raw vector data of this shape as a non-const reference
 	inline std::vector<Ogre::Vector2>& getPointsReference()
 	{
+		mLengths.clear();
 		return mPoints;
 	}
 
@@ -221,6 +235,7 @@ public:
 	 */
 	inline Shape& close()
 	{
+		mLengths.clear();
 		mClosed = true;
 		return *this;
 	}
@@ -392,6 +407,7 @@ public:
 	 */
 	Shape& translate(const Ogre::Vector2& translation)
 	{
+		mLengths.clear();
 		for (std::vector<Ogre::Vector2>::iterator it = mPoints.begin(); it!=mPoints.end(); ++it)
 			*it+=translation;
 		return *this;
@@ -415,6 +431,7 @@ public:
 	 */
 	Shape& rotate(Ogre::Radian angle)
 	{
+		mLengths.clear();
 		Ogre::Real c = Ogre::Math::Cos(angle.valueRadians());
 		Ogre::Real s = Ogre::Math::Sin(angle.valueRadians());
 		for (std::vector<Ogre::Vector2>::iterator it = mPoints.begin(); it!=mPoints.end(); ++it)
@@ -445,6 +462,7 @@ public:
 	 */
 	Shape& scale(Ogre::Real scaleX, Ogre::Real scaleY)
 	{
+		mLengths.clear();
 		for (std::vector<Ogre::Vector2>::iterator it = mPoints.begin(); it!=mPoints.end(); ++it)
 		{
 			it->x *= scaleX;
@@ -469,6 +487,7 @@ public:
 	 */
 	Shape& reflect(const Ogre::Vector2& normal)
 	{
+		mLengths.clear();
 		for (std::vector<Ogre::Vector2>::iterator it = mPoints.begin(); it!=mPoints.end(); ++it)
 		{
 			*it = it->reflect(normal);
@@ -503,6 +522,7 @@ public:
 	 */
 	Shape& mirrorAroundPoint(Ogre::Vector2 point, bool flip = false)
 	{
+		mLengths.clear();
 		int l = (int)mPoints.size();
 		if (flip)
 			for (int i = l - 1; i >= 0; i--)
@@ -526,6 +546,7 @@ public:
 	 */
 	Shape& mirrorAroundAxis(const Ogre::Vector2& axis, bool flip = false)
 	{
+		mLengths.clear();
 		int l = (int)mPoints.size();
 		Ogre::Vector2 normal = axis.perpendicular().normalisedCopy();
 		if (flip)
@@ -545,15 +566,22 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Gets the lineic position of each point, from the first point.
+	 * For closed shapes, an extra position is given for the return to the first point.
+	 * The positions are computed on first use and kept until the shape is modified.
+	 * Since the first use fills a cache, call it once before sharing the shape between threads.
+	 */
+	const std::vector<Ogre::Real>& getLineicPositions() const;
+
 	/// Returns the total lineic length of that shape
-	Ogre::Real getTotalLength() const
+	Ogre::Real getTotalLength() const;
+
+	/// Gets the lineic position of a point
+	/// @param index index of the point, or the point count to get the length of a closed shape
+	Ogre::Real getLengthAtPoint(size_t index) const
 	{
-		Ogre::Real length = 0;
-		for (unsigned int i=0; i<mPoints.size()-1; i++)
-			length+=(mPoints[i+1]-mPoints[i]).length();
-		if (mClosed)
-			length+=(mPoints.back()-*mPoints.begin()).length();
-		return length;
+		return getLineicPositions()[index];
 	}
 
 	/// Gets a position on the shape with index of the point and a percentage of position on the segment
@@ -563,35 +591,26 @@ public:
 	/// @exception Ogre::InvalidParametersException coord must be comprised between 0 and 1
 	inline Ogre::Vector2 getPosition(unsigned int i, Ogre::Real coord) const
 	{
-		if (!mClosed || i >= mPoints.size())
-			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Out of Bounds", "Procedural::Path::getPosition(unsigned int, Ogre::Real)");
+		if (i >= mPoints.size())
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Out of Bounds", "Procedural::Shape::getPosition(unsigned int, Ogre::Real)");
 		if (coord < 0.0f || coord > 1.0f)
-			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Coord must be comprised between 0 and 1", "Procedural::Path::getPosition(unsigned int, Ogre::Real)");
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Coord must be comprised between 0 and 1", "Procedural::Shape::getPosition(unsigned int, Ogre::Real)");
 		Ogre::Vector2 A = getPoint(i);
 		Ogre::Vector2 B = getPoint(i+1);
 		return A + coord*(B-A);
 	}
 
-	/// Gets a position on the shape from lineic coordinate
+	/// Gets a position on the shape from lineic coordinate.
+	/// Beyond the end, open shapes give their last point and closed shapes loop.
 	/// @param coord lineic coordinate
 	/// @exception Ogre::InvalidStateException The shape must at least contain 2 points
-	inline Ogre::Vector2 getPosition(Ogre::Real coord) const
-	{
-		if (mPoints.size() < 2)
-			OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "The shape must at least contain 2 points", "Procedural::Shape::getPosition(Ogre::Real)");
-		unsigned int i=0;
-		while (true)
-		{
-			Ogre::Real nextLen = (getPoint(i+1) - getPoint(i)).length();
-			if (coord>nextLen)
-				coord-=nextLen;
-			else
-				return getPosition(i, coord);
-			if (!mClosed && i>= mPoints.size()-2)
-				return mPoints.back();
-			i++;
-		}
-	}
+	Ogre::Vector2 getPosition(Ogre::Real coord) const;
+
+	/// Gets the positions on the shape at several lineic coordinates, in any order
+	/// @param coords lineic coordinates
+	/// @param positions receives one position per coordinate
+	/// @exception Ogre::InvalidStateException The shape must at least contain 2 points
+	void getPositions(const std::vector<Ogre::Real>& coords, std::vector<Ogre::Vector2>& positions) const;
 
 	/// Computes the radius of a bounding circle centered on the origin
 	Ogre::Real findBoundingRadius() const
@@ -603,11 +622,38 @@ public:
 	}
 
 	/**
-	 * Applies a "thickness" to a shape, ie a bit like the extruder, but in 2D
+	 * Applies a "thickness" to a shape, ie a bit like the extruder, but in 2D.
+	 * Corners are mitered, and the parts of the outline crossing each other are merged.
+	 * Use ShapeOffsetter for other kinds of joins.
 	 * <table border="0" width="100%"><tr><td>\image html shape_thick1.png "Start shape (before thicken)"</td><td>\image html shape_thick2.png "Result (after thicken)"</td></tr></table>
 	 */
 	MultiShape thicken(Ogre::Real amount);
 
+	/**
+	 * Removes the points that don't change the shape by more than a given tolerance.
+	 * Closed shapes keep at least 3 points, and points are put back wherever the simplified shape would cross itself.
+	 * @param tolerance The simplification tolerance, whose meaning depends on the method
+	 * @param method The simplification algorithm
+	 */
+	Shape& simplify(Ogre::Real tolerance, SimplificationMethod method = SM_DOUGLAS_PEUCKER);
+
+	/**
+	 * Builds a shape whose points are evenly spaced along this one.
+	 * The step is adjusted so that the length is divided evenly.
+	 * @param step The targeted distance between two points
+	 * @param lineicPositions If not null, receives the lineic position of each new point along this shape, usable as Track keys in AM_ABSOLUTE_LINEIC mode
+	 */
+	Shape resample(Ogre::Real step, std::vector<Ogre::Real>* lineicPositions = 0) const;
+
+	/**
+	 * Builds a shape whose points are closer together where this one bends.
+	 * Corners turning by more than the angle tolerance are kept.
+	 * @param maxStep The maximal distance between two points
+	 * @param angleTolerance The maximal change of direction between two points
+	 * @param lineicPositions If not null, receives the lineic position of each new point along this shape, usable as Track keys in AM_ABSOLUTE_LINEIC mode
+	 */
+	Shape resampleAdaptive(Ogre::Real maxStep, Ogre::Radian angleTolerance, std::vector<Ogre::Real>* lineicPositions = 0) const;
+
 private:
 
 	enum BooleanOperationType { BOT_UNION, BOT_INTERSECTION, BOT_DIFFERENCE};
@@ -0,0 +1,139 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#ifndef PROCEDURAL_SHAPE_CLIPPER_INCLUDED
+#define PROCEDURAL_SHAPE_CLIPPER_INCLUDED
+
+#include "ProceduralPlatform.h"
+#include "ProceduralShape.h"
+#include "ProceduralMultiShape.h"
+
+namespace Procedural
+{
+/**
+ * Computes boolean operations between two sets of closed shapes in a single pass.
+ * Any number of shapes can be given as subject and as clip, possibly overlapping or self-intersecting :
+ * the inside of each set is decided by a fill rule applied to its winding number.
+ * Shapes whose outside is on their left (SIDE_LEFT) are handled as if they were reversed, so holes can be expressed either way.
+ *
+ * The result is made of closed, non-overlapping shapes with the default SIDE_RIGHT outside :
+ * outer contours are counter-clockwise and holes are clockwise.
+ * <code>
+ * MultiShape merged = ShapeClipper().addSubject(shapes).setFillRule(ShapeClipper::FR_NON_ZERO).execute(ShapeClipper::CO_UNION);
+ * </code>
+ */
+class _ProceduralExport ShapeClipper
+{
+public:
+	/// Boolean operation applied to subject and clip
+	enum ClipOperation
+	{
+		CO_UNION, CO_INTERSECTION, CO_DIFFERENCE, CO_XOR
+	};
+
+	/// Decides whether a point is inside a set of shapes from its winding number
+	enum FillRule
+	{
+		/// Inside when the winding number is odd
+		FR_EVEN_ODD,
+		/// Inside when the winding number is not zero
+		FR_NON_ZERO,
+		/// Inside when the winding number is strictly positive
+		FR_POSITIVE,
+		/// Inside when the winding number is strictly negative
+		FR_NEGATIVE
+	};
+
+private:
+	std::vector<Shape> mShapes[2];
+	FillRule mFillRule;
+
+	bool _isFilled(int winding) const;
+	void _addShape(int group, const Shape& shape);
+
+public:
+	/// Default constructor, with the non-zero fill rule
+	ShapeClipper() : mFillRule(FR_NON_ZERO) {}
+
+	/// Adds a shape to the subject
+	/// @exception Ogre::InvalidParametersException Shape must be closed
+	ShapeClipper& addSubject(const Shape& shape)
+	{
+		_addShape(0, shape);
+		return *this;
+	}
+
+	/// Adds all the shapes of a multishape to the subject
+	/// @exception Ogre::InvalidParametersException Shapes must be closed
+	ShapeClipper& addSubject(const MultiShape& shapes)
+	{
+		for (unsigned int i = 0; i < shapes.getShapeCount(); ++i)
+			_addShape(0, shapes.getShape(i));
+		return *this;
+	}
+
+	/// Adds a shape to the clip
+	/// @exception Ogre::InvalidParametersException Shape must be closed
+	ShapeClipper& addClip(const Shape& shape)
+	{
+		_addShape(1, shape);
+		return *this;
+	}
+
+	/// Adds all the shapes of a multishape to the clip
+	/// @exception Ogre::InvalidParametersException Shapes must be closed
+	ShapeClipper& addClip(const MultiShape& shapes)
+	{
+		for (unsigned int i = 0; i < shapes.getShapeCount(); ++i)
+			_addShape(1, shapes.getShape(i));
+		return *this;
+	}
+
+	/// Sets the fill rule used for both subject and clip (default=FR_NON_ZERO)
+	ShapeClipper& setFillRule(FillRule fillRule)
+	{
+		mFillRule = fillRule;
+		return *this;
+	}
+
+	/// Removes all subject and clip shapes
+	void clear()
+	{
+		mShapes[0].clear();
+		mShapes[1].clear();
+	}
+
+	/**
+	 * Computes the operation between subject and clip.
+	 * With an empty clip, a union merges all the subject shapes together.
+	 * @param operation The boolean operation to apply
+	 * @return The contours of the result
+	 */
+	MultiShape execute(ClipOperation operation) const;
+};
+}
+#endif
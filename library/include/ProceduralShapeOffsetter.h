@@ -0,0 +1,130 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#ifndef PROCEDURAL_SHAPE_OFFSETTER_INCLUDED
+#define PROCEDURAL_SHAPE_OFFSETTER_INCLUDED
+
+#include "ProceduralPlatform.h"
+#include "ProceduralShape.h"
+#include "ProceduralMultiShape.h"
+
+namespace Procedural
+{
+/**
+ * Offsets the outlines of shapes by a given distance.
+ * Each outline is first offset on its own, then all of them are merged with ShapeClipper,
+ * which removes the loops created where the offset outline crosses itself or other outlines.
+ * The result uses the same conventions as ShapeClipper : outer contours are counter-clockwise and holes are clockwise.
+ * <code>
+ * MultiShape sidewalks = ShapeOffsetter().setJoinType(ShapeOffsetter::JT_ROUND).thicken(streets, 2);
+ * </code>
+ */
+class _ProceduralExport ShapeOffsetter
+{
+public:
+	/// Shape of the outline around convex corners
+	enum JoinType
+	{
+		/// Sharp corners, cut as with JT_SQUARE beyond the miter limit. Open ends are cut flat.
+		JT_MITER,
+		/// Circular arcs, within tolerance of the exact offset
+		JT_ROUND,
+		/// Corners cut at the offset distance. Open ends are extended by the offset distance.
+		JT_SQUARE
+	};
+
+private:
+	JoinType mJoinType;
+	Ogre::Real mMiterLimit;
+	Ogre::Real mTolerance;
+
+	void _offsetContour(const std::vector<Ogre::Vector2>& points, bool open, Ogre::Real delta, std::vector<Ogre::Vector2>& result) const;
+	void _addJoin(const Ogre::Vector2& point, const Ogre::Vector2& normal1, const Ogre::Vector2& normal2, Ogre::Real delta, bool cap, std::vector<Ogre::Vector2>& result) const;
+	MultiShape _merge(const std::vector<std::vector<Ogre::Vector2> >& contours) const;
+
+public:
+	/// Default constructor, with miter joins
+	ShapeOffsetter() : mJoinType(JT_MITER), mMiterLimit(2), mTolerance(.01f) {}
+
+	/// Sets how convex corners are joined (default=JT_MITER)
+	ShapeOffsetter& setJoinType(JoinType joinType)
+	{
+		mJoinType = joinType;
+		return *this;
+	}
+
+	/// Sets the maximal distance from a mitered corner to the original corner, as a multiple of the offset distance (default=2)
+	/// @exception Ogre::InvalidParametersException Miter limit must be at least 1
+	ShapeOffsetter& setMiterLimit(Ogre::Real miterLimit)
+	{
+		if (miterLimit < 1)
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Miter limit must be at least 1", "Procedural::ShapeOffsetter::setMiterLimit(Ogre::Real)");
+		mMiterLimit = miterLimit;
+		return *this;
+	}
+
+	/// Sets the maximal distance between round joins and the exact circular arcs (default=0.01)
+	/// @exception Ogre::InvalidParametersException Tolerance must be strictly positive
+	ShapeOffsetter& setTolerance(Ogre::Real tolerance)
+	{
+		if (tolerance <= 0)
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Tolerance must be strictly positive", "Procedural::ShapeOffsetter::setTolerance(Ogre::Real)");
+		mTolerance = tolerance;
+		return *this;
+	}
+
+	/**
+	 * Grows or shrinks the region inside closed shapes.
+	 * @param shapes The shapes to offset, which must be closed
+	 * @param delta The offset distance : positive values grow the region, negative values shrink it
+	 * @exception Ogre::InvalidParametersException All shapes must be closed
+	 */
+	MultiShape offset(const MultiShape& shapes, Ogre::Real delta) const;
+
+	/// Grows or shrinks the region inside a closed shape
+	/// @exception Ogre::InvalidParametersException Shape must be closed
+	MultiShape offset(const Shape& shape, Ogre::Real delta) const
+	{
+		return offset(MultiShape(shape), delta);
+	}
+
+	/**
+	 * Builds the region within a given distance of the outlines of shapes.
+	 * Closed shapes give rings, open shapes give strokes whose ends depend on the join type.
+	 * @param shapes The outlines to thicken
+	 * @param amount The distance on each side of the outlines
+	 */
+	MultiShape thicken(const MultiShape& shapes, Ogre::Real amount) const;
+
+	/// Builds the region within a given distance of the outline of a shape
+	MultiShape thicken(const Shape& shape, Ogre::Real amount) const
+	{
+		return thicken(MultiShape(shape), amount);
+	}
+};
+}
+#endif
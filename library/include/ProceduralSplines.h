@@ -29,6 +29,7 @@ THE SOFTWARE.
 #define PROCEDURAL_SPLINES_INCLUDED
 
 #include "Ogre.h"
+#include "ProceduralUtils.h"
 
 namespace Procedural
 {
@@ -89,38 +90,234 @@ void computeTangents(CubicHermiteSplineControlPoint<T>& point, const T& pointBef
 	}
 }
 
-// Computes the Cubic Hermite interpolation between 2 control points
-// Warning : does not compute auto-tangents, as AUTOTANGENT_CATMULL depend on context
-// Auto-Tangents should be computed before that call
+/**
+ * Evaluates a cubic Hermite curve between 2 positions, knowing the tangents at both ends
+ */
 template<class T>
-void computeCubicHermitePoints(const CubicHermiteSplineControlPoint<T>& pointBefore, const CubicHermiteSplineControlPoint<T>& pointAfter, unsigned int numSeg, std::vector<T>& pointList)
+struct CubicHermiteCurve
 {
-	const T& p0 = pointBefore.position;
-	const T& m0 = pointBefore.tangentAfter;
-	const T& p1 = pointAfter.position;
-	const T& m1 = pointAfter.tangentBefore;
+	T p0, m0, p1, m1;
 
-	for (unsigned int j = 0; j < numSeg; ++j)
+	CubicHermiteCurve(const T& position0, const T& tangent0, const T& position1, const T& tangent1) : p0(position0), m0(tangent0), p1(position1), m1(tangent1) {}
+
+	/// Gets the position at parameter t, in [0;1]
+	T operator()(Ogre::Real t) const
 	{
-		Ogre::Real t = (Ogre::Real)j/(Ogre::Real)numSeg;
 		Ogre::Real t2 = t*t;
 		Ogre::Real t3 = t2*t;
-		T P = (2*t3-3*t2+1)*p0+(t3-2*t2+t)*m0+(-2*t3+3*t2)*p1+(t3-t2)*m1;
-		pointList.push_back(P);
+		return (2*t3-3*t2+1)*p0+(t3-2*t2+t)*m0+(-2*t3+3*t2)*p1+(t3-t2)*m1;
 	}
-}
+};
 
+/**
+ * Evaluates a Catmull-Rom curve between the 2 middle points of 4 control points
+ */
 template<class T>
-void computeCatmullRomPoints(const T& P1, const T& P2, const T& P3, const T& P4, unsigned int numSeg, std::vector<T>& pointList)
+struct CatmullRomCurve
 {
-	for (unsigned int j = 0; j < numSeg; ++j)
+	T P1, P2, P3, P4;
+
+	CatmullRomCurve(const T& p1, const T& p2, const T& p3, const T& p4) : P1(p1), P2(p2), P3(p3), P4(p4) {}
+
+	/// Gets the position at parameter t, in [0;1]
+	T operator()(Ogre::Real t) const
 	{
-		Ogre::Real t = (Ogre::Real)j/(Ogre::Real)numSeg;
 		Ogre::Real t2 = t*t;
 		Ogre::Real t3 = t*t2;
-		T P = 0.5f*((-t3+2.f*t2-t)*P1 + (3.f*t3-5.f*t2+2.f)*P2 + (-3.f*t3+4.f*t2+t)*P3 + (t3-t2)*P4);
-		pointList.push_back(P);
+		return 0.5f*((-t3+2.f*t2-t)*P1 + (3.f*t3-5.f*t2+2.f)*P2 + (-3.f*t3+4.f*t2+t)*P3 + (t3-t2)*P4);
+	}
+};
+
+/**
+ * Evaluates a Bezier curve of any degree
+ */
+template<class T>
+struct BezierCurve
+{
+	const std::vector<T>& mPoints;
+	/// Binomial coefficients of the Bernstein polynomials
+	std::vector<Ogre::Real> mCoefs;
+
+	BezierCurve(const std::vector<T>& points) : mPoints(points), mCoefs(points.size(), 1)
+	{
+		size_t n = points.size() - 1;
+		for (size_t i = 1; i < n; ++i)
+			mCoefs[i] = mCoefs[i-1] * (n - i + 1) / i;
+	}
+
+	/// Gets the position at parameter t, in [0;1]
+	T operator()(Ogre::Real t) const
+	{
+		int n = (int)mPoints.size() - 1;
+		T P = mPoints[0] * 0;
+		for (int i = 0; i <= n; i++)
+			P += (mCoefs[i] * pow(t, i) * pow(1.0f - t, n - i)) * mPoints[i];
+		return P;
+	}
+};
+
+/**
+ * Cubic Hermite basis functions, tabulated once for a set of parameters.
+ * Catmull-Rom and Kochanek-Bartels spans are Hermite spans with particular tangents,
+ * so one table serves every span of a spline: evaluating a point then costs 4 multiply-adds per coordinate.
+ * Weights are stored in separate arrays, so that the evaluation loop can be vectorized by the compiler.
+ */
+class SplineBasisTable
+{
+	std::vector<Ogre::Real> mH00, mH10, mH01, mH11;
+
+	void _addParameter(Ogre::Real t)
+	{
+		Ogre::Real t2 = t*t;
+		Ogre::Real t3 = t2*t;
+		mH00.push_back(2*t3-3*t2+1);
+		mH10.push_back(t3-2*t2+t);
+		mH01.push_back(-2*t3+3*t2);
+		mH11.push_back(t3-t2);
+	}
+public:
+	/// Tabulates the parameters j/numSeg, for j in [0;numSeg[
+	explicit SplineBasisTable(unsigned int numSeg)
+	{
+		mH00.reserve(numSeg);
+		mH10.reserve(numSeg);
+		mH01.reserve(numSeg);
+		mH11.reserve(numSeg);
+		for (unsigned int j = 0; j < numSeg; ++j)
+			_addParameter((Ogre::Real)j/(Ogre::Real)numSeg);
+	}
+
+	/// Tabulates arbitrary parameters, in [0;1]
+	explicit SplineBasisTable(const std::vector<Ogre::Real>& parameters)
+	{
+		mH00.reserve(parameters.size());
+		mH10.reserve(parameters.size());
+		mH01.reserve(parameters.size());
+		mH11.reserve(parameters.size());
+		for (size_t j = 0; j < parameters.size(); ++j)
+			_addParameter(parameters[j]);
+	}
+
+	/// Gets the number of tabulated parameters
+	size_t size() const
+	{
+		return mH00.size();
+	}
+
+	/// Appends the points of a Hermite span at every tabulated parameter
+	template<class T>
+	void evaluate(const T& p0, const T& m0, const T& p1, const T& m1, std::vector<T>& pointList) const
+	{
+		size_t count = mH00.size();
+		if (count == 0)
+			return;
+		size_t first = pointList.size();
+		pointList.resize(first + count);
+		T* out = &pointList[first];
+		const Ogre::Real* h00 = &mH00[0];
+		const Ogre::Real* h10 = &mH10[0];
+		const Ogre::Real* h01 = &mH01[0];
+		const Ogre::Real* h11 = &mH11[0];
+		for (size_t j = 0; j < count; ++j)
+			out[j] = h00[j]*p0 + h10[j]*m0 + h01[j]*p1 + h11[j]*m1;
+	}
+};
+
+/// Squared distance from a point to the segment [a;b]
+template<class T>
+Ogre::Real squaredDistanceToSegment(const T& p, const T& a, const T& b)
+{
+	T ab = b - a;
+	Ogre::Real squaredLength = ab.squaredLength();
+	if (squaredLength == 0)
+		return (p - a).squaredLength();
+	Ogre::Real t = std::max((Ogre::Real)0, std::min((Ogre::Real)1, (p - a).dotProduct(ab) / squaredLength));
+	return (a + ab * t - p).squaredLength();
+}
+
+// Recursively splits [t0;t1] until the curve is close enough to its chord.
+// The curve is sampled at 1/4, 1/2 and 3/4 of the interval, so that an inflection in the middle of the interval is not missed.
+// Pushes every point but the last one.
+template<class T, class Curve>
+void subdivideCurve(const Curve& curve, Ogre::Real t0, const T& p0, Ogre::Real t1, const T& p1,
+                    Ogre::Real squaredTolerance, Ogre::Real cosAngleTolerance, unsigned int depthLeft, std::vector<T>& pointList)
+{
+	Ogre::Real tm = .5f * (t0 + t1);
+	T pm = curve(tm);
+	bool flat = depthLeft == 0;
+	if (!flat)
+	{
+		T d1 = pm - p0;
+		T d2 = p1 - pm;
+		flat = d1.dotProduct(d2) >= cosAngleTolerance * Ogre::Math::Sqrt(d1.squaredLength() * d2.squaredLength())
+		       && squaredDistanceToSegment(pm, p0, p1) <= squaredTolerance
+		       && squaredDistanceToSegment(curve(.5f * (t0 + tm)), p0, p1) <= squaredTolerance
+		       && squaredDistanceToSegment(curve(.5f * (tm + t1)), p0, p1) <= squaredTolerance;
 	}
+	if (flat)
+	{
+		pointList.push_back(p0);
+		return;
+	}
+	subdivideCurve(curve, t0, p0, tm, pm, squaredTolerance, cosAngleTolerance, depthLeft - 1, pointList);
+	subdivideCurve(curve, tm, pm, t1, p1, squaredTolerance, cosAngleTolerance, depthLeft - 1, pointList);
+}
+
+/**
+ * Computes the points of a curve between parameters 0 and 1, the point at parameter 1 being excluded.
+ * If tolerance is strictly positive, the curve is split until every part is closer than tolerance to its chord,
+ * and turns by less than about angleTolerance. Otherwise, numSeg evenly spaced parameters are used.
+ */
+template<class T, class Curve>
+void computeCurvePoints(const Curve& curve, unsigned int numSeg, Ogre::Real tolerance, Ogre::Radian angleTolerance, std::vector<T>& pointList)
+{
+	if (tolerance > 0)
+	{
+		subdivideCurve(curve, 0, curve(0), 1, curve(1), tolerance * tolerance, Ogre::Math::Cos(angleTolerance), 12, pointList);
+		return;
+	}
+	for (unsigned int j = 0; j < numSeg; ++j)
+		pointList.push_back(curve((Ogre::Real)j/(Ogre::Real)numSeg));
+}
+
+// Computes the Cubic Hermite interpolation between 2 control points
+// Warning : does not compute auto-tangents, as AUTOTANGENT_CATMULL depend on context
+// Auto-Tangents should be computed before that call
+template<class T>
+void computeCubicHermitePoints(const CubicHermiteSplineControlPoint<T>& pointBefore, const CubicHermiteSplineControlPoint<T>& pointAfter, unsigned int numSeg, std::vector<T>& pointList,
+                               Ogre::Real tolerance = 0, Ogre::Radian angleTolerance = Ogre::Radian(0))
+{
+	CubicHermiteCurve<T> curve(pointBefore.position, pointBefore.tangentAfter, pointAfter.position, pointAfter.tangentBefore);
+	computeCurvePoints(curve, numSeg, tolerance, angleTolerance, pointList);
+}
+
+// Same as above, using precomputed basis weights when tolerance is 0
+template<class T>
+void computeCubicHermitePoints(const CubicHermiteSplineControlPoint<T>& pointBefore, const CubicHermiteSplineControlPoint<T>& pointAfter, const SplineBasisTable& basis, std::vector<T>& pointList,
+                               Ogre::Real tolerance = 0, Ogre::Radian angleTolerance = Ogre::Radian(0))
+{
+	if (tolerance > 0)
+		computeCubicHermitePoints(pointBefore, pointAfter, (unsigned int)basis.size(), pointList, tolerance, angleTolerance);
+	else
+		basis.evaluate(pointBefore.position, pointBefore.tangentAfter, pointAfter.position, pointAfter.tangentBefore, pointList);
+}
+
+template<class T>
+void computeCatmullRomPoints(const T& P1, const T& P2, const T& P3, const T& P4, unsigned int numSeg, std::vector<T>& pointList,
+                             Ogre::Real tolerance = 0, Ogre::Radian angleTolerance = Ogre::Radian(0))
+{
+	computeCurvePoints(CatmullRomCurve<T>(P1, P2, P3, P4), numSeg, tolerance, angleTolerance, pointList);
+}
+
+// Same as above, using precomputed basis weights when tolerance is 0
+template<class T>
+void computeCatmullRomPoints(const T& P1, const T& P2, const T& P3, const T& P4, const SplineBasisTable& basis, std::vector<T>& pointList,
+                             Ogre::Real tolerance = 0, Ogre::Radian angleTolerance = Ogre::Radian(0))
+{
+	if (tolerance > 0)
+		computeCatmullRomPoints(P1, P2, P3, P4, (unsigned int)basis.size(), pointList, tolerance, angleTolerance);
+	else
+		basis.evaluate(P2, .5f*(P3-P1), P3, .5f*(P4-P2), pointList);
 }
 
 /**
@@ -147,21 +344,37 @@ struct KochanekBartelsSplineControlPoint
 	KochanekBartelsSplineControlPoint(const T& p) : position(p), tension(0.), bias(0.), continuity(0.) {}
 };
 
+// Computes the tangents of the Kochanek-Bartels span between P2 and P3
+template<class T>
+void computeKochanekBartelsTangents(const KochanekBartelsSplineControlPoint<T>& P1, const KochanekBartelsSplineControlPoint<T>& P2,
+                                    const KochanekBartelsSplineControlPoint<T>& P3, const KochanekBartelsSplineControlPoint<T>& P4, T& m0, T& m1)
+{
+	m0 = (1-P2.tension)*(1+P2.bias)*(1+P2.continuity)/2.f*(P2.position-P1.position)+(1-P2.tension)*(1-P2.bias)*(1-P2.continuity)/2.f*(P3.position-P2.position);
+	m1 = (1-P3.tension)*(1+P3.bias)*(1-P3.continuity)/2.f*(P3.position-P2.position)+(1-P3.tension)*(1-P3.bias)*(1+P3.continuity)/2.f*(P4.position-P3.position);
+}
+
 template<class T>
 void computeKochanekBartelsPoints(const KochanekBartelsSplineControlPoint<T>& P1, const KochanekBartelsSplineControlPoint<T>& P2,
-                                  const KochanekBartelsSplineControlPoint<T>& P3, const KochanekBartelsSplineControlPoint<T>& P4, unsigned int numSeg, std::vector<T>& pointList)
+                                  const KochanekBartelsSplineControlPoint<T>& P3, const KochanekBartelsSplineControlPoint<T>& P4, unsigned int numSeg, std::vector<T>& pointList,
+                                  Ogre::Real tolerance = 0, Ogre::Radian angleTolerance = Ogre::Radian(0))
 {
-	Ogre::Vector2 m0 = (1-P2.tension)*(1+P2.bias)*(1+P2.continuity)/2.f*(P2.position-P1.position)+(1-P2.tension)*(1-P2.bias)*(1-P2.continuity)/2.f*(P3.position-P2.position);
-	Ogre::Vector2 m1 = (1-P3.tension)*(1+P3.bias)*(1-P3.continuity)/2.f*(P3.position-P2.position)+(1-P3.tension)*(1-P3.bias)*(1+P3.continuity)/2.f*(P4.position-P3.position);
+	T m0, m1;
+	computeKochanekBartelsTangents(P1, P2, P3, P4, m0, m1);
+	computeCurvePoints(CubicHermiteCurve<T>(P2.position, m0, P3.position, m1), numSeg, tolerance, angleTolerance, pointList);
+}
 
-	for (unsigned int j = 0; j < numSeg; ++j)
-	{
-		Ogre::Real t = (Ogre::Real)j/(Ogre::Real)numSeg;
-		Ogre::Real t2 = t*t;
-		Ogre::Real t3 = t2*t;
-		T P = (2*t3-3*t2+1)*P2.position+(t3-2*t2+t)*m0+(-2*t3+3*t2)*P3.position+(t3-t2)*m1;
-		pointList.push_back(P);
-	}
+// Same as above, using precomputed basis weights when tolerance is 0
+template<class T>
+void computeKochanekBartelsPoints(const KochanekBartelsSplineControlPoint<T>& P1, const KochanekBartelsSplineControlPoint<T>& P2,
+                                  const KochanekBartelsSplineControlPoint<T>& P3, const KochanekBartelsSplineControlPoint<T>& P4, const SplineBasisTable& basis, std::vector<T>& pointList,
+                                  Ogre::Real tolerance = 0, Ogre::Radian angleTolerance = Ogre::Radian(0))
+{
+	T m0, m1;
+	computeKochanekBartelsTangents(P1, P2, P3, P4, m0, m1);
+	if (tolerance > 0)
+		computeCurvePoints(CubicHermiteCurve<T>(P2.position, m0, P3.position, m1), (unsigned int)basis.size(), tolerance, angleTolerance, pointList);
+	else
+		basis.evaluate(P2.position, m0, P3.position, m1, pointList);
 }
 }
 
@@ -48,6 +48,30 @@ public:
 	{
 	    AM_ABSOLUTE_LINEIC, AM_RELATIVE_LINEIC, AM_POINT
 	};
+
+	/// Key/value couples, sorted by key
+	typedef std::vector<std::pair<Ogre::Real, Ogre::Real> > KeyFrameList;
+
+	/**
+	 * Reads values of a track at successive positions.
+	 * When positions increase, each lookup only moves forward from the previous one, instead of searching the whole track.
+	 * Other positions are still correct, but searched again. The track must not be modified while the evaluator is in use.
+	 */
+	class _ProceduralExport Evaluator
+	{
+		const Track& mTrack;
+		/// Number of keys not greater than the last position
+		size_t mUpper;
+	public:
+		/// Constructor
+		Evaluator(const Track& track) : mTrack(track), mUpper(0) {}
+
+		/// Gets the value at a position
+		Ogre::Real getValue(Ogre::Real pos);
+
+		/// Gets the value on the current point, taking into account the addressing mode
+		Ogre::Real getValue(Ogre::Real absPos, Ogre::Real relPos, unsigned int index);
+	};
 protected:
 	/// Adressing mode of the track (see the enum definition for more details)
 	AddressingMode mAddressingMode;
@@ -55,8 +79,11 @@ protected:
 	/// Tells whether we should add new points to principal curve if a key is defined here but not on principal curve
 	bool mInsertPoint;
 
-	/// Key frames
-	std::map<Ogre::Real, Ogre::Real> mKeyFrames;
+	/// Key frames, in a contiguous array sorted by key
+	KeyFrameList mKeyFrames;
+
+	/// Gets the value at a position, knowing the number of keys not greater than this position
+	Ogre::Real _interpolate(Ogre::Real pos, size_t upper) const;
 public:
 	/// Default constructor.
 	/// Point insertion default to true, and addressing to relative lineic
@@ -69,12 +96,28 @@ public:
 	}
 
 	/// Inserts a new Key/Value couple anywhere on the track (it is auto-sorted anyway)
+	/// Replaces the value if there is already a key at that position
 	inline Track& addKeyFrame(Ogre::Real pos, Ogre::Real value)
 	{
-		mKeyFrames[pos] = value;
+		if (mKeyFrames.empty() || mKeyFrames.back().first < pos)
+		{
+			mKeyFrames.push_back(std::make_pair(pos, value));
+			return *this;
+		}
+		KeyFrameList::iterator it = std::lower_bound(mKeyFrames.begin(), mKeyFrames.end(), std::make_pair(pos, -Ogre::Math::POS_INFINITY));
+		if (it != mKeyFrames.end() && it->first == pos)
+			it->second = value;
+		else
+			mKeyFrames.insert(it, std::make_pair(pos, value));
 		return *this;
 	}
 
+	/// Gets the key frames, sorted by key
+	inline const KeyFrameList& getKeyFrames() const
+	{
+		return mKeyFrames;
+	}
+
 	/// @copydoc Track::mInsertPoint
 	inline bool isInsertPoint() const
 	{
@@ -87,32 +130,39 @@ public:
 	/// Gets the value on the current point
 	Ogre::Real getValue(Ogre::Real pos) const;
 
+	/**
+	 * Gets the values at several positions, in one pass over the track if positions are sorted
+	 * @param positions the positions to evaluate
+	 * @param values receives the value at each position
+	 */
+	void getValues(const std::vector<Ogre::Real>& positions, std::vector<Ogre::Real>& values) const;
+
 	/// Get the key value couple before current point, taking into account addressing mode.
 	/// If current point is below minimum key, issues minimum key
-	std::map<Ogre::Real, Ogre::Real>::const_iterator _getKeyValueBefore(Ogre::Real absPos, Ogre::Real relPos, unsigned int index) const;
+	KeyFrameList::const_iterator _getKeyValueBefore(Ogre::Real absPos, Ogre::Real relPos, unsigned int index) const;
 
 	/// Get the key value couple before current point.
 	/// If current point is below minimum key, issues minimum key/value
-	std::map<Ogre::Real, Ogre::Real>::const_iterator _getKeyValueBefore(Ogre::Real pos) const;
+	KeyFrameList::const_iterator _getKeyValueBefore(Ogre::Real pos) const;
 
 	/// Get the key value couple after current point, taking into account addressing mode.
 	/// If current point is above maximum key, issues maximum key/value
-	std::map<Ogre::Real, Ogre::Real>::const_iterator _getKeyValueAfter(Ogre::Real absPos, Ogre::Real relPos, unsigned int index) const;
+	KeyFrameList::const_iterator _getKeyValueAfter(Ogre::Real absPos, Ogre::Real relPos, unsigned int index) const;
 
 	/// Get the key value couple after current point.
 	/// If current point is above maximum key, issues maximum key/value
-	std::map<Ogre::Real, Ogre::Real>::const_iterator _getKeyValueAfter(Ogre::Real pos) const;
+	KeyFrameList::const_iterator _getKeyValueAfter(Ogre::Real pos) const;
 
 	/// Gets the first value in the track
 	Ogre::Real getFirstValue() const
 	{
-		return mKeyFrames.begin()->second;
+		return mKeyFrames.front().second;
 	}
 
 	/// Gets the last value in the track
 	Ogre::Real getLastValue() const
 	{
-		return (--mKeyFrames.end())->second;
+		return mKeyFrames.back().second;
 	}
 };
 //---------------------------------------------------
@@ -202,6 +202,40 @@ public:
 	{
 		return Ogre::Vector2(rect.left + input.x*rect.width(), rect.top + input.y*rect.height());
 	}
+
+	/**
+	 * Finds the segment of a polyline containing a lineic coordinate, by binary search
+	 * @param lineicPositions lineic position of each point, as given by Path::getLineicPositions
+	 * @param coord lineic coordinate, clamped to the polyline or wrapped around it if it loops
+	 * @param loop whether the coordinates beyond the end start again from the beginning
+	 * @param segmentCoord receives the position on the segment, between 0 and 1
+	 * @return the index of the segment
+	 */
+	static size_t findLineicSegment(const std::vector<Ogre::Real>& lineicPositions, Ogre::Real coord, bool loop, Ogre::Real& segmentCoord);
+
+	/**
+	 * Computes the number of segments needed to approximate a circle arc.
+	 * If tolerance is strictly positive, the sagitta of every segment is below tolerance and it turns by less than angleTolerance,
+	 * within the limit of maxSeg segments. Otherwise, numSeg is returned.
+	 */
+	static inline unsigned int computeArcSegmentCount(Ogre::Real radius, Ogre::Radian angle, unsigned int numSeg, Ogre::Real tolerance, Ogre::Radian angleTolerance,
+	                                                  unsigned int maxSeg = 4096)
+	{
+		if (tolerance <= 0)
+			return numSeg;
+		Ogre::Real absAngle = Ogre::Math::Abs(angle.valueRadians());
+		Ogre::Real count = absAngle / angleTolerance.valueRadians();
+		if (tolerance < radius)
+		{
+			// Angle of a chord whose sagitta is tolerance, 2*acos(1-tolerance/radius), written so that it doesn't round to 0 for tiny tolerances
+			Ogre::Real chordAngle = 4 * Ogre::Math::ASin(Ogre::Math::Sqrt(.5f * tolerance / radius)).valueRadians();
+			count = std::max(count, absAngle / chordAngle);
+		}
+		// Also catches the infinite count of a tolerance so small it underflows
+		if (!(count < maxSeg))
+			return maxSeg;
+		return std::max(1u, (unsigned int)Ogre::Math::Ceil(count));
+	}
 };
 }
 #endif
@@ -65,101 +65,229 @@ inline Segment2D projectOnAxis(const Segment3D& input, const Vector3& origin, co
 }
 //-----------------------------------------------------------------------
 
-struct Seg3Comparator
+/// Edge to triangle adjacency of a triangle buffer, built over welded vertex ids.
+/// Removing a triangle from the lookup is O(1).
+class TriLookup
 {
+	std::vector<int> mCorners;
+	std::vector<int> mEntryTriangle;
+	std::vector<int> mEntryNext;
+	std::vector<int> mEdgeFirstEntry;
+	std::vector<int> mEdgeLastEntry;
+	std::vector<bool> mRemoved;
+	IndexHashMap mEdges;
+
+	void _addEdge(int i1, int i2, int triangle)
+	{
+		int edge = mEdges.insert(IndexHashMap::pairKey(i1, i2), (int)mEdgeFirstEntry.size());
+		int entry = (int)mEntryTriangle.size();
+		mEntryTriangle.push_back(triangle);
+		mEntryNext.push_back(-1);
+		if (edge == (int)mEdgeFirstEntry.size())
+		{
+			mEdgeFirstEntry.push_back(entry);
+			mEdgeLastEntry.push_back(entry);
+		}
+		else
+		{
+			mEntryNext[mEdgeLastEntry[edge]] = entry;
+			mEdgeLastEntry[edge] = entry;
+		}
+	}
 
-	bool operator()(const Segment3D& one, const Segment3D& two) const
+public:
+	void build(const TriangleBuffer& mesh, Vector3Welder& welder)
 	{
-		if (one.epsilonEquivalent(two)) return false;
+		const std::vector<TriangleBuffer::Vertex>& vec = mesh.getVertices();
+		const std::vector<int>& ind = mesh.getIndices();
+		int numTriangles = (int)ind.size() / 3;
+		mCorners.resize(numTriangles * 3);
+		for (int i = 0; i < numTriangles * 3; i++)
+			mCorners[i] = welder.weld(vec[ind[i]].mPosition);
+		mEdges.reserve(numTriangles * 3 / 2 + 1);
+		mEntryTriangle.reserve(numTriangles * 3);
+		mEntryNext.reserve(numTriangles * 3);
+		mRemoved.assign(numTriangles, false);
+		for (int i = 0; i < numTriangles; i++)
+		{
+			_addEdge(mCorners[i * 3], mCorners[i * 3 + 1], i);
+			_addEdge(mCorners[i * 3], mCorners[i * 3 + 2], i);
+			_addEdge(mCorners[i * 3 + 1], mCorners[i * 3 + 2], i);
+		}
+	}
 
-		if (one.mA.squaredDistance(two.mA) > 1e-6)
-			return Vector3Comparator()(one.mA, two.mA);
-		return Vector3Comparator()(one.mB, two.mB);
+	/// Gets the welded vertex id of a triangle corner
+	inline int getCorner(int triangle, int k) const
+	{
+		return mCorners[triangle * 3 + k];
 	}
-};
-//-----------------------------------------------------------------------
-typedef std::multimap<Segment3D, int, Seg3Comparator> TriLookup;
 
-void _removeFromTriLookup(int k, TriLookup& lookup)
-{
-	for (std::multimap<Segment3D, int, Seg3Comparator>::iterator it2 = lookup.begin(); it2 != lookup.end();)
+	/// Finds the first and the last triangles still in the lookup sharing that edge, or -1 if there's none
+	void findTriangles(int i1, int i2, int& first, int& last) const
+	{
+		first = last = -1;
+		int edge = mEdges.find(IndexHashMap::pairKey(i1, i2));
+		if (edge == -1)
+			return;
+		for (int entry = mEdgeFirstEntry[edge]; entry != -1; entry = mEntryNext[entry])
+			if (!mRemoved[mEntryTriangle[entry]])
+			{
+				if (first == -1)
+					first = mEntryTriangle[entry];
+				last = mEntryTriangle[entry];
+			}
+	}
+
+	/// Finds the first triangle still in the lookup sharing that edge, or -1 if there's none
+	int findTriangle(int i1, int i2) const
 	{
-		std::multimap<Segment3D, int, Seg3Comparator>::iterator removeIt = it2++;
-		if (removeIt->second == k)
-			lookup.erase(removeIt);
+		int edge = mEdges.find(IndexHashMap::pairKey(i1, i2));
+		if (edge == -1)
+			return -1;
+		for (int entry = mEdgeFirstEntry[edge]; entry != -1; entry = mEntryNext[entry])
+			if (!mRemoved[mEntryTriangle[entry]])
+				return mEntryTriangle[entry];
+		return -1;
 	}
-}
+
+	/// Removes a triangle from the lookup (-1 is ignored)
+	inline void remove(int triangle)
+	{
+		if (triangle != -1)
+			mRemoved[triangle] = true;
+	}
+};
 //-----------------------------------------------------------------------
 
-void _recursiveAddNeighbour(TriangleBuffer& result, const TriangleBuffer& source, int triNumber, TriLookup& lookup, const std::set<Segment3D, Seg3Comparator>& limits, bool inverted)
+void _addNeighbours(TriangleBuffer& result, const TriangleBuffer& source, int seed, TriLookup& lookup, const IndexHashMap& limits, bool inverted)
 {
-	if (triNumber == -1)
+	if (seed == -1)
 		return;
-	Utils::log("tri " + StringConverter::toString(triNumber));
 	const std::vector<int>& ind = source.getIndices();
 	const std::vector<TriangleBuffer::Vertex>& vec = source.getVertices();
-	result.rebaseOffset();
-	if (inverted)
-	{
-		result.triangle(0, 2, 1);
-		TriangleBuffer::Vertex v = vec[ind[triNumber * 3]];
-		v.mNormal = -v.mNormal;
-		result.vertex(v);
-		v = vec[ind[triNumber * 3+1]];
-		v.mNormal = -v.mNormal;
-		result.vertex(v);
-		v = vec[ind[triNumber * 3+2]];
-		v.mNormal = -v.mNormal;
-		result.vertex(v);
-	}
-	else
+
+	// Depth-first flood fill with an explicit stack, visiting triangles in the same order as a recursive traversal would.
+	// Triangles are removed from the lookup as soon as they're discovered, so each one is only added once.
+	std::vector<int> stack;
+	stack.push_back(seed);
+	while (!stack.empty())
 	{
-		result.triangle(0, 1, 2);
-		result.vertex(vec[ind[triNumber * 3]]);
-		result.vertex(vec[ind[triNumber * 3 + 1]]);
-		result.vertex(vec[ind[triNumber * 3 + 2]]);
-	}
+		int triNumber = stack.back();
+		stack.pop_back();
 
-	//Utils::log("vertex " + StringConverter::toString(vec[ind[triNumber*3]].mPosition));
-	//Utils::log("vertex " + StringConverter::toString(vec[ind[triNumber*3+1]].mPosition));
-	//Utils::log("vertex " + StringConverter::toString(vec[ind[triNumber*3+2]].mPosition));
+		result.rebaseOffset();
+		if (inverted)
+		{
+			result.triangle(0, 2, 1);
+			TriangleBuffer::Vertex v = vec[ind[triNumber * 3]];
+			v.mNormal = -v.mNormal;
+			result.vertex(v);
+			v = vec[ind[triNumber * 3+1]];
+			v.mNormal = -v.mNormal;
+			result.vertex(v);
+			v = vec[ind[triNumber * 3+2]];
+			v.mNormal = -v.mNormal;
+			result.vertex(v);
+		}
+		else
+		{
+			result.triangle(0, 1, 2);
+			result.vertex(vec[ind[triNumber * 3]]);
+			result.vertex(vec[ind[triNumber * 3 + 1]]);
+			result.vertex(vec[ind[triNumber * 3 + 2]]);
+		}
 
-	std::multimap<Segment3D, int, Seg3Comparator>::iterator it;
+		static const int edgeCorners[3][2] = {{0, 1}, {1, 2}, {0, 2}};
+		int nextTriangles[3];
+		for (int k = 0; k < 3; k++)
+		{
+			int i1 = lookup.getCorner(triNumber, edgeCorners[k][0]);
+			int i2 = lookup.getCorner(triNumber, edgeCorners[k][1]);
+			nextTriangles[k] = -1;
+			// Stop when a contour is touched
+			if (limits.find(IndexHashMap::pairKey(i1, i2)) != -1)
+				continue;
+			nextTriangles[k] = lookup.findTriangle(i1, i2);
+			lookup.remove(nextTriangles[k]);
+		}
+		for (int k = 2; k >= 0; k--)
+			if (nextTriangles[k] != -1)
+				stack.push_back(nextTriangles[k]);
+	}
+}
+//-----------------------------------------------------------------------
 
-	int nextTriangle1 = -1;
-	int nextTriangle2 = -1;
-	int nextTriangle3 = -1;
-	it = lookup.find(Segment3D(vec[ind[triNumber * 3]].mPosition, vec[ind[triNumber * 3 + 1]].mPosition).orderedCopy());
-	//if (it != lookup.end() && limits.find(it->first.orderedCopy()) != limits.end())
-	//	Utils::log("Cross limit1");
+/// Result of the retriangulation of a single intersected triangle
+struct RetriangulatedTriangle
+{
+	std::vector<int> mIndices;
+	std::vector<TriangleBuffer::Vertex> mVertices;
+};
+//-----------------------------------------------------------------------
 
-	if (it != lookup.end() && limits.find(it->first.orderedCopy()) == limits.end())
-	{
-		nextTriangle1 = it->second;
-		_removeFromTriLookup(nextTriangle1, lookup);
-	}
-	it = lookup.find(Segment3D(vec[ind[triNumber * 3 + 1]].mPosition, vec[ind[triNumber * 3 + 2]].mPosition).orderedCopy());
-	//if (it != lookup.end() && limits.find(it->first.orderedCopy()) != limits.end())
-	//Utils::log("Cross limit2");
+/// Per-thread buffers reused from one intersected triangle to the next
+struct RetriangulationScratch
+{
+	Triangulator mTriangulator;
+	std::vector<Segment2D> mSegments;
+	PointList mPointList;
+};
+//-----------------------------------------------------------------------
 
-	if (it != lookup.end() && limits.find(it->first.orderedCopy()) == limits.end())
+void _retriangulateTriangle(RetriangulatedTriangle& output, RetriangulationScratch& scratch, const TriangleBuffer& inputMesh, int triIndex, const std::vector<Segment3D>& segments)
+{
+	const std::vector<TriangleBuffer::Vertex>& vec = inputMesh.getVertices();
+	const std::vector<int>& ind = inputMesh.getIndices();
+	Vector3 v1 = vec[ind[triIndex * 3]].mPosition;
+	Vector3 v2 = vec[ind[triIndex * 3+1]].mPosition;
+	Vector3 v3 = vec[ind[triIndex * 3+2]].mPosition;
+	Vector3 triNormal = ((v2-v1).crossProduct(v3-v1)).normalisedCopy();
+	Vector3 xAxis = triNormal.perpendicular();
+	Vector3 yAxis = triNormal.crossProduct(xAxis);
+	Vector3 planeOrigin = vec[ind[triIndex * 3]].mPosition;
+
+	// Project intersection segments onto triangle plane
+	std::vector<Segment2D>& segments2 = scratch.mSegments;
+	segments2.clear();
+	for (std::vector<Segment3D>::const_iterator it2 = segments.begin(); it2 != segments.end(); it2++)
 	{
-		nextTriangle2 = it->second;
-		_removeFromTriLookup(nextTriangle2, lookup);
+		Segment2D seg = projectOnAxis(*it2, planeOrigin, xAxis, yAxis);
+		if ((seg.mA - seg.mB).squaredLength() >= 1e-5)
+			segments2.push_back(seg);
 	}
-	it = lookup.find(Segment3D(vec[ind[triNumber * 3]].mPosition, vec[ind[triNumber * 3 + 2]].mPosition).orderedCopy());
-	//if (it != lookup.end() && limits.find(it->first.orderedCopy()) != limits.end())
-	//	Utils::log("Cross limit3");
-	if (it != lookup.end() && limits.find(it->first.orderedCopy()) == limits.end())
+
+	// Triangulate
+	Triangle2D tri(projectOnAxis(vec[ind[triIndex * 3]].mPosition, planeOrigin, xAxis, yAxis),
+	               projectOnAxis(vec[ind[triIndex * 3 + 1]].mPosition, planeOrigin, xAxis, yAxis),
+	               projectOnAxis(vec[ind[triIndex * 3 + 2]].mPosition, planeOrigin, xAxis, yAxis));
+	PointList& outPointList = scratch.mPointList;
+	outPointList.clear();
+	output.mIndices.clear();
+	scratch.mTriangulator.setManualSuperTriangle(&tri).setRemoveOutside(false).setSegmentListToTriangulate(&segments2).triangulate(output.mIndices, outPointList);
+
+	// Deproject
+	Real x1 = tri.mPoints[0].x;
+	Real y1 = tri.mPoints[0].y;
+	Vector2 uv1 = vec[ind[triIndex * 3]].mUV;
+	Real x2 = tri.mPoints[1].x;
+	Real y2 = tri.mPoints[1].y;
+	Vector2 uv2 = vec[ind[triIndex * 3 + 1]].mUV;
+	Real x3 = tri.mPoints[2].x;
+	Real y3 = tri.mPoints[2].y;
+	Vector2 uv3 = vec[ind[triIndex * 3 + 2]].mUV;
+	Real DET = x1 * y2 - x2 * y1 + x2 * y3 - x3 * y2 + x3 * y1 - x1*y3;
+	Vector2 A = ((y2 - y3) * uv1 + (y3 - y1) * uv2 + (y1 - y2) * uv3) / DET;
+	Vector2 B = ((x3 - x2) * uv1 + (x1 - x3) * uv2 + (x2 - x1) * uv3) / DET;
+	Vector2 C = ((x2 * y3 - x3 * y2) * uv1 + (x3 * y1 - x1 * y3) * uv2 + (x1 * y2 - x2 * y1) * uv3) / DET;
+
+	output.mVertices.resize(outPointList.size());
+	for (size_t i = 0; i < outPointList.size(); ++i)
 	{
-		nextTriangle3 = it->second;
-		_removeFromTriLookup(nextTriangle3, lookup);
+		TriangleBuffer::Vertex& v = output.mVertices[i];
+		v.mPosition = deprojectOnAxis(outPointList[i], planeOrigin, xAxis, yAxis);
+		v.mNormal = triNormal;
+		v.mUV = A * outPointList[i].x + B * outPointList[i].y + C;
 	}
-	//Utils::log("add " + StringConverter::toString(nextTriangle1) + " ," + StringConverter::toString(nextTriangle2) + " ,"+StringConverter::toString(nextTriangle3) );
-
-	_recursiveAddNeighbour(result, source, nextTriangle1, lookup, limits, inverted);
-	_recursiveAddNeighbour(result, source, nextTriangle2, lookup, limits, inverted);
-	_recursiveAddNeighbour(result, source, nextTriangle3, lookup, limits, inverted);
 }
 //-----------------------------------------------------------------------
 
@@ -169,104 +297,233 @@ void _retriangulate(TriangleBuffer& newMesh, const TriangleBuffer& inputMesh, co
 	const std::vector<int>& ind = inputMesh.getIndices();
 	// Triangulate
 	//  Group intersections by triangle indice
-	std::map<int, std::vector<Segment3D> > meshIntersects;
+	typedef std::map<int, std::vector<Segment3D> > IntersectionMap;
+	IntersectionMap meshIntersects;
 	for (std::vector<Intersect>::const_iterator it = intersectionList.begin(); it != intersectionList.end(); ++it)
-	{
-		std::map<int, std::vector<Segment3D> >::iterator it2;
-		if (first)
-			it2 = meshIntersects.find(it->mTri1);
-		else
-			it2 = meshIntersects.find(it->mTri2);
-		if (it2 != meshIntersects.end())
-			it2->second.push_back(it->mSeg);
-		else
-		{
-			std::vector<Segment3D> vec;
-			vec.push_back(it->mSeg);
-			if (first)
-				meshIntersects[it->mTri1] = vec;
-			else
-				meshIntersects[it->mTri2] = vec;
-		}
-	}
+		meshIntersects[first ? it->mTri1 : it->mTri2].push_back(it->mSeg);
+
 	// Build a new TriangleBuffer holding non-intersected triangles and retriangulated-intersected triangles
 	for (std::vector<TriangleBuffer::Vertex>::const_iterator it = vec.begin(); it != vec.end(); ++it)
 		newMesh.vertex(*it);
 	for (int i = 0; i < (int)ind.size() / 3; i++)
 		if (meshIntersects.find(i) == meshIntersects.end())
 			newMesh.triangle(ind[i * 3], ind[i * 3 + 1], ind[i * 3 + 2]);
-	int numNonIntersected1 = newMesh.getIndices().size();
-	for (std::map<int, std::vector<Segment3D> >::iterator it = meshIntersects.begin(); it != meshIntersects.end(); ++it)
+
+	// Each intersected triangle is retriangulated independently from the others
+	std::vector<IntersectionMap::const_iterator> intersectedTriangles;
+	intersectedTriangles.reserve(meshIntersects.size());
+	for (IntersectionMap::const_iterator it = meshIntersects.begin(); it != meshIntersects.end(); ++it)
+		intersectedTriangles.push_back(it);
+	int numIntersected = (int)intersectedTriangles.size();
+	std::vector<RetriangulatedTriangle> results(numIntersected);
+
+#ifdef PROCEDURAL_USE_OPENMP
+	// Exceptions can't cross the parallel region : failed triangles are re-run serially below, so that they throw from there
+	std::vector<char> failed(numIntersected, 0);
+	#pragma omp parallel
+	{
+		RetriangulationScratch scratch;
+		#pragma omp for schedule(dynamic, 16)
+		for (int i = 0; i < numIntersected; i++)
+		{
+			try
+			{
+				_retriangulateTriangle(results[i], scratch, inputMesh, intersectedTriangles[i]->first, intersectedTriangles[i]->second);
+			}
+			catch (...)
+			{
+				failed[i] = 1;
+			}
+		}
+	}
+	RetriangulationScratch scratch;
+	for (int i = 0; i < numIntersected; i++)
+		if (failed[i])
+			_retriangulateTriangle(results[i], scratch, inputMesh, intersectedTriangles[i]->first, intersectedTriangles[i]->second);
+#else
+	RetriangulationScratch scratch;
+	for (int i = 0; i < numIntersected; i++)
+		_retriangulateTriangle(results[i], scratch, inputMesh, intersectedTriangles[i]->first, intersectedTriangles[i]->second);
+#endif
+
+	// Concatenate in triangle order, so that the output doesn't depend on scheduling
+	size_t extraVertexCount = 0, extraIndexCount = 0;
+	for (int i = 0; i < numIntersected; i++)
+	{
+		extraVertexCount += results[i].mVertices.size();
+		extraIndexCount += results[i].mIndices.size();
+	}
+	newMesh.estimateVertexCount(extraVertexCount);
+	newMesh.estimateIndexCount(extraIndexCount);
+	for (int i = 0; i < numIntersected; i++)
 	{
-		std::vector<Segment3D>& segments = it->second;
-		int triIndex = it->first;
-		Vector3 v1 = vec[ind[triIndex * 3]].mPosition;
-		Vector3 v2 = vec[ind[triIndex * 3+1]].mPosition;
-		Vector3 v3 = vec[ind[triIndex * 3+2]].mPosition;
-		Vector3 triNormal = ((v2-v1).crossProduct(v3-v1)).normalisedCopy();
-		Vector3 xAxis = triNormal.perpendicular();
-		Vector3 yAxis = triNormal.crossProduct(xAxis);
-		Vector3 planeOrigin = vec[ind[triIndex * 3]].mPosition;
-
-		// Project intersection segments onto triangle plane
-		std::vector<Segment2D> segments2;
-
-		for (std::vector<Segment3D>::iterator it2 = segments.begin(); it2 != segments.end(); it2++)
-			segments2.push_back(projectOnAxis(*it2, planeOrigin, xAxis, yAxis));
-		for (std::vector<Segment2D>::iterator it2 = segments2.begin(); it2 != segments2.end();)
-			if ((it2->mA - it2->mB).squaredLength() < 1e-5)
-				it2 = segments2.erase(it2);
-			else
-				it2++;
-
-		// Triangulate
-		Triangulator t;
-		Triangle2D tri(projectOnAxis(vec[ind[triIndex * 3]].mPosition, planeOrigin, xAxis, yAxis),
-		               projectOnAxis(vec[ind[triIndex * 3 + 1]].mPosition, planeOrigin, xAxis, yAxis),
-		               projectOnAxis(vec[ind[triIndex * 3 + 2]].mPosition, planeOrigin, xAxis, yAxis));
-		PointList outPointList;
-		std::vector<int> outIndice;
-		t.setManualSuperTriangle(&tri).setRemoveOutside(false).setSegmentListToTriangulate(&segments2).triangulate(outIndice, outPointList);
-
-		// Deproject and add to triangleBuffer
 		newMesh.rebaseOffset();
-		for (std::vector<int>::iterator it = outIndice.begin(); it != outIndice.end(); ++it)
+		for (std::vector<int>::const_iterator it = results[i].mIndices.begin(); it != results[i].mIndices.end(); ++it)
 			newMesh.index(*it);
-		Real x1 = tri.mPoints[0].x;
-		Real y1 = tri.mPoints[0].y;
-		Vector2 uv1 = vec[ind[triIndex * 3]].mUV;
-		Real x2 = tri.mPoints[1].x;
-		Real y2 = tri.mPoints[1].y;
-		Vector2 uv2 = vec[ind[triIndex * 3 + 1]].mUV;
-		Real x3 = tri.mPoints[2].x;
-		Real y3 = tri.mPoints[2].y;
-		Vector2 uv3 = vec[ind[triIndex * 3 + 2]].mUV;
-		Real DET = x1 * y2 - x2 * y1 + x2 * y3 - x3 * y2 + x3 * y1 - x1*y3;
-		Vector2 A = ((y2 - y3) * uv1 + (y3 - y1) * uv2 + (y1 - y2) * uv3) / DET;
-		Vector2 B = ((x3 - x2) * uv1 + (x1 - x3) * uv2 + (x2 - x1) * uv3) / DET;
-		Vector2 C = ((x2 * y3 - x3 * y2) * uv1 + (x3 * y1 - x1 * y3) * uv2 + (x1 * y2 - x2 * y1) * uv3) / DET;
-
-		for (std::vector<Vector2>::iterator it = outPointList.begin(); it != outPointList.end(); ++it)
+		for (std::vector<TriangleBuffer::Vertex>::const_iterator it = results[i].mVertices.begin(); it != results[i].mVertices.end(); ++it)
+			newMesh.vertex(*it);
+	}
+}
+//-----------------------------------------------------------------------
+
+/// Groups the triangles of a mesh into connected components, triangles being connected when they share a vertex position
+void _findComponents(const TriangleBuffer& mesh, std::vector<std::vector<int> >& components)
+{
+	const std::vector<int>& ind = mesh.getIndices();
+	const std::vector<TriangleBuffer::Vertex>& vec = mesh.getVertices();
+	Vector3Welder welder;
+	welder.reserve(vec.size());
+	std::vector<int> welded(vec.size());
+	for (size_t i = 0; i < vec.size(); i++)
+		welded[i] = welder.weld(vec[i].mPosition);
+
+	// Union-find over welded points
+	std::vector<int> parent(welder.size());
+	for (size_t i = 0; i < parent.size(); i++)
+		parent[i] = (int)i;
+	int numTriangles = (int)ind.size() / 3;
+	for (int t = 0; t < numTriangles; t++)
+	{
+		for (int k = 1; k < 3; k++)
 		{
-			Vector2 uv = A * it->x + B * it->y + C;
-			newMesh.position(deprojectOnAxis(*it, planeOrigin, xAxis, yAxis));
-			newMesh.normal(triNormal);
-			newMesh.textureCoord(uv);
+			int a = welded[ind[t * 3]];
+			int b = welded[ind[t * 3 + k]];
+			while (parent[a] != a)
+				a = parent[a] = parent[parent[a]];
+			while (parent[b] != b)
+				b = parent[b] = parent[parent[b]];
+			if (a != b)
+				parent[std::max(a, b)] = std::min(a, b);
 		}
 	}
+
+	std::vector<int> componentOfRoot(parent.size(), -1);
+	for (int t = 0; t < numTriangles; t++)
+	{
+		int a = welded[ind[t * 3]];
+		while (parent[a] != a)
+			a = parent[a];
+		if (componentOfRoot[a] == -1)
+		{
+			componentOfRoot[a] = (int)components.size();
+			components.push_back(std::vector<int>());
+		}
+		components[componentOfRoot[a]].push_back(t);
+	}
 }
 //-----------------------------------------------------------------------
-typedef std::multimap<Segment3D, int, Seg3Comparator> TriLookup;
 
-void _buildTriLookup(TriLookup& lookup, const TriangleBuffer& newMesh)
+void _appendTriangles(TriangleBuffer& result, const TriangleBuffer& source, const std::vector<int>& triangles, bool inverted)
 {
-	const std::vector<TriangleBuffer::Vertex>& nvec = newMesh.getVertices();
-	const std::vector<int>& nind = newMesh.getIndices();
-	for (int i = 0; i < (int)nind.size() / 3; i++)
+	const std::vector<int>& ind = source.getIndices();
+	const std::vector<TriangleBuffer::Vertex>& vec = source.getVertices();
+	std::vector<int> remap(vec.size(), -1);
+	int vertexCount = 0;
+	result.rebaseOffset();
+	for (std::vector<int>::const_iterator it = triangles.begin(); it != triangles.end(); ++it)
 	{
-		lookup.insert(std::pair<Segment3D, int>(Segment3D(nvec[nind[i * 3]].mPosition, nvec[nind[i * 3 + 1]].mPosition).orderedCopy(), i));
-		lookup.insert(std::pair<Segment3D, int>(Segment3D(nvec[nind[i * 3]].mPosition, nvec[nind[i * 3 + 2]].mPosition).orderedCopy(), i));
-		lookup.insert(std::pair<Segment3D, int>(Segment3D(nvec[nind[i * 3 + 1]].mPosition, nvec[nind[i * 3 + 2]].mPosition).orderedCopy(), i));
+		int corners[3];
+		for (int k = 0; k < 3; k++)
+		{
+			int i = ind[*it * 3 + k];
+			if (remap[i] == -1)
+			{
+				remap[i] = vertexCount++;
+				TriangleBuffer::Vertex v = vec[i];
+				if (inverted)
+					v.mNormal = -v.mNormal;
+				result.vertex(v);
+			}
+			corners[k] = remap[i];
+		}
+		if (inverted)
+			result.triangle(corners[0], corners[2], corners[1]);
+		else
+			result.triangle(corners[0], corners[1], corners[2]);
+	}
+}
+//-----------------------------------------------------------------------
+
+/// Tells whether a point is inside a closed mesh, by counting the crossings of a ray cast from the point
+bool _isPointInsideMesh(const Vector3& point, const TriangleBuffer& mesh)
+{
+	// The direction is slightly skewed so that the ray is unlikely to hit an edge of an axis-aligned mesh
+	const Vector3 dir = Vector3(0.5773f, 0.5801f, 0.5745f).normalisedCopy();
+	const std::vector<int>& ind = mesh.getIndices();
+	const std::vector<TriangleBuffer::Vertex>& vec = mesh.getVertices();
+	int crossings = 0;
+	for (size_t i = 0; i + 2 < ind.size(); i += 3)
+	{
+		const Vector3& v0 = vec[ind[i]].mPosition;
+		Vector3 e1 = vec[ind[i + 1]].mPosition - v0;
+		Vector3 e2 = vec[ind[i + 2]].mPosition - v0;
+		Vector3 p = dir.crossProduct(e2);
+		Real det = e1.dotProduct(p);
+		if (Math::Abs(det) < 1e-12)
+			continue;
+		Real invDet = 1.f / det;
+		Vector3 t = point - v0;
+		Real u = t.dotProduct(p) * invDet;
+		if (u < 0 || u > 1)
+			continue;
+		Vector3 q = t.crossProduct(e1);
+		Real v = dir.dotProduct(q) * invDet;
+		if (v < 0 || u + v > 1)
+			continue;
+		if (e2.dotProduct(q) * invDet > 0)
+			crossings++;
+	}
+	return (crossings & 1) != 0;
+}
+//-----------------------------------------------------------------------
+
+/// Adds a connected part of a mesh which doesn't touch the surface of the other mesh.
+/// Such a part is either outside the other mesh or nested inside it, which decides whether it is kept.
+/// @param first whether the part belongs to the first operand
+void _addWholeComponent(TriangleBuffer& buffer, const TriangleBuffer& mesh, const std::vector<int>& component, const TriangleBuffer& otherMesh,
+                        bool first, Boolean::BooleanOperation op)
+{
+	bool inside = _isPointInsideMesh(mesh.getVertices()[mesh.getIndices()[component.front() * 3]].mPosition, otherMesh);
+	if (first)
+	{
+		if (inside == (op == Boolean::BT_INTERSECTION))
+			_appendTriangles(buffer, mesh, component, false);
+	}
+	else if (op == Boolean::BT_UNION && !inside)
+		_appendTriangles(buffer, mesh, component, false);
+	else if (op != Boolean::BT_UNION && inside)
+		_appendTriangles(buffer, mesh, component, op == Boolean::BT_DIFFERENCE);
+}
+//-----------------------------------------------------------------------
+
+/// Builds the result of a boolean operation between two meshes whose surfaces don't intersect.
+void _addNonIntersecting(TriangleBuffer& buffer, const TriangleBuffer& mesh1, const TriangleBuffer& mesh2, Boolean::BooleanOperation op)
+{
+	std::vector<std::vector<int> > components1, components2;
+	_findComponents(mesh1, components1);
+	_findComponents(mesh2, components2);
+
+	for (std::vector<std::vector<int> >::iterator it = components1.begin(); it != components1.end(); ++it)
+		_addWholeComponent(buffer, mesh1, *it, mesh2, true, op);
+	for (std::vector<std::vector<int> >::iterator it = components2.begin(); it != components2.end(); ++it)
+		_addWholeComponent(buffer, mesh2, *it, mesh1, false, op);
+}
+//-----------------------------------------------------------------------
+
+/// Adds the connected parts of a retriangulated mesh that no intersection contour reaches, as the flood fill can't get to them
+void _addUntouchedComponents(TriangleBuffer& buffer, const TriangleBuffer& mesh, const TriLookup& lookup, const IndexHashMap& limits,
+                             const TriangleBuffer& otherMesh, bool first, Boolean::BooleanOperation op)
+{
+	std::vector<std::vector<int> > components;
+	_findComponents(mesh, components);
+	for (std::vector<std::vector<int> >::iterator it = components.begin(); it != components.end(); ++it)
+	{
+		bool touched = false;
+		for (std::vector<int>::iterator tri = it->begin(); tri != it->end() && !touched; ++tri)
+			for (int k = 0; k < 3 && !touched; k++)
+				touched = limits.find(IndexHashMap::pairKey(lookup.getCorner(*tri, k), lookup.getCorner(*tri, (k + 1) % 3))) != -1;
+		if (!touched)
+			_addWholeComponent(buffer, mesh, *it, otherMesh, first, op);
 	}
 }
 //-----------------------------------------------------------------------
@@ -306,6 +563,13 @@ void Boolean::addToTriangleBuffer(TriangleBuffer& buffer) const
 		else
 			++it;
 
+	// Without any intersection, each mesh is either kept whole or discarded
+	if (intersectionList.empty())
+	{
+		_addNonIntersecting(buffer, *mMesh1, *mMesh2, mBooleanOperation);
+		return;
+	}
+
 	// Retriangulate
 	TriangleBuffer newMesh1, newMesh2;
 	_retriangulate(newMesh1, *mMesh1, intersectionList, true);
@@ -322,31 +586,31 @@ void Boolean::addToTriangleBuffer(TriangleBuffer& buffer) const
 		segmentSoup.push_back(it->mSeg);
 	Path().buildFromSegmentSoup(segmentSoup, contours);
 
-	// Build a lookup from segment to triangle
+	// Build a lookup from segment to triangle, over vertex ids shared by both meshes and intersection segments
+	Vector3Welder welder;
+	welder.reserve(newMesh1.getVertices().size() + newMesh2.getVertices().size());
 	TriLookup triLookup1, triLookup2;
-	_buildTriLookup(triLookup1, newMesh1);
-	_buildTriLookup(triLookup2, newMesh2);
+	triLookup1.build(newMesh1, welder);
+	triLookup2.build(newMesh2, welder);
 
-	std::set<Segment3D, Seg3Comparator> limits;
+	IndexHashMap limits(segmentSoup.size());
 	for (std::vector<Segment3D>::iterator it = segmentSoup.begin(); it != segmentSoup.end(); ++it)
-		limits.insert(it->orderedCopy());
+		limits.set(IndexHashMap::pairKey(welder.weld(it->mA), welder.weld(it->mB)), 0);
 	// Build resulting mesh
 	for (std::vector<Path>::iterator it = contours.begin(); it != contours.end(); ++it)
 	{
 		// Find 2 seed triangles for each contour
 		Segment3D firstSeg(it->getPoint(0), it->getPoint(1));
+		int firstSegA = welder.weld(firstSeg.mA);
+		int firstSegB = welder.weld(firstSeg.mB);
 
-		std::pair<TriLookup::iterator, TriLookup::iterator> it2mesh1 = triLookup1.equal_range(firstSeg.orderedCopy());
-		std::pair<TriLookup::iterator, TriLookup::iterator> it2mesh2 = triLookup2.equal_range(firstSeg.orderedCopy());
 		int mesh1seed1, mesh1seed2, mesh2seed1, mesh2seed2;
+		triLookup1.findTriangles(firstSegA, firstSegB, mesh1seed1, mesh1seed2);
+		triLookup2.findTriangles(firstSegA, firstSegB, mesh2seed1, mesh2seed2);
 
-		if (it2mesh1.first != triLookup1.end() && it2mesh2.first != triLookup2.end())
+		if (mesh1seed1 != -1 && mesh2seed1 != -1)
 		{
 			// check which of seed1 and seed2 must be included (it can be 0, 1 or both)
-			mesh1seed1 = it2mesh1.first->second;
-			mesh1seed2 = (--it2mesh1.second)->second;
-			mesh2seed1 = it2mesh2.first->second;
-			mesh2seed2 = (--it2mesh2.second)->second;
 			if (mesh1seed1 == mesh1seed2)
 				mesh1seed2 = -1;
 			if (mesh2seed1 == mesh2seed2)
@@ -378,47 +642,51 @@ void Boolean::addToTriangleBuffer(TriangleBuffer& buffer) const
 			bool M2S1InsideM1 = (nMesh1.dotProduct(vMesh2-firstSeg.mA) < 0);
 			bool M1S1InsideM2 = (nMesh2.dotProduct(vMesh1-firstSeg.mA) < 0);
 
-			_removeFromTriLookup(mesh1seed1, triLookup1);
-			_removeFromTriLookup(mesh2seed1, triLookup2);
-			_removeFromTriLookup(mesh1seed2, triLookup1);
-			_removeFromTriLookup(mesh2seed2, triLookup2);
+			triLookup1.remove(mesh1seed1);
+			triLookup2.remove(mesh2seed1);
+			triLookup1.remove(mesh1seed2);
+			triLookup2.remove(mesh2seed2);
 
-			// Recursively add all neighbours of these triangles
+			// Flood fill all neighbours of these triangles
 			// Stop when a contour is touched
 			switch (mBooleanOperation)
 			{
 			case BT_UNION:
 				if (M1S1InsideM2)
-					_recursiveAddNeighbour(buffer, newMesh1, mesh1seed2, triLookup1, limits, false);
+					_addNeighbours(buffer, newMesh1, mesh1seed2, triLookup1, limits, false);
 				else
-					_recursiveAddNeighbour(buffer, newMesh1, mesh1seed1, triLookup1, limits, false);
+					_addNeighbours(buffer, newMesh1, mesh1seed1, triLookup1, limits, false);
 				if (M2S1InsideM1)
-					_recursiveAddNeighbour(buffer, newMesh2, mesh2seed2, triLookup2, limits, false);
+					_addNeighbours(buffer, newMesh2, mesh2seed2, triLookup2, limits, false);
 				else
-					_recursiveAddNeighbour(buffer, newMesh2, mesh2seed1, triLookup2, limits, false);
+					_addNeighbours(buffer, newMesh2, mesh2seed1, triLookup2, limits, false);
 				break;
 			case BT_INTERSECTION:
 				if (M1S1InsideM2)
-					_recursiveAddNeighbour(buffer, newMesh1, mesh1seed1, triLookup1, limits, false);
+					_addNeighbours(buffer, newMesh1, mesh1seed1, triLookup1, limits, false);
 				else
-					_recursiveAddNeighbour(buffer, newMesh1, mesh1seed2, triLookup1, limits, false);
+					_addNeighbours(buffer, newMesh1, mesh1seed2, triLookup1, limits, false);
 				if (M2S1InsideM1)
-					_recursiveAddNeighbour(buffer, newMesh2, mesh2seed1, triLookup2, limits, false);
+					_addNeighbours(buffer, newMesh2, mesh2seed1, triLookup2, limits, false);
 				else
-					_recursiveAddNeighbour(buffer, newMesh2, mesh2seed2, triLookup2, limits, false);
+					_addNeighbours(buffer, newMesh2, mesh2seed2, triLookup2, limits, false);
 				break;
 			case BT_DIFFERENCE:
 				if (M1S1InsideM2)
-					_recursiveAddNeighbour(buffer, newMesh1, mesh1seed2, triLookup1, limits, false);
+					_addNeighbours(buffer, newMesh1, mesh1seed2, triLookup1, limits, false);
 				else
-					_recursiveAddNeighbour(buffer, newMesh1, mesh1seed1, triLookup1, limits, false);
+					_addNeighbours(buffer, newMesh1, mesh1seed1, triLookup1, limits, false);
 				if (M2S1InsideM1)
-					_recursiveAddNeighbour(buffer, newMesh2, mesh2seed1, triLookup2, limits, true);
+					_addNeighbours(buffer, newMesh2, mesh2seed1, triLookup2, limits, true);
 				else
-					_recursiveAddNeighbour(buffer, newMesh2, mesh2seed2, triLookup2, limits, true);
+					_addNeighbours(buffer, newMesh2, mesh2seed2, triLookup2, limits, true);
 				break;
 			}
 		}
 	}
+
+	// Parts of the meshes away from all contours are kept or dropped whole, as when nothing intersects
+	_addUntouchedComponents(buffer, newMesh1, triLookup1, limits, *mMesh2, true, mBooleanOperation);
+	_addUntouchedComponents(buffer, newMesh2, triLookup2, limits, *mMesh1, false, mBooleanOperation);
 }
 }
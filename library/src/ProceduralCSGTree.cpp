@@ -0,0 +1,359 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#include "ProceduralStableHeaders.h"
+#include "ProceduralCSGTree.h"
+
+using namespace Ogre;
+
+namespace Procedural
+{
+//-----------------------------------------------------------------------
+namespace
+{
+inline uint64 _mix(uint64 h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+//-----------------------------------------------------------------------
+
+inline uint64 _combine(uint64 seed, uint64 value)
+{
+	return _mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+//-----------------------------------------------------------------------
+
+inline uint64 _combine(uint64 seed, Real value)
+{
+	uint32 bits;
+	float f = (float)value;
+	memcpy(&bits, &f, sizeof(bits));
+	return _combine(seed, (uint64)bits);
+}
+//-----------------------------------------------------------------------
+
+uint64 _hashMesh(const TriangleBuffer& mesh)
+{
+	const std::vector<TriangleBuffer::Vertex>& vec = mesh.getVertices();
+	const std::vector<int>& ind = mesh.getIndices();
+	uint64 h = _combine((uint64)vec.size(), (uint64)ind.size());
+	for (std::vector<TriangleBuffer::Vertex>::const_iterator it = vec.begin(); it != vec.end(); ++it)
+	{
+		h = _combine(h, it->mPosition.x);
+		h = _combine(h, it->mPosition.y);
+		h = _combine(h, it->mPosition.z);
+		h = _combine(h, it->mNormal.x);
+		h = _combine(h, it->mNormal.y);
+		h = _combine(h, it->mNormal.z);
+		h = _combine(h, it->mUV.x);
+		h = _combine(h, it->mUV.y);
+	}
+	for (std::vector<int>::const_iterator it = ind.begin(); it != ind.end(); ++it)
+		h = _combine(h, (uint64)(uint32)*it);
+	return h;
+}
+//-----------------------------------------------------------------------
+
+/// A binary step of the evaluation, or a leaf
+struct EvaluationStep
+{
+	int mLeaf;
+	Boolean::BooleanOperation mOperation;
+	int mOperand1;
+	int mOperand2;
+	uint64 mHash;
+	int mHeight;
+};
+//-----------------------------------------------------------------------
+
+/// Turns the n-ary tree into binary evaluation steps, sharing identical subtrees
+class EvaluationPlan
+{
+	std::vector<EvaluationStep> mSteps;
+	std::map<uint64, int> mStepsByHash;
+
+	int _addStep(const EvaluationStep& step)
+	{
+		std::map<uint64, int>::iterator it = mStepsByHash.find(step.mHash);
+		if (it != mStepsByHash.end())
+			return it->second;
+		mSteps.push_back(step);
+		mStepsByHash[step.mHash] = (int)mSteps.size() - 1;
+		return (int)mSteps.size() - 1;
+	}
+
+	int _addBinary(Boolean::BooleanOperation op, int operand1, int operand2)
+	{
+		EvaluationStep step;
+		step.mLeaf = -1;
+		step.mOperation = op;
+		step.mOperand1 = operand1;
+		step.mOperand2 = operand2;
+		step.mHash = _combine(_combine((uint64)op + 1, mSteps[operand1].mHash), mSteps[operand2].mHash);
+		step.mHeight = std::max(mSteps[operand1].mHeight, mSteps[operand2].mHeight) + 1;
+		return _addStep(step);
+	}
+
+	/// Combines operands [first, last[ into a balanced tree
+	int _addBalanced(Boolean::BooleanOperation op, const std::vector<int>& operands, size_t first, size_t last)
+	{
+		if (last - first == 1)
+			return operands[first];
+		size_t middle = first + (last - first) / 2;
+		return _addBinary(op, _addBalanced(op, operands, first, middle), _addBalanced(op, operands, middle, last));
+	}
+
+public:
+	const std::vector<EvaluationStep>& getSteps() const
+	{
+		return mSteps;
+	}
+
+	int addLeaf(int node, uint64 hash)
+	{
+		EvaluationStep step;
+		step.mLeaf = node;
+		step.mOperation = Boolean::BT_UNION;
+		step.mOperand1 = step.mOperand2 = -1;
+		step.mHash = hash;
+		step.mHeight = 0;
+		return _addStep(step);
+	}
+
+	int addOperation(Boolean::BooleanOperation op, const std::vector<int>& operands)
+	{
+		if (op != Boolean::BT_DIFFERENCE || operands.size() <= 2)
+			return _addBalanced(op, operands, 0, operands.size());
+		// a - b - c - ... = a - (b + c + ...)
+		std::vector<int> subtracted(operands.begin() + 1, operands.end());
+		return _addBinary(op, operands[0], _addBalanced(Boolean::BT_UNION, subtracted, 0, subtracted.size()));
+	}
+};
+//-----------------------------------------------------------------------
+
+inline void _swapBuffers(TriangleBuffer& a, TriangleBuffer& b)
+{
+	a.getVertices().swap(b.getVertices());
+	a.getIndices().swap(b.getIndices());
+}
+//-----------------------------------------------------------------------
+
+void _evaluateStep(TriangleBuffer& result, const EvaluationStep& step, const std::vector<const TriangleBuffer*>& operandResults)
+{
+	Boolean b;
+	b.setMesh1(const_cast<TriangleBuffer*>(operandResults[step.mOperand1]));
+	b.setMesh2(const_cast<TriangleBuffer*>(operandResults[step.mOperand2]));
+	b.setBooleanOperation(step.mOperation);
+	b.addToTriangleBuffer(result);
+}
+}
+//-----------------------------------------------------------------------
+
+void CSGTree::_checkNode(int node, const char* origin) const
+{
+	if (node < 0 || node >= (int)mNodes.size())
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Node is not part of this tree", origin);
+}
+//-----------------------------------------------------------------------
+
+int CSGTree::addLeaf(const TriangleBuffer& mesh)
+{
+	mNodes.push_back(Node());
+	Node& n = mNodes.back();
+	n.mIsLeaf = true;
+	n.mOperation = Boolean::BT_UNION;
+	n.mMesh = mesh;
+	n.mHash = _hashMesh(mesh);
+	return (int)mNodes.size() - 1;
+}
+//-----------------------------------------------------------------------
+
+int CSGTree::addOperation(Boolean::BooleanOperation op, int operand1, int operand2)
+{
+	std::vector<int> operands;
+	operands.push_back(operand1);
+	operands.push_back(operand2);
+	return addOperation(op, operands);
+}
+//-----------------------------------------------------------------------
+
+int CSGTree::addOperation(Boolean::BooleanOperation op, const std::vector<int>& operands)
+{
+	if (operands.empty())
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "An operation needs at least one operand", "Procedural::CSGTree::addOperation(Procedural::Boolean::BooleanOperation, const std::vector<int>&)");
+	for (std::vector<int>::const_iterator it = operands.begin(); it != operands.end(); ++it)
+		_checkNode(*it, "Procedural::CSGTree::addOperation(Procedural::Boolean::BooleanOperation, const std::vector<int>&)");
+	mNodes.push_back(Node());
+	Node& n = mNodes.back();
+	n.mIsLeaf = false;
+	n.mOperation = op;
+	n.mOperands = operands;
+	n.mHash = 0;
+	return (int)mNodes.size() - 1;
+}
+//-----------------------------------------------------------------------
+
+CSGTree& CSGTree::setLeaf(int node, const TriangleBuffer& mesh)
+{
+	_checkNode(node, "Procedural::CSGTree::setLeaf(int, const Procedural::TriangleBuffer&)");
+	Node& n = mNodes[node];
+	if (!n.mIsLeaf)
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Node is not a leaf", "Procedural::CSGTree::setLeaf(int, const Procedural::TriangleBuffer&)");
+	n.mMesh = mesh;
+	n.mHash = _hashMesh(mesh);
+	return *this;
+}
+//-----------------------------------------------------------------------
+
+CSGTree& CSGTree::setOperation(int node, Boolean::BooleanOperation op)
+{
+	_checkNode(node, "Procedural::CSGTree::setOperation(int, Procedural::Boolean::BooleanOperation)");
+	if (mNodes[node].mIsLeaf)
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Node is not an operation", "Procedural::CSGTree::setOperation(int, Procedural::Boolean::BooleanOperation)");
+	mNodes[node].mOperation = op;
+	return *this;
+}
+//-----------------------------------------------------------------------
+
+CSGTree& CSGTree::setRoot(int node)
+{
+	_checkNode(node, "Procedural::CSGTree::setRoot(int)");
+	mRoot = node;
+	return *this;
+}
+//-----------------------------------------------------------------------
+
+void CSGTree::addToTriangleBuffer(TriangleBuffer& buffer) const
+{
+	if (mRoot == -1)
+		OGRE_EXCEPT(Exception::ERR_INVALID_STATE, "Root node must be set", "Procedural::CSGTree::addToTriangleBuffer(Procedural::TriangleBuffer&)");
+
+	// Operands always come before their operation, so nodes can be translated in id order
+	EvaluationPlan plan;
+	std::vector<int> nodeSteps(mRoot + 1, -1);
+	for (int i = 0; i <= mRoot; i++)
+	{
+		const Node& n = mNodes[i];
+		if (n.mIsLeaf)
+		{
+			nodeSteps[i] = plan.addLeaf(i, n.mHash);
+			continue;
+		}
+		std::vector<int> operandSteps;
+		operandSteps.reserve(n.mOperands.size());
+		for (std::vector<int>::const_iterator it = n.mOperands.begin(); it != n.mOperands.end(); ++it)
+			operandSteps.push_back(nodeSteps[*it]);
+		nodeSteps[i] = plan.addOperation(n.mOperation, operandSteps);
+	}
+	const std::vector<EvaluationStep>& steps = plan.getSteps();
+	int rootStep = nodeSteps[mRoot];
+
+	// Only steps the root depends on are evaluated
+	std::vector<char> needed(steps.size(), 0);
+	needed[rootStep] = 1;
+	int maxHeight = 0;
+	for (int i = rootStep; i >= 0; i--)
+		if (needed[i] && steps[i].mLeaf == -1)
+		{
+			needed[steps[i].mOperand1] = needed[steps[i].mOperand2] = 1;
+			maxHeight = std::max(maxHeight, steps[i].mHeight);
+		}
+
+	std::vector<const TriangleBuffer*> results(steps.size(), (const TriangleBuffer*)0);
+	std::vector<TriangleBuffer> computed(steps.size());
+	std::vector<std::vector<int> > toCompute(maxHeight + 1);
+	for (size_t i = 0; i < steps.size(); i++)
+	{
+		if (!needed[i])
+			continue;
+		if (steps[i].mLeaf != -1)
+			results[i] = &mNodes[steps[i].mLeaf].mMesh;
+		else
+		{
+			std::map<uint64, TriangleBuffer>::const_iterator it = mCache.find(steps[i].mHash);
+			if (mCacheEnabled && it != mCache.end())
+				results[i] = &it->second;
+			else
+				toCompute[steps[i].mHeight].push_back((int)i);
+		}
+	}
+
+	// Steps of the same height don't depend on each other
+	for (int h = 1; h <= maxHeight; h++)
+	{
+		const std::vector<int>& level = toCompute[h];
+		int levelSize = (int)level.size();
+#ifdef PROCEDURAL_USE_OPENMP
+		// Exceptions can't cross the parallel region : failed steps are re-run serially, so that they throw from there
+		std::vector<char> failed(levelSize, 0);
+		#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < levelSize; i++)
+		{
+			try
+			{
+				_evaluateStep(computed[level[i]], steps[level[i]], results);
+			}
+			catch (...)
+			{
+				failed[i] = 1;
+			}
+		}
+		for (int i = 0; i < levelSize; i++)
+			if (failed[i])
+			{
+				computed[level[i]] = TriangleBuffer();
+				_evaluateStep(computed[level[i]], steps[level[i]], results);
+			}
+#else
+		for (int i = 0; i < levelSize; i++)
+			_evaluateStep(computed[level[i]], steps[level[i]], results);
+#endif
+		for (int i = 0; i < levelSize; i++)
+			results[level[i]] = &computed[level[i]];
+	}
+
+	buffer.append(*results[rootStep]);
+
+	if (mCacheEnabled)
+	{
+		// Keep only the results used by the current tree
+		std::map<uint64, TriangleBuffer> cache;
+		for (size_t i = 0; i < steps.size(); i++)
+			if (needed[i] && steps[i].mLeaf == -1)
+			{
+				std::map<uint64, TriangleBuffer>::iterator it = mCache.find(steps[i].mHash);
+				_swapBuffers(cache[steps[i].mHash], it != mCache.end() ? it->second : computed[i]);
+			}
+		mCache.swap(cache);
+	}
+}
+}
@@ -35,6 +35,15 @@ namespace Procedural
 {
 void CapsuleGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 {
+	if (mChordError > 0)
+	{
+		CapsuleGenerator capsule(*this);
+		capsule.mChordError = 0;
+		capsule.mNumRings = _getArcSegmentCount(mRadius, Radian(Math::HALF_PI), 1);
+		capsule.mNumSegments = _getArcSegmentCount(mRadius, Radian(Math::TWO_PI), 3);
+		capsule.addToTriangleBuffer(buffer);
+		return;
+	}
 	buffer.rebaseOffset();
 	buffer.estimateVertexCount((2*mNumRings+2)*(mNumSegments+1) + (mNumSegHeight-1)*(mNumSegments+1));
 	buffer.estimateIndexCount((2*mNumRings+1)*(mNumSegments+1)*6 + (mNumSegHeight-1)*(mNumSegments+1)*6);
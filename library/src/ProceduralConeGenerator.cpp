@@ -35,6 +35,14 @@ namespace Procedural
 {
 void ConeGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 {
+	if (mChordError > 0)
+	{
+		ConeGenerator cone(*this);
+		cone.mChordError = 0;
+		cone.mNumSegBase = _getArcSegmentCount(mRadius, Radian(Math::TWO_PI), 3);
+		cone.addToTriangleBuffer(buffer);
+		return;
+	}
 	buffer.rebaseOffset();
 	buffer.estimateVertexCount((mNumSegHeight+1)*(mNumSegBase+1)+mNumSegBase+2);
 	buffer.estimateIndexCount(mNumSegHeight*mNumSegBase*6+3*mNumSegBase);
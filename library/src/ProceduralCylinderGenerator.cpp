@@ -36,6 +36,14 @@ namespace Procedural
 
 void CylinderGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 {
+	if (mChordError > 0)
+	{
+		CylinderGenerator cylinder(*this);
+		cylinder.mChordError = 0;
+		cylinder.mNumSegBase = _getArcSegmentCount(mRadius, Radian(Math::TWO_PI), 3);
+		cylinder.addToTriangleBuffer(buffer);
+		return;
+	}
 	buffer.rebaseOffset();
 	if (mCapped)
 	{
@@ -35,6 +35,11 @@ using namespace Ogre;
 
 namespace Procedural
 {
+namespace
+{
+/// Stands for missing tracks, so that evaluators can always be built
+const Track _noTrack;
+}
 //-----------------------------------------------------------------------
 void _extrudeShape(TriangleBuffer& buffer, const Shape& shape, const Vector3& position, const Quaternion& orientationLeft, const Quaternion& orientationRight, Real scale, Real scaleCorrectionLeft, Real scaleCorrectionRight, Real totalShapeLength, Real uTexCoord, bool joinToTheNextSection, const Track* shapeTextureTrack)
 {
@@ -96,59 +101,115 @@ void _extrudeBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude, const
 	Real totalPathLength = pathToExtrude->getTotalLength();
 	Real totalShapeLength = shapeToExtrude->getTotalLength();
 
-	// Merge shape and path with tracks
-	Ogre::Real lineicPos = pathToExtrude->getLengthAtPoint(pathBeginIndex);
-	Path path = *pathToExtrude;
-	numSegPath = pathEndIndex - pathBeginIndex;
-	numSegShape = shapeToExtrude->getSegCount();
-
-	// Estimate vertex and index count
-	buffer.rebaseOffset();
-	buffer.estimateIndexCount(numSegShape*numSegPath*6);
-	buffer.estimateVertexCount((numSegShape+1)*(numSegPath+1));
+	const Path& path = *pathToExtrude;
+	const Shape& shape = *shapeToExtrude;
+	const std::vector<Quaternion>& frames = path.getRotationMinimizingFrames();
+	int ringCount = numSegPath + 1;
+	int ringSize = numSegShape + 1;
 
-	Vector3 oldup;
-	for (unsigned int i = pathBeginIndex; i <= pathEndIndex; ++i)
+	// The cross section is the same for every ring : only the orientation, scale and U coordinate change along the path
+	std::vector<Vector3> sectionPoints(ringSize);
+	std::vector<Vector3> sectionNormals(ringSize);
+	std::vector<Real> sectionTexCoords(ringSize);
+	Real lineicShapePos = 0.;
+	Track::Evaluator shapeTextureEvaluator(shapeTextureTrack ? *shapeTextureTrack : _noTrack);
+	for (int j = 0; j < ringSize; ++j)
 	{
-		Vector3 v0 = path.getPoint(i);
-		Vector3 direction = path.getAvgDirection(i);
-
-		Quaternion q = Utils::_computeQuaternion(direction);
-
-		Radian angle = (q*Vector3::UNIT_Y).angleBetween(oldup);
-		if (i>pathBeginIndex && angle>(Radian)Math::HALF_PI/2.)
-		{
-			q = Utils::_computeQuaternion(direction, oldup);
-		}
-		oldup = q * Vector3::UNIT_Y;
-
-		Real scale=1.;
+		Vector2 vp2 = shape.getPoint(j);
+		Vector2 vp2normal = shape.getAvgNormal(j);
+		sectionPoints[j] = Vector3(vp2.x, vp2.y, 0);
+		sectionNormals[j] = Vector3(vp2normal.x, vp2normal.y, 0);
+		if (j>0)
+			lineicShapePos += (vp2 - shape.getPoint(j-1)).length();
+		if (shapeTextureTrack)
+			sectionTexCoords[j] = shapeTextureEvaluator.getValue(lineicShapePos, lineicShapePos / totalShapeLength, j);
+		else
+			sectionTexCoords[j] = lineicShapePos / totalShapeLength;
+	}
 
-		if (i>pathBeginIndex) lineicPos += (v0-path.getPoint(i-1)).length();
+	// Orientation, scale and U coordinate of each ring, tracks being read serially
+	std::vector<Quaternion> ringOrientations(ringCount);
+	std::vector<Real> ringScales(ringCount, 1.);
+	std::vector<Real> ringTexCoords(ringCount);
+	Track::Evaluator rotationEvaluator(rotationTrack ? *rotationTrack : _noTrack);
+	Track::Evaluator scaleEvaluator(scaleTrack ? *scaleTrack : _noTrack);
+	Track::Evaluator pathTextureEvaluator(pathTextureTrack ? *pathTextureTrack : _noTrack);
+	for (int r = 0; r < ringCount; ++r)
+	{
+		unsigned int i = pathBeginIndex + r;
+		Real lineicPos = path.getLengthAtPoint(i);
+		ringOrientations[r] = frames[i];
 
 		// Get the values of angle and scale
 		if (rotationTrack)
 		{
-			Real angle;
-			angle = rotationTrack->getValue(lineicPos, lineicPos / totalPathLength, i);
-
-			q = q*Quaternion((Radian)angle, Vector3::UNIT_Z);
+			Real angle = rotationEvaluator.getValue(lineicPos, lineicPos / totalPathLength, i);
+			ringOrientations[r] = ringOrientations[r]*Quaternion((Radian)angle, Vector3::UNIT_Z);
 		}
 		if (scaleTrack)
-		{
-			scale = scaleTrack->getValue(lineicPos, lineicPos / totalPathLength, i);
-		}
-		Real uTexCoord;
+			ringScales[r] = scaleEvaluator.getValue(lineicPos, lineicPos / totalPathLength, i);
 		if (pathTextureTrack)
-			uTexCoord = pathTextureTrack->getValue(lineicPos, lineicPos / totalPathLength, i);
+			ringTexCoords[r] = pathTextureEvaluator.getValue(lineicPos, lineicPos / totalPathLength, i);
 		else
-			uTexCoord = lineicPos / totalPathLength;
+			ringTexCoords[r] = lineicPos / totalPathLength;
+	}
 
-		_extrudeShape(buffer, *shapeToExtrude, v0, q, q, scale, 1.0, 1.0, totalShapeLength, uTexCoord, i<pathEndIndex, shapeTextureTrack);
+	// Rings and the quads joining them are written in place, each ring in its own part of the buffers
+	buffer.rebaseOffset();
+	std::vector<TriangleBuffer::Vertex>& vertices = buffer.getVertices();
+	std::vector<int>& indices = buffer.getIndices();
+	int firstVertex = vertices.size();
+	size_t firstIndex = indices.size();
+	vertices.resize(firstVertex + ringCount * ringSize);
+	indices.resize(firstIndex + numSegPath * numSegShape * 6);
+	bool outSideLeft = shape.getOutSide() == SIDE_LEFT;
+
+#ifdef PROCEDURAL_USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int r = 0; r < ringCount; ++r)
+	{
+		const Vector3& v0 = path.getPoint(pathBeginIndex + r);
+		const Quaternion& q = ringOrientations[r];
+		Real scale = ringScales[r];
+		TriangleBuffer::Vertex* ring = &vertices[firstVertex + r * ringSize];
+		for (int j = 0; j < ringSize; ++j)
+		{
+			ring[j].mPosition = v0 + q * (scale * sectionPoints[j]);
+			ring[j].mNormal = q * sectionNormals[j];
+			ring[j].mUV = Vector2(ringTexCoords[r], sectionTexCoords[j]);
+		}
+
+		if (r == ringCount - 1)
+			continue;
+		int* quad = &indices[firstIndex + r * numSegShape * 6];
+		for (int j = 0; j < (int)numSegShape; ++j, quad += 6)
+		{
+			int v = firstVertex + r * ringSize + j;
+			if (outSideLeft)
+			{
+				quad[0] = v + ringSize;
+				quad[1] = v + ringSize + 1;
+				quad[2] = v;
+				quad[3] = v;
+				quad[4] = v + ringSize + 1;
+				quad[5] = v + 1;
+			}
+			else
+			{
+				quad[0] = v + ringSize + 1;
+				quad[1] = v + ringSize;
+				quad[2] = v;
+				quad[3] = v + ringSize + 1;
+				quad[4] = v;
+				quad[5] = v + 1;
+			}
+		}
 	}
+	buffer.rebaseOffset();
 }
 //-----------------------------------------------------------------------
-void _extrudeCapImpl(TriangleBuffer& buffer, const MultiShape& multiShapeToExtrude, const MultiPath& extrusionMultiPath, const Extruder::TrackMap& scaleTracks, const Extruder::TrackMap& rotationTracks)
+void _extrudeCapImpl(TriangleBuffer& buffer, const MultiShape& multiShapeToExtrude, const MultiPath& extrusionMultiPath, const MultiPath& intersectionMultiPath, const Extruder::TrackMap& scaleTracks, const Extruder::TrackMap& rotationTracks)
 {
 	std::vector<int> indexBuffer;
 	PointList pointList;
@@ -159,7 +220,10 @@ void _extrudeCapImpl(TriangleBuffer& buffer, const MultiShape& multiShapeToExtru
 
 	for (unsigned int i=0; i<extrusionMultiPath.getPathCount(); ++i)
 	{
-		Path extrusionPath = extrusionMultiPath.getPath(i);
+		// Caps are oriented by the frames of the path the body is extruded along, but intersections are known on the original path
+		const Path& extrusionPath = extrusionMultiPath.getPath(i);
+		const std::vector<Quaternion>& frames = extrusionPath.getRotationMinimizingFrames();
+		const std::map<MultiPath::PathCoordinate, MultiPath::PathIntersection>& intersections = intersectionMultiPath.getIntersectionsMap();
 		const Track* scaleTrack = 0;
 		const Track* rotationTrack = 0;
 		if (scaleTracks.find(i) != scaleTracks.end())
@@ -168,13 +232,13 @@ void _extrudeCapImpl(TriangleBuffer& buffer, const MultiShape& multiShapeToExtru
 			rotationTrack = rotationTracks.find(i)->second;
 
 		//begin cap
-		if (extrusionMultiPath.getIntersectionsMap().find(MultiPath::PathCoordinate(i, 0)) == extrusionMultiPath.getIntersectionsMap().end())
+		if (intersections.find(MultiPath::PathCoordinate(i, 0)) == intersections.end())
 		{			
 			buffer.rebaseOffset();
 			buffer.estimateIndexCount(indexBuffer.size());
 			buffer.estimateVertexCount(pointList.size());
 
-			Quaternion qBegin = Utils::_computeQuaternion(extrusionPath.getDirectionAfter(0));
+			Quaternion qBegin = frames.front();
 			if (rotationTrack)
 			{
 				Real angle = rotationTrack->getFirstValue();
@@ -204,13 +268,13 @@ void _extrudeCapImpl(TriangleBuffer& buffer, const MultiShape& multiShapeToExtru
 		}
 
 		//end cap
-		if (extrusionMultiPath.getIntersectionsMap().find(MultiPath::PathCoordinate(i, extrusionPath.getSegCount())) == extrusionMultiPath.getIntersectionsMap().end())
+		if (intersections.find(MultiPath::PathCoordinate(i, intersectionMultiPath.getPath(i).getSegCount())) == intersections.end())
 		{			
 			buffer.rebaseOffset();
 			buffer.estimateIndexCount(indexBuffer.size());
 			buffer.estimateVertexCount(pointList.size());
 
-			Quaternion qEnd = Utils::_computeQuaternion(extrusionPath.getDirectionBefore(extrusionPath.getSegCount()));
+			Quaternion qEnd = frames.back();
 			if (rotationTrack)
 			{
 				Real angle = rotationTrack->getLastValue();
@@ -293,19 +357,24 @@ void _extrudeIntersectionImpl(TriangleBuffer& buffer, const MultiPath::PathInter
 		int pointIndex = coords[idx].pointIndex - direction[idx];
 		const Path& path = multiPath.getPath(coords[idx].pathIndex);
 
-		Quaternion qStd = Utils::_computeQuaternion(path.getAvgDirection(pointIndex) * direction[idx]);		
+		// The joint starts on the ring the body ends with, turned around when coming back from the next point
+		const std::vector<Quaternion>& frames = path.getRotationMinimizingFrames();
+		Quaternion qStd = frames[path.isClosed() ? Utils::modulo(pointIndex, path.getSegCount()) : pointIndex];
+		if (direction[idx]<0)
+			qStd = qStd * Quaternion(Degree(180), Vector3::UNIT_Y);
 		Real lineicPos;
 		Real uTexCoord = path.getLengthAtPoint(pointIndex) / path.getTotalLength();
 
 		// Shape making the joint with "standard extrusion"
 		_extrudeShape(buffer, shape, path.getPoint(pointIndex), qStd, qStd, 1.0, 1.0, 1.0, shape.getTotalLength(), uTexCoord, true, shapeTextureTrack);
 
-		// Modified shape at the intersection
-		Quaternion q;
+		// Modified shape at the intersection, facing along the last segment with the least rotation from the joint's first ring
+		Vector3 segmentDirection;
 		if (direction[idx]>0)
-			q = Utils::_computeQuaternion(path.getDirectionBefore(coords[idx].pointIndex));
+			segmentDirection = path.getDirectionBefore(coords[idx].pointIndex);
 		else
-			q = Utils::_computeQuaternion(-path.getDirectionAfter(coords[idx].pointIndex));		
+			segmentDirection = -path.getDirectionAfter(coords[idx].pointIndex);
+		Quaternion q = (qStd * Vector3::UNIT_Z).getRotationTo(segmentDirection, qStd * Vector3::UNIT_Y) * qStd;
 		Quaternion qLeft = q * Quaternion(angleBefore, Vector3::UNIT_Y);
 		Quaternion qRight = q * Quaternion(angleAfter, Vector3::UNIT_Y);
 		Real scaleLeft = 1.0/Math::Abs(Math::Cos(angleBefore));
@@ -323,12 +392,6 @@ void Extruder::addToTriangleBuffer(TriangleBuffer& buffer) const
 
 	TriangleBuffer::Section section = buffer.beginSection();
 
-	// Triangulate the begin and end caps
-	if (mCapped && mMultiShapeToExtrude.isClosed())
-	{
-		_extrudeCapImpl(buffer, mMultiShapeToExtrude, mMultiExtrusionPath, mScaleTracks, mRotationTracks);
-	}
-
 	MultiPath multiExtrusionPath = mMultiExtrusionPath;
 	
 	for (unsigned int j = 0; j < multiExtrusionPath.getPathCount(); ++j)
@@ -361,28 +424,26 @@ void Extruder::addToTriangleBuffer(TriangleBuffer& buffer) const
 		}
 	}
 
+	// Triangulate the begin and end caps
+	if (mCapped && mMultiShapeToExtrude.isClosed())
+	{
+		_extrudeCapImpl(buffer, mMultiShapeToExtrude, multiExtrusionPath, mMultiExtrusionPath, mScaleTracks, mRotationTracks);
+	}
+
 	// Extrude the paths contained in multiExtrusionPath
 	for (unsigned int j = 0; j<multiExtrusionPath.getPathCount(); ++j)
 	{
-		Path extrusionPath = multiExtrusionPath.getPath(j);
+		// Keys of the tracks have already been merged into the path
+		const Path& extrusionPath = multiExtrusionPath.getPath(j);
 		const Track* rotationTrack = 0;
 		if (mRotationTracks.find(j) != mRotationTracks.end())
-		{
 			rotationTrack = mRotationTracks.find(j)->second;
-			extrusionPath = extrusionPath.mergeKeysWithTrack(*mRotationTracks.find(j)->second);
-		}
 		const Track* scaleTrack = 0;
 		if (mScaleTracks.find(j) != mScaleTracks.end())
-		{
 			scaleTrack = mScaleTracks.find(j)->second;
-			extrusionPath = extrusionPath.mergeKeysWithTrack(*mScaleTracks.find(j)->second);
-		}
 		const Track* pathTextureTrack = 0;
 		if (mPathTextureTracks.find(j) != mPathTextureTracks.end())
-		{
 			pathTextureTrack = mPathTextureTracks.find(j)->second;
-			extrusionPath = extrusionPath.mergeKeysWithTrack(*mPathTextureTracks.find(j)->second);
-		}
 
 		std::vector<std::pair<unsigned int, unsigned int> > segs = multiExtrusionPath.getNoIntersectionParts(j);
 
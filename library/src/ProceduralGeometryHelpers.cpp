@@ -34,6 +34,221 @@ using namespace Ogre;
 namespace Procedural
 {
 //-----------------------------------------------------------------------
+namespace
+{
+// Exact arithmetic on floating-point expansions (sums of non-overlapping doubles, by increasing magnitude),
+// after J. R. Shewchuk, "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates"
+typedef std::vector<double> Expansion;
+
+const double EPSILON = std::numeric_limits<double>::epsilon() * 0.5;
+const double SPLITTER = 134217729.0; // 2^27 + 1
+const double ORIENT2D_BOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+const double ORIENT3D_BOUND = (7.0 + 56.0 * EPSILON) * EPSILON;
+const double INCIRCLE_BOUND = (10.0 + 96.0 * EPSILON) * EPSILON;
+
+inline void _twoSum(double a, double b, double& x, double& y)
+{
+	x = a + b;
+	double bVirtual = x - a;
+	double aVirtual = x - bVirtual;
+	y = (a - aVirtual) + (b - bVirtual);
+}
+
+inline void _split(double a, double& high, double& low)
+{
+	double c = SPLITTER * a;
+	high = c - (c - a);
+	low = a - high;
+}
+
+inline void _twoProduct(double a, double b, double& x, double& y)
+{
+	x = a * b;
+	double aHigh, aLow, bHigh, bLow;
+	_split(a, aHigh, aLow);
+	_split(b, bHigh, bLow);
+	y = aLow * bLow - (((x - aHigh * bHigh) - aLow * bHigh) - aHigh * bLow);
+}
+
+/// Exact difference a-b, as a 2 components expansion
+Expansion _diff(double a, double b)
+{
+	double x, y;
+	_twoSum(a, -b, x, y);
+	Expansion e;
+	if (y != 0)
+		e.push_back(y);
+	e.push_back(x);
+	return e;
+}
+
+/// Adds a double to an expansion
+void _grow(Expansion& e, double b)
+{
+	Expansion h;
+	h.reserve(e.size() + 1);
+	double q = b;
+	for (Expansion::const_iterator it = e.begin(); it != e.end(); ++it)
+	{
+		double sum, err;
+		_twoSum(q, *it, sum, err);
+		if (err != 0)
+			h.push_back(err);
+		q = sum;
+	}
+	if (q != 0 || h.empty())
+		h.push_back(q);
+	e.swap(h);
+}
+
+Expansion _add(const Expansion& e, const Expansion& f)
+{
+	Expansion h = e;
+	for (Expansion::const_iterator it = f.begin(); it != f.end(); ++it)
+		_grow(h, *it);
+	return h;
+}
+
+Expansion _sub(const Expansion& e, const Expansion& f)
+{
+	Expansion h = e;
+	for (Expansion::const_iterator it = f.begin(); it != f.end(); ++it)
+		_grow(h, -*it);
+	return h;
+}
+
+/// Multiplies an expansion by a double
+Expansion _scale(const Expansion& e, double b)
+{
+	Expansion h;
+	h.reserve(e.size() * 2);
+	double q = 0;
+	for (Expansion::const_iterator it = e.begin(); it != e.end(); ++it)
+	{
+		double product, productErr, sum, err;
+		_twoProduct(*it, b, product, productErr);
+		_twoSum(q, productErr, sum, err);
+		if (err != 0)
+			h.push_back(err);
+		_twoSum(product, sum, q, err);
+		if (err != 0)
+			h.push_back(err);
+	}
+	if (q != 0 || h.empty())
+		h.push_back(q);
+	return h;
+}
+
+Expansion _mul(const Expansion& e, const Expansion& f)
+{
+	Expansion h(1, 0.0);
+	for (Expansion::const_iterator it = f.begin(); it != f.end(); ++it)
+		h = _add(h, _scale(e, *it));
+	return h;
+}
+
+/// The largest component carries the sign, the others only refine the value
+double _estimate(const Expansion& e)
+{
+	double sum = 0;
+	for (Expansion::const_iterator it = e.begin(); it != e.end(); ++it)
+		sum += *it;
+	if (sum == 0 && !e.empty())
+		return e.back();
+	return sum;
+}
+}
+//-----------------------------------------------------------------------
+double Predicates::orient2D(const Vector2& a, const Vector2& b, const Vector2& c)
+{
+	double detLeft = ((double)a.x - c.x) * ((double)b.y - c.y);
+	double detRight = ((double)a.y - c.y) * ((double)b.x - c.x);
+	double det = detLeft - detRight;
+	double detSum;
+	if (detLeft > 0)
+	{
+		if (detRight <= 0)
+			return det;
+		detSum = detLeft + detRight;
+	}
+	else if (detLeft < 0)
+	{
+		if (detRight >= 0)
+			return det;
+		detSum = -detLeft - detRight;
+	}
+	else
+		return det;
+	double errBound = ORIENT2D_BOUND * detSum;
+	if (det >= errBound || -det >= errBound)
+		return det;
+
+	return _estimate(_sub(_mul(_diff(a.x, c.x), _diff(b.y, c.y)), _mul(_diff(a.y, c.y), _diff(b.x, c.x))));
+}
+//-----------------------------------------------------------------------
+double Predicates::orient3D(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d)
+{
+	// Same determinant as Shewchuk's orient3d, with the opposite sign
+	double adx = (double)a.x - d.x, ady = (double)a.y - d.y, adz = (double)a.z - d.z;
+	double bdx = (double)b.x - d.x, bdy = (double)b.y - d.y, bdz = (double)b.z - d.z;
+	double cdx = (double)c.x - d.x, cdy = (double)c.y - d.y, cdz = (double)c.z - d.z;
+
+	double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+	double cdxady = cdx * ady, adxcdy = adx * cdy;
+	double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+	double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+	double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz)
+	                   + (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz)
+	                   + (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+	double errBound = ORIENT3D_BOUND * permanent;
+	if (det > errBound || -det > errBound)
+		return -det;
+
+	Expansion eAdx = _diff(a.x, d.x), eAdy = _diff(a.y, d.y), eAdz = _diff(a.z, d.z);
+	Expansion eBdx = _diff(b.x, d.x), eBdy = _diff(b.y, d.y), eBdz = _diff(b.z, d.z);
+	Expansion eCdx = _diff(c.x, d.x), eCdy = _diff(c.y, d.y), eCdz = _diff(c.z, d.z);
+	Expansion exact = _mul(eAdz, _sub(_mul(eBdx, eCdy), _mul(eCdx, eBdy)));
+	exact = _add(exact, _mul(eBdz, _sub(_mul(eCdx, eAdy), _mul(eAdx, eCdy))));
+	exact = _add(exact, _mul(eCdz, _sub(_mul(eAdx, eBdy), _mul(eBdx, eAdy))));
+	return -_estimate(exact);
+}
+//-----------------------------------------------------------------------
+double Predicates::inCircle(const Vector2& a, const Vector2& b, const Vector2& c, const Vector2& d, double* magnitude)
+{
+	double adx = (double)a.x - d.x, ady = (double)a.y - d.y;
+	double bdx = (double)b.x - d.x, bdy = (double)b.y - d.y;
+	double cdx = (double)c.x - d.x, cdy = (double)c.y - d.y;
+
+	double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+	double aLift = adx * adx + ady * ady;
+	double cdxady = cdx * ady, adxcdy = adx * cdy;
+	double bLift = bdx * bdx + bdy * bdy;
+	double adxbdy = adx * bdy, bdxady = bdx * ady;
+	double cLift = cdx * cdx + cdy * cdy;
+
+	double det = aLift * (bdxcdy - cdxbdy) + bLift * (cdxady - adxcdy) + cLift * (adxbdy - bdxady);
+	double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * aLift
+	                   + (std::abs(cdxady) + std::abs(adxcdy)) * bLift
+	                   + (std::abs(adxbdy) + std::abs(bdxady)) * cLift;
+	if (magnitude)
+		*magnitude = permanent;
+	double errBound = INCIRCLE_BOUND * permanent;
+	if (det > errBound || -det > errBound)
+		return det;
+
+	Expansion eAdx = _diff(a.x, d.x), eAdy = _diff(a.y, d.y);
+	Expansion eBdx = _diff(b.x, d.x), eBdy = _diff(b.y, d.y);
+	Expansion eCdx = _diff(c.x, d.x), eCdy = _diff(c.y, d.y);
+	Expansion eALift = _add(_mul(eAdx, eAdx), _mul(eAdy, eAdy));
+	Expansion eBLift = _add(_mul(eBdx, eBdx), _mul(eBdy, eBdy));
+	Expansion eCLift = _add(_mul(eCdx, eCdx), _mul(eCdy, eCdy));
+	Expansion exact = _mul(eALift, _sub(_mul(eBdx, eCdy), _mul(eCdx, eBdy)));
+	exact = _add(exact, _mul(eBLift, _sub(_mul(eCdx, eAdy), _mul(eAdx, eCdy))));
+	exact = _add(exact, _mul(eCLift, _sub(_mul(eAdx, eBdy), _mul(eBdx, eAdy))));
+	return _estimate(exact);
+}
+//-----------------------------------------------------------------------
 Circle::Circle(Vector2 p1, Vector2 p2, Vector2 p3)
 {
 	Vector2 c1 = .5*(p1+p2);
@@ -65,33 +280,20 @@ bool Segment2D::findIntersect(const Segment2D& other, Vector2& intersection) con
 	const Vector2& p3 = other.mA;
 	const Vector2& p4 = other.mB;
 
-
-	Vector2 d1 = p2-p1;
-	float a1 = d1.y;
-	float b1 = -d1.x;
-	float g1 = d1.x*p1.y-d1.y*p1.x;
-
-	Vector2 d3 = p4-p3;
-	float a2 = d3.y;
-	float b2 = -d3.x;
-	float g2 = d3.x*p3.y-d3.y*p3.x;
-
-	// if both segments are parallel, early out
-	if (d1.crossProduct(d3) == 0.)
+	// Both ends of each segment must be strictly on opposite sides of the other segment
+	// (this also rules out parallel segments)
+	double o1 = Predicates::orient2D(p3, p4, p1);
+	double o2 = Predicates::orient2D(p3, p4, p2);
+	if (o1 == 0 || o2 == 0 || (o1 > 0) == (o2 > 0))
+		return false;
+	double o3 = Predicates::orient2D(p1, p2, p3);
+	double o4 = Predicates::orient2D(p1, p2, p4);
+	if (o3 == 0 || o4 == 0 || (o3 > 0) == (o4 > 0))
 		return false;
 
-	Vector2 intersect;
-	float intersectx = (b2*g1-b1*g2)/(b1*a2-b2*a1);
-	float intersecty = (a2*g1-a1*g2)/(a1*b2-a2*b1);
-
-	intersect = Vector2(intersectx, intersecty);
-
-	if ((intersect-p1).dotProduct(intersect-p2)<0 && (intersect-p3).dotProduct(intersect-p4)<0)
-	{
-		intersection = intersect;
-		return true;
-	}
-	return false;
+	Real t = (Real)(o1 / (o1 - o2));
+	intersection = p1 + t * (p2 - p1);
+	return true;
 }
 //-----------------------------------------------------------------------
 bool Segment2D::intersects(const Segment2D& other) const
@@ -101,7 +303,7 @@ bool Segment2D::intersects(const Segment2D& other) const
 	Vector2 max1 = Utils::max(mA, mB);
 	Vector2 min2 = Utils::min(other.mA, other.mB);
 	Vector2 max2 = Utils::max(other.mA, other.mB);
-	if (max1.x<min2.x || max1.y<min2.y || max2.x<min1.x || max2.y<min2.y)
+	if (max1.x<min2.x || max1.y<min2.y || max2.x<min1.x || max2.y<min1.y)
 		return false;
 	Vector2 t;
 	return findIntersect(other, t);
@@ -180,36 +382,37 @@ bool Line2D::findIntersect(const Line2D& other, Vector2& intersection) const
 }
 //-----------------------------------------------------------------------
 
-void isect(Real VV0,Real VV1,Real VV2,Real D0, Real D1,Real D2,Real& isect0,Real& isect1)
+void isect(double VV0,double VV1,double VV2,double D0, double D1,double D2,double& isect0,double& isect1)
 {
 	isect0=VV0+(VV1-VV0)*D0/(D0-D1);
 	isect1=VV0+(VV2-VV0)*D0/(D0-D2);
 }
 
 
-void computeIntervals(Real VV0,Real VV1,Real VV2,Real D0,Real D1,Real D2,Real D0D1,Real D0D2,Real& isect0,Real& isect1)
+// D0D1 and D0D2 are only used for their sign
+void computeIntervals(double VV0,double VV1,double VV2,double D0,double D1,double D2,int D0D1,int D0D2,double& isect0,double& isect1)
 {
-	if (D0D1>0.0f)
+	if (D0D1>0)
 	{
 		/* here we know that D0D2<=0.0 */
 		/* that is D0, D1 are on the same side, D2 on the other or on the plane */
 		isect(VV2,VV0,VV1,D2,D0,D1,isect0,isect1);
 	}
-	else if (D0D2>0.0f)
+	else if (D0D2>0)
 	{
 		/* here we know that d0d1<=0.0 */
 		isect(VV1,VV0,VV2,D1,D0,D2,isect0,isect1);
 	}
-	else if (D1*D2>0.0f || D0!=0.0f)
+	else if ((D1>0 && D2>0) || (D1<0 && D2<0) || D0!=0.0)
 	{
 		/* here we know that d0d1<=0.0 or that D0!=0.0 */
 		isect(VV0,VV1,VV2,D0,D1,D2,isect0,isect1);
 	}
-	else if (D1!=0.0f)
+	else if (D1!=0.0)
 	{
 		isect(VV1,VV0,VV2,D1,D0,D2,isect0,isect1);
 	}
-	else if (D2!=0.0f)
+	else if (D2!=0.0)
 	{
 		isect(VV2,VV0,VV1,D2,D0,D1,isect0,isect1);
 	}
@@ -220,55 +423,51 @@ void computeIntervals(Real VV0,Real VV1,Real VV2,Real D0,Real D1,Real D2,Real D0
 	}
 }
 
-bool Triangle3D::findIntersect(const Triangle3D& other, Segment3D& intersection) const
+inline int sign(double v)
 {
-	// Compute plane equation of first triangle
-	Vector3 e1 = mPoints[1]-mPoints[0];
-	Vector3 e2 = mPoints[2]-mPoints[0];
-	Vector3 n1 = e1.crossProduct(e2);
-	Real d1 = - n1.dotProduct(mPoints[0]);
+	return (v > 0) - (v < 0);
+}
 
-	// Put second triangle in first plane equation to compute distances to the plane
-	Real du[3];
+bool Triangle3D::findIntersect(const Triangle3D& other, Segment3D& intersection) const
+{
+	// Signed distances (times the normal's length) of second triangle's points to the plane of the first one.
+	// Their sign is exact, so that a point is on the plane only if it really is.
+	double du[3];
 	for (short i=0; i<3; i++)
-	{
-		du[i] = n1.dotProduct(other.mPoints[i]) + d1;
-		if (Math::Abs(du[i])<1e-6)
-			du[i]=0.0;
-	}
+		du[i] = Predicates::orient3D(mPoints[0], mPoints[1], mPoints[2], other.mPoints[i]);
 
-	Real du0du1=du[0]*du[1];
-	Real du0du2=du[0]*du[2];
+	int du0du1=sign(du[0])*sign(du[1]);
+	int du0du2=sign(du[0])*sign(du[2]);
 
-	if (du0du1>0.0f && du0du2>0.0f) /* same sign on all of them + not equal 0 ? */
+	if (du0du1>0 && du0du2>0) /* same sign on all of them + not equal 0 ? */
 		return false;                    /* no intersection occurs */
 
-	// Compute plane equation of first triangle
-	e1 = other.mPoints[1]-other.mPoints[0];
-	e2 = other.mPoints[2]-other.mPoints[0];
-	Vector3 n2 = e1.crossProduct(e2);
-	Real d2 = - n2.dotProduct(other.mPoints[0]);
-
-	// Put first triangle in second plane equation to compute distances to the plane
-	Real dv[3];
+	// Same for the first triangle's points against the plane of the second one
+	double dv[3];
 	for (short i=0; i<3; i++)
-	{
-		dv[i] = n2.dotProduct(mPoints[i]) + d2;
-		if (Math::Abs(dv[i])<1e-6)
-			dv[i]=0.0;
-	}
+		dv[i] = Predicates::orient3D(other.mPoints[0], other.mPoints[1], other.mPoints[2], mPoints[i]);
 
-	Real dv0dv1=dv[0]*dv[1];
-	Real dv0dv2=dv[0]*dv[2];
+	int dv0dv1=sign(dv[0])*sign(dv[1]);
+	int dv0dv2=sign(dv[0])*sign(dv[2]);
 
-	if (dv0dv1>0.0f && dv0dv2>0.0f) /* same sign on all of them + not equal 0 ? */
+	if (dv0dv1>0 && dv0dv2>0) /* same sign on all of them + not equal 0 ? */
 		return false;                    /* no intersection occurs */
 
+	// We don't do coplanar triangles
+	if (du[0]==0 && du[1]==0 && du[2]==0)
+		return false;
+
+	// Compute plane equations
+	Vector3 n1 = (mPoints[1]-mPoints[0]).crossProduct(mPoints[2]-mPoints[0]);
+	Real d1 = - n1.dotProduct(mPoints[0]);
+	Vector3 n2 = (other.mPoints[1]-other.mPoints[0]).crossProduct(other.mPoints[2]-other.mPoints[0]);
+	Real d2 = - n2.dotProduct(other.mPoints[0]);
+
 	//Compute the direction of intersection line
 	Vector3 d = n1.crossProduct(n2);
 
-	// We don't do coplanar triangles
-	if (d.squaredLength()<1e-6)
+	// Degenerate triangles, or planes too close to parallel to get a meaningful intersection line
+	if (d.squaredLength() <= 1e-12 * n1.squaredLength() * n2.squaredLength())
 		return false;
 
 	// Project triangle points onto the intersection line
@@ -282,16 +481,16 @@ bool Triangle3D::findIntersect(const Triangle3D& other, Segment3D& intersection)
 	if (c>max) max=c,index=2;
 
 	/* this is the simplified projection onto L*/
-	Real vp0=mPoints[0][index];
-	Real vp1=mPoints[1][index];
-	Real vp2=mPoints[2][index];
+	double vp0=mPoints[0][index];
+	double vp1=mPoints[1][index];
+	double vp2=mPoints[2][index];
 
-	Real up0=other.mPoints[0][index];
-	Real up1=other.mPoints[1][index];
-	Real up2=other.mPoints[2][index];
+	double up0=other.mPoints[0][index];
+	double up1=other.mPoints[1][index];
+	double up2=other.mPoints[2][index];
 
-	Real isect1[2];
-	Real isect2[2];
+	double isect1[2];
+	double isect2[2];
 	/* compute interval for triangle 1 */
 	computeIntervals(vp0,vp1,vp2,dv[0],dv[1],dv[2],dv0dv1,dv0dv2,isect1[0],isect1[1]);
 
@@ -306,8 +505,8 @@ bool Triangle3D::findIntersect(const Triangle3D& other, Segment3D& intersection)
 	if (isect1[1]<isect2[0] || isect2[1]<isect1[0]) return false;
 
 	// Deproject segment onto line
-	Real r1 = std::max(isect1[0], isect2[0]);
-	Real r2 = std::min(isect1[1], isect2[1]);
+	Real r1 = (Real)std::max(isect1[0], isect2[0]);
+	Real r2 = (Real)std::min(isect1[1], isect2[1]);
 
 	Plane pl1(n1.x, n1.y, n1.z, d1);
 	Plane pl2(n2.x, n2.y, n2.z, d2);
@@ -323,5 +522,313 @@ bool Triangle3D::findIntersect(const Triangle3D& other, Segment3D& intersection)
 
 	return true;
 }
+//-----------------------------------------------------------------------
+void IndexHashMap::reserve(size_t count)
+{
+	// Keep the load factor below 1/2
+	size_t capacity = 16;
+	while (capacity < count * 2)
+		capacity <<= 1;
+	if (capacity <= mValues.size())
+		return;
+	std::vector<Ogre::uint64> oldKeys;
+	std::vector<int> oldValues;
+	oldKeys.swap(mKeys);
+	oldValues.swap(mValues);
+	mKeys.resize(capacity);
+	mValues.assign(capacity, -1);
+	mMask = capacity - 1;
+	mSize = 0;
+	for (size_t i = 0; i < oldValues.size(); ++i)
+		if (oldValues[i] != -1)
+			set(oldKeys[i], oldValues[i]);
+}
+//-----------------------------------------------------------------------
+void IndexHashMap::_grow()
+{
+	reserve(mSize + 1);
+}
+//-----------------------------------------------------------------------
+int IndexHashMap::insert(Ogre::uint64 key, int value)
+{
+	if ((mSize + 1) * 2 > mValues.size())
+		_grow();
+	size_t i = _hash(key) & mMask;
+	for (; mValues[i] != -1; i = (i + 1) & mMask)
+		if (mKeys[i] == key)
+			return mValues[i];
+	mKeys[i] = key;
+	mValues[i] = value;
+	mSize++;
+	return value;
+}
+//-----------------------------------------------------------------------
+void IndexHashMap::set(Ogre::uint64 key, int value)
+{
+	if ((mSize + 1) * 2 > mValues.size())
+		_grow();
+	size_t i = _hash(key) & mMask;
+	for (; mValues[i] != -1; i = (i + 1) & mMask)
+		if (mKeys[i] == key)
+		{
+			mValues[i] = value;
+			return;
+		}
+	mKeys[i] = key;
+	mValues[i] = value;
+	mSize++;
+}
+//-----------------------------------------------------------------------
+struct SegmentGrid2D::CellCounter
+{
+	std::vector<size_t>& mCellStart;
+	CellCounter(std::vector<size_t>& cellStart) : mCellStart(cellStart) {}
+	void operator()(int cell)
+	{
+		mCellStart[cell + 1]++;
+	}
+};
+//-----------------------------------------------------------------------
+struct SegmentGrid2D::CellFiller
+{
+	std::vector<size_t>& mCursor;
+	std::vector<size_t>& mCellSegments;
+	size_t mSegment;
+	CellFiller(std::vector<size_t>& cursor, std::vector<size_t>& cellSegments) : mCursor(cursor), mCellSegments(cellSegments), mSegment(0) {}
+	void operator()(int cell)
+	{
+		mCellSegments[mCursor[cell]++] = mSegment;
+	}
+};
+//-----------------------------------------------------------------------
+struct SegmentGrid2D::CellCollector
+{
+	const SegmentGrid2D& mGrid;
+	std::vector<size_t>& mResult;
+	CellCollector(const SegmentGrid2D& grid, std::vector<size_t>& result) : mGrid(grid), mResult(result) {}
+	void operator()(int cell)
+	{
+		mResult.insert(mResult.end(), mGrid.mCellSegments.begin() + mGrid.mCellStart[cell], mGrid.mCellSegments.begin() + mGrid.mCellStart[cell + 1]);
+		if (!mGrid.mInsertedSegments.empty())
+			mResult.insert(mResult.end(), mGrid.mInsertedSegments[cell].begin(), mGrid.mInsertedSegments[cell].end());
+	}
+};
+//-----------------------------------------------------------------------
+struct SegmentGrid2D::CellInserter
+{
+	std::vector<std::vector<size_t> >& mInsertedSegments;
+	size_t mSegment;
+	CellInserter(std::vector<std::vector<size_t> >& insertedSegments, size_t segment) : mInsertedSegments(insertedSegments), mSegment(segment) {}
+	void operator()(int cell)
+	{
+		mInsertedSegments[cell].push_back(mSegment);
+	}
+};
+//-----------------------------------------------------------------------
+int SegmentGrid2D::_cellX(Real x) const
+{
+	Real v = (x - mOrigin.x) / mCellSize;
+	if (!(v > 0))
+		return 0;
+	return std::min((int)v, mCellsX - 1);
+}
+//-----------------------------------------------------------------------
+int SegmentGrid2D::_cellY(Real y) const
+{
+	Real v = (y - mOrigin.y) / mCellSize;
+	if (!(v > 0))
+		return 0;
+	return std::min((int)v, mCellsY - 1);
+}
+//-----------------------------------------------------------------------
+template <class F>
+void SegmentGrid2D::_forEachCell(const Vector2& a, const Vector2& b, F& functor) const
+{
+	if (mCellsX == 0)
+		return;
+	// Cells are slightly enlarged, so that rounding errors can't make a segment miss a cell it touches
+	Real margin = mCellSize * 1e-3f;
+	const Vector2& p = (a.x <= b.x) ? a : b;
+	const Vector2& q = (a.x <= b.x) ? b : a;
+	int x0 = _cellX(p.x - margin);
+	int x1 = _cellX(q.x + margin);
+	Real slope = (q.x > p.x) ? (q.y - p.y) / (q.x - p.x) : 0;
+	for (int cx = x0; cx <= x1; ++cx)
+	{
+		Real yStart = p.y, yEnd = q.y;
+		if (q.x > p.x)
+		{
+			Real xStart = std::max(p.x, mOrigin.x + cx * mCellSize - margin);
+			Real xEnd = std::min(q.x, mOrigin.x + (cx + 1) * mCellSize + margin);
+			yStart = p.y + (xStart - p.x) * slope;
+			yEnd = p.y + (xEnd - p.x) * slope;
+		}
+		int y0 = _cellY(std::min(yStart, yEnd) - margin);
+		int y1 = _cellY(std::max(yStart, yEnd) + margin);
+		for (int cy = y0; cy <= y1; ++cy)
+			functor(cx + cy * mCellsX);
+	}
+}
+//-----------------------------------------------------------------------
+void SegmentGrid2D::build(const std::vector<Segment2D>& segments)
+{
+	if (segments.empty())
+	{
+		build(segments, Vector2::ZERO, Vector2::ZERO);
+		return;
+	}
+	Vector2 boxMin = Utils::min(segments[0].mA, segments[0].mB);
+	Vector2 boxMax = Utils::max(segments[0].mA, segments[0].mB);
+	for (std::vector<Segment2D>::const_iterator it = segments.begin(); it != segments.end(); ++it)
+	{
+		boxMin = Utils::min(boxMin, Utils::min(it->mA, it->mB));
+		boxMax = Utils::max(boxMax, Utils::max(it->mA, it->mB));
+	}
+	build(segments, boxMin, boxMax);
+}
+//-----------------------------------------------------------------------
+void SegmentGrid2D::build(const std::vector<Segment2D>& segments, const Vector2& boxMin, const Vector2& boxMax)
+{
+	mCellStart.clear();
+	mCellSegments.clear();
+	mInsertedSegments.clear();
+	mCellsX = mCellsY = 0;
+	if (segments.empty())
+		return;
+
+	Vector2 size = boxMax - boxMin;
+	size_t count = segments.size();
+
+	// About one cell per segment
+	double extent = std::max(size.x, size.y);
+	double cellSize = (size.x > 0 && size.y > 0) ? std::sqrt((double)size.x * size.y / count) : extent / count;
+	if (!(cellSize > 0))
+		cellSize = 1;
+	double maxCells = 4. * count + 16;
+	while ((std::floor(size.x / cellSize) + 1) * (std::floor(size.y / cellSize) + 1) > maxCells)
+		cellSize *= 1.5;
+	mOrigin = boxMin;
+	mCellSize = (Real)cellSize;
+	mCellsX = (int)(size.x / cellSize) + 1;
+	mCellsY = (int)(size.y / cellSize) + 1;
+
+	// Count the segments of each cell, then fill the cells
+	mCellStart.assign(mCellsX * mCellsY + 1, 0);
+	CellCounter counter(mCellStart);
+	for (std::vector<Segment2D>::const_iterator it = segments.begin(); it != segments.end(); ++it)
+		_forEachCell(it->mA, it->mB, counter);
+	for (size_t i = 1; i < mCellStart.size(); ++i)
+		mCellStart[i] += mCellStart[i - 1];
+	mCellSegments.resize(mCellStart.back());
+	std::vector<size_t> cursor(mCellStart.begin(), mCellStart.end() - 1);
+	CellFiller filler(cursor, mCellSegments);
+	for (size_t i = 0; i < count; ++i)
+	{
+		filler.mSegment = i;
+		_forEachCell(segments[i].mA, segments[i].mB, filler);
+	}
+}
+//-----------------------------------------------------------------------
+void SegmentGrid2D::insert(const Segment2D& segment, size_t index)
+{
+	if (mCellsX == 0)
+		return;
+	if (mInsertedSegments.empty())
+		mInsertedSegments.resize(mCellsX * mCellsY);
+	CellInserter inserter(mInsertedSegments, index);
+	_forEachCell(segment.mA, segment.mB, inserter);
+}
+//-----------------------------------------------------------------------
+void SegmentGrid2D::query(const Segment2D& segment, std::vector<size_t>& result) const
+{
+	size_t first = result.size();
+	CellCollector collector(*this, result);
+	_forEachCell(segment.mA, segment.mB, collector);
+	std::sort(result.begin() + first, result.end());
+	result.erase(std::unique(result.begin() + first, result.end()), result.end());
+}
+//-----------------------------------------------------------------------
+void SegmentGrid2D::query(const Vector2& boxMin, const Vector2& boxMax, std::vector<size_t>& result) const
+{
+	if (mCellsX == 0)
+		return;
+	size_t first = result.size();
+	Real margin = mCellSize * 1e-3f;
+	CellCollector collector(*this, result);
+	for (int cy = _cellY(boxMin.y - margin); cy <= _cellY(boxMax.y + margin); ++cy)
+		for (int cx = _cellX(boxMin.x - margin); cx <= _cellX(boxMax.x + margin); ++cx)
+			collector(cx + cy * mCellsX);
+	std::sort(result.begin() + first, result.end());
+	result.erase(std::unique(result.begin() + first, result.end()), result.end());
+}
+//-----------------------------------------------------------------------
+namespace
+{
+/// Finds a segment touching vertex that was not used yet, marks it as used and returns its other end, or -1
+int _takeNextSegment(int vertex, const std::vector<int>& segmentEnds, const std::vector<size_t>& incidentSegments,
+                     const std::vector<size_t>& incidentEnd, std::vector<size_t>& cursor, std::vector<bool>& used)
+{
+	// Used segments are never reconsidered, so each incidence list is scanned once overall
+	for (size_t& i = cursor[vertex]; i < incidentEnd[vertex]; ++i)
+	{
+		size_t seg = incidentSegments[i];
+		if (used[seg])
+			continue;
+		used[seg] = true;
+		++i;
+		return segmentEnds[2 * seg] == vertex ? segmentEnds[2 * seg + 1] : segmentEnds[2 * seg];
+	}
+	return -1;
+}
+}
+//-----------------------------------------------------------------------
+void SegmentChainer::chain(const std::vector<int>& segmentEnds, size_t vertexCount, std::vector<std::vector<int> >& chains)
+{
+	size_t segCount = segmentEnds.size() / 2;
+	std::vector<bool> used(segCount, false);
+
+	// Segments touching vertex v are incidentSegments[cursor[v]] to incidentSegments[incidentEnd[v]-1]
+	std::vector<size_t> incidentEnd(vertexCount + 1, 0);
+	for (size_t i = 0; i < segCount; ++i)
+	{
+		if (segmentEnds[2 * i] == segmentEnds[2 * i + 1])
+		{
+			used[i] = true;
+			continue;
+		}
+		incidentEnd[segmentEnds[2 * i] + 1]++;
+		incidentEnd[segmentEnds[2 * i + 1] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+		incidentEnd[v + 1] += incidentEnd[v];
+	std::vector<size_t> cursor(incidentEnd.begin(), incidentEnd.end() - 1);
+	std::vector<size_t> incidentSegments(incidentEnd.back());
+	for (size_t i = 0; i < segCount; ++i)
+	{
+		if (used[i])
+			continue;
+		incidentSegments[cursor[segmentEnds[2 * i]]++] = i;
+		incidentSegments[cursor[segmentEnds[2 * i + 1]]++] = i;
+	}
+	cursor.assign(incidentEnd.begin(), incidentEnd.end() - 1);
+	incidentEnd.erase(incidentEnd.begin());
 
+	std::deque<int> current;
+	for (size_t i = 0; i < segCount; ++i)
+	{
+		if (used[i])
+			continue;
+		used[i] = true;
+		current.clear();
+		current.push_back(segmentEnds[2 * i]);
+		current.push_back(segmentEnds[2 * i + 1]);
+		for (int next = _takeNextSegment(current.back(), segmentEnds, incidentSegments, incidentEnd, cursor, used); next != -1;
+		        next = _takeNextSegment(current.back(), segmentEnds, incidentSegments, incidentEnd, cursor, used))
+			current.push_back(next);
+		for (int previous = _takeNextSegment(current.front(), segmentEnds, incidentSegments, incidentEnd, cursor, used); previous != -1;
+		        previous = _takeNextSegment(current.front(), segmentEnds, incidentSegments, incidentEnd, cursor, used))
+			current.push_front(previous);
+		chains.push_back(std::vector<int>(current.begin(), current.end()));
+	}
+}
 }
@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "ProceduralStableHeaders.h"
 #include "ProceduralIcoSphereGenerator.h"
 #include "ProceduralUtils.h"
+#include "ProceduralGeometryHelpers.h"
 
 using namespace Ogre;
 
@@ -35,8 +36,14 @@ namespace Procedural
 {
 void IcoSphereGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 {
+	// Each iteration splits every triangle in 4, adding one vertex per edge : V = 10*4^n+2, F = 20*4^n, E = 30*4^n
+	size_t faceCount = 20;
+	for (unsigned int iteration = 0; iteration<mNumIterations; iteration++)
+		faceCount*=4;
+	size_t vertexCount = faceCount/2 + 2;
+
 	std::vector<Vector3> vertices;
-	int offset = 0;
+	vertices.reserve(vertexCount);
 
 	/// Step 1 : Generate icosahedron
 	Real phi = .5f*(1.f+sqrt(5.f));
@@ -78,50 +85,77 @@ void IcoSphereGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 	                   };
 
 	std::vector<int> faces(firstFaces, firstFaces + sizeof(firstFaces)/sizeof(*firstFaces));
+	faces.reserve(faceCount*3);
 	int size = 60;
 
 	/// Step 2 : tessellate
-	for (unsigned short iteration = 0; iteration<mNumIterations; iteration++)
+	std::vector<int> newFaces;
+	newFaces.reserve(faceCount*3);
+	std::vector<int> edgeEnds;
+	IndexHashMap midPoints;
+	for (unsigned int iteration = 0; iteration<mNumIterations; iteration++)
 	{
+		int firstNewVertex = vertices.size();
+		int edgeCount = size/2;
 		size*=4;
-		std::vector<int> newFaces;
-		newFaces.clear();
-		//newFaces.resize(size);
+		newFaces.resize(size);
+		edgeEnds.resize(2*edgeCount);
+		midPoints.clear();
+		midPoints.reserve(edgeCount);
+		// Each edge is shared by two triangles : its middle is only created once
+		int newVertex = firstNewVertex;
 		for (int i=0; i<size/12; i++)
 		{
 			int i1 = faces[i*3];
 			int i2 = faces[i*3+1];
 			int i3 = faces[i*3+2];
-			int i12 = vertices.size();
-			int i23 = i12+1;
-			int i13 = i12+2;
-			Vector3 v1 = vertices[i1];
-			Vector3 v2 = vertices[i2];
-			Vector3 v3 = vertices[i3];
-			//make 1 vertice at the center of each edge and project it onto the sphere
-			vertices.push_back((v1+v2).normalisedCopy());
-			vertices.push_back((v2+v3).normalisedCopy());
-			vertices.push_back((v1+v3).normalisedCopy());
+			int mid[3];
+			int ends[6] = {i1, i2, i2, i3, i1, i3};
+			for (int k=0; k<3; k++)
+			{
+				mid[k] = midPoints.insert(IndexHashMap::pairKey(ends[2*k], ends[2*k+1]), newVertex);
+				if (mid[k] == newVertex)
+				{
+					edgeEnds[2*(newVertex-firstNewVertex)] = ends[2*k];
+					edgeEnds[2*(newVertex-firstNewVertex)+1] = ends[2*k+1];
+					newVertex++;
+				}
+			}
+			int i12 = mid[0];
+			int i23 = mid[1];
+			int i13 = mid[2];
 			//now recreate indices
-			newFaces.push_back(i1);
-			newFaces.push_back(i12);
-			newFaces.push_back(i13);
-			newFaces.push_back(i2);
-			newFaces.push_back(i23);
-			newFaces.push_back(i12);
-			newFaces.push_back(i3);
-			newFaces.push_back(i13);
-			newFaces.push_back(i23);
-			newFaces.push_back(i12);
-			newFaces.push_back(i23);
-			newFaces.push_back(i13);
+			int* newFace = &newFaces[i*12];
+			newFace[0] = i1;
+			newFace[1] = i12;
+			newFace[2] = i13;
+			newFace[3] = i2;
+			newFace[4] = i23;
+			newFace[5] = i12;
+			newFace[6] = i3;
+			newFace[7] = i13;
+			newFace[8] = i23;
+			newFace[9] = i12;
+			newFace[10] = i23;
+			newFace[11] = i13;
 		}
+		//make 1 vertice at the center of each edge and project it onto the sphere
+		vertices.resize(firstNewVertex + edgeCount);
+#ifdef PROCEDURAL_USE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int i=0; i<edgeCount; i++)
+			vertices[firstNewVertex+i] = (vertices[edgeEnds[2*i]]+vertices[edgeEnds[2*i+1]]).normalisedCopy();
 		faces.swap(newFaces);
 	}
 
 	/// Step 3 : generate texcoords
-	std::vector<Vector2> texCoords;
-	for (unsigned short i=0; i<vertices.size(); i++)
+	int meshVertexCount = vertices.size();
+	std::vector<Vector2> texCoords(meshVertexCount);
+#ifdef PROCEDURAL_USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int i=0; i<meshVertexCount; i++)
 	{
 		const Vector3& vec = vertices[i];
 		Real u, v;
@@ -130,7 +164,7 @@ void IcoSphereGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 		alpha = atan2f(vec.z,vec.x);
 		u = alpha/Math::TWO_PI+.5f;
 		v = atan2f(vec.y, r0)/Math::PI + .5f;
-		texCoords.push_back(Vector2(u,v));
+		texCoords[i] = Vector2(u,v);
 	}
 
 	/// Step 4 : fix texcoords
@@ -166,7 +200,10 @@ void IcoSphereGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 	}
 
 	//split vertices
-	for (unsigned short i=0; i<indexToSplit.size(); i++)
+	std::sort(indexToSplit.begin(), indexToSplit.end());
+	indexToSplit.erase(std::unique(indexToSplit.begin(), indexToSplit.end()), indexToSplit.end());
+	std::vector<int> splitIndex(meshVertexCount, -1);
+	for (size_t i=0; i<indexToSplit.size(); i++)
 	{
 		int index = indexToSplit[i];
 		//duplicate vertex
@@ -174,37 +211,45 @@ void IcoSphereGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 		Vector2 t = texCoords[index] + Vector2::UNIT_X;
 		vertices.push_back(v);
 		texCoords.push_back(t);
-		int newIndex = vertices.size()-1;
-		//reassign indices
-		for (unsigned short j=0; j<faces.size(); j++)
+		splitIndex[index] = vertices.size()-1;
+	}
+	//reassign indices, in one pass over the faces
+	for (size_t j=0; j<faces.size(); j++)
+	{
+		int index = faces[j];
+		if (index >= meshVertexCount || splitIndex[index] == -1)
+			continue;
+		int index1 = faces[(j+1)%3+(j/3)*3];
+		int index2 = faces[(j+2)%3+(j/3)*3];
+		if ((texCoords[index1].x>0.5) || (texCoords[index2].x>0.5))
 		{
-			if (faces[j]==index)
-			{
-				int index1 = faces[(j+1)%3+(j/3)*3];
-				int index2 = faces[(j+2)%3+(j/3)*3];
-				if ((texCoords[index1].x>0.5) || (texCoords[index2].x>0.5))
-				{
-					faces[j] = newIndex;
-				}
-			}
+			faces[j] = splitIndex[index];
 		}
 	}
 
 	/// Step 5 : realize
 	buffer.rebaseOffset();
-	buffer.estimateVertexCount(vertices.size());
-	buffer.estimateIndexCount(size);
-
-	for (unsigned short i=0; i<vertices.size(); i++)
+	std::vector<TriangleBuffer::Vertex>& bufferVertices = buffer.getVertices();
+	std::vector<int>& bufferIndices = buffer.getIndices();
+	int firstVertex = bufferVertices.size();
+	size_t firstIndex = bufferIndices.size();
+	int finalVertexCount = vertices.size();
+	bufferVertices.resize(firstVertex + finalVertexCount);
+	bufferIndices.resize(firstIndex + size);
+
+#ifdef PROCEDURAL_USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int i=0; i<finalVertexCount; i++)
 	{
-		addPoint(buffer, mRadius*vertices[i],
+		setPoint(bufferVertices[firstVertex + i], mRadius*vertices[i],
 		         vertices[i],//note : vertices are already normalised
 		         Vector2(texCoords[i].x,texCoords[i].y));
 	}
-	for (unsigned short i=0; i<size; i++)
+	for (int i=0; i<size; i++)
 	{
-		buffer.index(offset+faces[i]);
+		bufferIndices[firstIndex + i] = firstVertex + faces[i];
 	}
-	offset+=vertices.size();
+	buffer.rebaseOffset();
 }
 }
@@ -34,92 +34,107 @@ using namespace Ogre;
 namespace Procedural
 {
 //-----------------------------------------------------------------------
-void Lathe::_latheBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude) const
+void Lathe::_latheBodyImpl(TriangleBuffer& buffer, const Shape* shapeToExtrude, const std::vector<Vector2>& sliceRotations) const
 {
 	if (shapeToExtrude == NULL)
 		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "Shape must not be null!", "Procedural::Lathe::_latheBodyImpl(Procedural::TriangleBuffer&, const Procedural::Shape*)");
 	int numSegShape = shapeToExtrude->getSegCount();
 	if (numSegShape < 2)
 		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "Shape must contain at least two points", "Procedural::Lathe::_latheBodyImpl(Procedural::TriangleBuffer&, const Procedural::Shape*)");
-	int offset =0;
 
 	//int numSeg = mClosed?mNumSeg+1:mNumSeg;
 	int numSeg = mNumSeg+1;
-	buffer.rebaseOffset();
-	buffer.estimateIndexCount(numSeg*numSegShape*6);
-	buffer.estimateVertexCount((numSegShape+1)*(numSeg+1));
+	int profileSize = numSegShape+1;
+	bool outSideRight = shapeToExtrude->getOutSide() == SIDE_RIGHT;
 
-	Radian angleEnd(mAngleEnd);
-	if (mAngleBegin>mAngleEnd)
-		angleEnd+=(Radian)Math::TWO_PI;
+	// The profile is the same for every slice : only its rotation around Y changes
+	std::vector<Real> profileX(profileSize), profileY(profileSize);
+	std::vector<Real> normalX(profileSize), normalY(profileSize);
+	for (int j=0; j<profileSize; j++)
+	{
+		const Vector2& v0 = shapeToExtrude->getPoint(j);
+		Vector2 vp2normal = shapeToExtrude->getAvgDirection(j).perpendicular();
+		vp2normal.normalise();
+		if (outSideRight)
+			vp2normal = -vp2normal;
+		profileX[j] = v0.x;
+		profileY[j] = v0.y;
+		normalX[j] = vp2normal.x;
+		normalY[j] = vp2normal.y;
+	}
 
+	// Slices and the quads joining them are written in place, each slice in its own part of the buffers
+	buffer.rebaseOffset();
+	std::vector<TriangleBuffer::Vertex>& vertices = buffer.getVertices();
+	std::vector<int>& indices = buffer.getIndices();
+	int firstVertex = vertices.size();
+	size_t firstIndex = indices.size();
+	vertices.resize(firstVertex + numSeg * profileSize);
+	indices.resize(firstIndex + (numSeg-1) * numSegShape * 6);
+
+#ifdef PROCEDURAL_USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
 	for (int i=0; i<numSeg; i++)
 	{
-		Radian angle;
-		if (mClosed)
-			angle = i/(Real)mNumSeg*Math::TWO_PI;
-		else
-			angle = mAngleBegin + i/(Real)mNumSeg*(angleEnd-mAngleBegin);
-		Quaternion q;
-		q.FromAngleAxis(angle,Vector3::UNIT_Y);
-
-		for (int j=0; j<=numSegShape; j++)
+		// Rotating (x, y, 0) around Y by angle gives (x*cos, y, -x*sin)
+		Real c = sliceRotations[i].x;
+		Real s = sliceRotations[i].y;
+		Real u = i/(Real)mNumSeg;
+		TriangleBuffer::Vertex* slice = &vertices[firstVertex + i * profileSize];
+		for (int j=0; j<profileSize; j++)
+			setPoint(slice[j], Vector3(profileX[j]*c, profileY[j], -profileX[j]*s),
+			         Vector3(normalX[j]*c, normalY[j], -normalX[j]*s),
+			         Vector2(u, j/(Real)numSegShape));
+
+		if (i == numSeg-1)
+			continue;
+		int* quad = &indices[firstIndex + i * numSegShape * 6];
+		for (int j=0; j<numSegShape; j++, quad += 6)
 		{
-			const Vector2& v0 = shapeToExtrude->getPoint(j);
-			Vector3 vp(v0.x,v0.y,0);
-			const Vector2& vp2direction = shapeToExtrude->getAvgDirection(j);
-			Vector2 vp2normal = vp2direction.perpendicular();
-			Vector3 normal(vp2normal.x, vp2normal.y, 0);
-			normal.normalise();
-			if (shapeToExtrude->getOutSide() == SIDE_RIGHT)
-				normal = -normal;
-
-			addPoint(buffer, q*vp,
-			         q*normal,
-			         Vector2(i/(Real)mNumSeg, j/(Real)numSegShape));
-
-			if (j <numSegShape && i <numSeg-1)
+			int offset = firstVertex + i * profileSize + j;
+			if (outSideRight)
+			{
+				quad[0] = offset + numSegShape + 2;
+				quad[1] = offset;
+				quad[2] = offset + numSegShape + 1;
+				quad[3] = offset + numSegShape + 2;
+				quad[4] = offset + 1;
+				quad[5] = offset;
+			}
+			else
 			{
-				if (shapeToExtrude->getOutSide() == SIDE_RIGHT)
-				{
-					buffer.triangle(offset + numSegShape + 2, offset, offset + numSegShape + 1);
-					buffer.triangle(offset + numSegShape + 2, offset + 1, offset);
-				}
-				else
-				{
-					buffer.triangle(offset + numSegShape + 2, offset + numSegShape + 1, offset);
-					buffer.triangle(offset + numSegShape + 2, offset, offset + 1);
-				}
+				quad[0] = offset + numSegShape + 2;
+				quad[1] = offset + numSegShape + 1;
+				quad[2] = offset;
+				quad[3] = offset + numSegShape + 2;
+				quad[4] = offset;
+				quad[5] = offset + 1;
 			}
-			offset ++;
 		}
 	}
+	buffer.rebaseOffset();
 }
 //-----------------------------------------------------------------------
 void Lathe::_latheCapImpl(TriangleBuffer& buffer) const
 {
+	MultiShape multishapeCopy;
+	if (mShapeToExtrude)
+		multishapeCopy.addShape(*mShapeToExtrude);
+	else
+		multishapeCopy = *mMultiShapeToExtrude;
+	multishapeCopy.close();
+
 	std::vector<int> indexBuffer;
 	PointList pointList;
-
-	buffer.rebaseOffset();
-
 	Triangulator t;
-	Shape shapeCopy;
-	MultiShape multishapeCopy;
-
 	if (mShapeToExtrude)
-	{
-		shapeCopy = *mShapeToExtrude;
-		shapeCopy.close();
-		t.setShapeToTriangulate(&shapeCopy);
-	}
+		t.setShapeToTriangulate(&multishapeCopy.getShape(0));
 	else
-	{
-		multishapeCopy = *mMultiShapeToExtrude;
-		multishapeCopy.close();
-		t.setMultiShapeToTriangulate(mMultiShapeToExtrude);
-	}
+		t.setMultiShapeToTriangulate(&multishapeCopy);
 	t.triangulate(indexBuffer, pointList);
+
+	buffer.rebaseOffset();
 	buffer.estimateIndexCount(2*indexBuffer.size());
 	buffer.estimateVertexCount(2*pointList.size());
 
@@ -175,12 +190,27 @@ void Lathe::addToTriangleBuffer(TriangleBuffer& buffer) const
 	if (!mClosed && mCapped)
 		_latheCapImpl(buffer);
 
+	// Rotation of each slice, shared by all the shapes
+	Radian angleEnd(mAngleEnd);
+	if (mAngleBegin>mAngleEnd)
+		angleEnd+=(Radian)Math::TWO_PI;
+	std::vector<Vector2> sliceRotations(mNumSeg+1);
+	for (unsigned int i=0; i<=mNumSeg; i++)
+	{
+		Radian angle;
+		if (mClosed)
+			angle = i/(Real)mNumSeg*Math::TWO_PI;
+		else
+			angle = mAngleBegin + i/(Real)mNumSeg*(angleEnd-mAngleBegin);
+		sliceRotations[i] = Vector2(Math::Cos(angle), Math::Sin(angle));
+	}
+
 	// Extrudes the body
 	if (mShapeToExtrude)
-		_latheBodyImpl(buffer, mShapeToExtrude);
+		_latheBodyImpl(buffer, mShapeToExtrude, sliceRotations);
 	else
 		for (unsigned int i=0; i<mMultiShapeToExtrude->getShapeCount(); i++)
-			_latheBodyImpl(buffer, &mMultiShapeToExtrude->getShape(i));
+			_latheBodyImpl(buffer, &mMultiShapeToExtrude->getShape(i), sliceRotations);
 
 
 }
@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "ProceduralStableHeaders.h"
 #include "ProceduralMultiShape.h"
 #include "ProceduralShape.h"
+#include "ProceduralShapeClipper.h"
 #include "OgreRoot.h"
 
 using namespace Ogre;
@@ -88,6 +89,30 @@ std::vector<Vector2> MultiShape::getPoints() const
 }
 //-----------------------------------------------------------------------
 
+namespace
+{
+/// Tells on which side of the closest segment crossing the horizontal line through a point that point lies
+bool _isPointInsideFromClosestSegment(const Vector2& point, const Shape* closestSegmentShape, int closestSegmentIndex, const Vector2& closestSegmentIntersection)
+{
+	int edgePoint = -1;
+	if (closestSegmentIntersection.squaredDistance(closestSegmentShape->getPoint(closestSegmentIndex)) < 1e-8)
+		edgePoint = closestSegmentIndex;
+	else if (closestSegmentIntersection.squaredDistance(closestSegmentShape->getPoint(closestSegmentIndex + 1)) < 1e-8)
+		edgePoint = closestSegmentIndex + 1;
+	if (edgePoint>-1)
+	{
+		Ogre::Radian alpha1 = Utils::angleBetween(point - closestSegmentShape->getPoint(edgePoint), closestSegmentShape->getDirectionAfter(edgePoint));
+		Ogre::Radian alpha2 = Utils::angleBetween(point - closestSegmentShape->getPoint(edgePoint), -closestSegmentShape->getDirectionBefore(edgePoint));
+		if (alpha1 < alpha2)
+			closestSegmentIndex = edgePoint;
+		else
+			closestSegmentIndex = edgePoint - 1;
+	}
+	return (closestSegmentShape->getNormalAfter(closestSegmentIndex).x * (point.x - closestSegmentIntersection.x) < 0);
+}
+}
+//-----------------------------------------------------------------------
+
 bool MultiShape::isPointInside(const Vector2& point) const
 {
 	// Draw a horizontal lines that goes through "point"
@@ -119,23 +144,7 @@ bool MultiShape::isPointInside(const Vector2& point) const
 		}
 	}
 	if (closestSegmentIndex != -1)
-	{
-		int edgePoint = -1;
-		if (closestSegmentIntersection.squaredDistance(closestSegmentShape->getPoint(closestSegmentIndex)) < 1e-8)
-			edgePoint = closestSegmentIndex;
-		else if (closestSegmentIntersection.squaredDistance(closestSegmentShape->getPoint(closestSegmentIndex + 1)) < 1e-8)
-			edgePoint = closestSegmentIndex + 1;
-		if (edgePoint>-1)
-		{
-			Ogre::Radian alpha1 = Utils::angleBetween(point - closestSegmentShape->getPoint(edgePoint), closestSegmentShape->getDirectionAfter(edgePoint));
-			Ogre::Radian alpha2 = Utils::angleBetween(point - closestSegmentShape->getPoint(edgePoint), -closestSegmentShape->getDirectionBefore(edgePoint));
-			if (alpha1 < alpha2)
-				closestSegmentIndex = edgePoint;
-			else
-				closestSegmentIndex = edgePoint - 1;
-		}
-		return (closestSegmentShape->getNormalAfter(closestSegmentIndex).x * (point.x - closestSegmentIntersection.x) < 0);
-	}
+		return _isPointInsideFromClosestSegment(point, closestSegmentShape, closestSegmentIndex, closestSegmentIntersection);
 	// We're in the case where the point is on the "real outside" of the multishape
 	// So, if the real outside == user defined outside, then the point is "user-defined outside"
 	return !isOutsideRealOutside();
@@ -194,70 +203,222 @@ bool MultiShape::isOutsideRealOutside() const
 //-----------------------------------------------------------------------
 void MultiShape::buildFromSegmentSoup(const std::vector<Segment2D>& segList)
 {
-	typedef std::multimap<Vector2, Vector2, Vector2Comparator> Vec2MultiMap;
-	Vec2MultiMap segs;
+	// Same tolerance as Vector2Comparator
+	Vector2Welder welder(1e-3f);
+	welder.reserve(segList.size());
+	std::vector<int> segmentEnds;
+	segmentEnds.reserve(2 * segList.size());
 	for (std::vector<Segment2D>::const_iterator it = segList.begin(); it != segList.end(); ++it)
 	{
-		segs.insert(std::pair<Vector2, Vector2 > (it->mA, it->mB));
-		segs.insert(std::pair<Vector2, Vector2 > (it->mB, it->mA));
+		segmentEnds.push_back(welder.weld(it->mA));
+		segmentEnds.push_back(welder.weld(it->mB));
 	}
-	while (!segs.empty())
+	std::vector<std::vector<int> > chains;
+	SegmentChainer::chain(segmentEnds, welder.size(), chains);
+
+	mShapes.reserve(mShapes.size() + chains.size());
+	for (std::vector<std::vector<int> >::const_iterator it = chains.begin(); it != chains.end(); ++it)
 	{
-		Ogre::Vector2 headFirst = segs.begin()->first;
-		Ogre::Vector2 headSecond = segs.begin()->second;
 		Shape s;
-		s.addPoint(headFirst).addPoint(headSecond);
-		Vec2MultiMap::iterator firstSeg = segs.begin();
-		std::pair<Vec2MultiMap::iterator, Vec2MultiMap::iterator> correspondants2 = segs.equal_range(headSecond);
-		for (Vec2MultiMap::iterator it = correspondants2.first; it != correspondants2.second;)
+		bool closed = it->front() == it->back();
+		size_t pointCount = closed ? it->size() - 1 : it->size();
+		std::vector<Vector2>& points = s.getPointsReference();
+		points.reserve(pointCount);
+		for (size_t i = 0; i < pointCount; ++i)
+			points.push_back(welder.getPoint((*it)[i]));
+		if (closed)
+			s.close();
+		addShape(s);
+	}
+}
+//-----------------------------------------------------------------------
+MultiShape MultiShape::booleanUnion(const MultiShape& other) const
+{
+	return ShapeClipper().addSubject(*this).addClip(other).execute(ShapeClipper::CO_UNION);
+}
+//-----------------------------------------------------------------------
+MultiShape MultiShape::booleanIntersect(const MultiShape& other) const
+{
+	return ShapeClipper().addSubject(*this).addClip(other).execute(ShapeClipper::CO_INTERSECTION);
+}
+//-----------------------------------------------------------------------
+MultiShape MultiShape::booleanDifference(const MultiShape& other) const
+{
+	return ShapeClipper().addSubject(*this).addClip(other).execute(ShapeClipper::CO_DIFFERENCE);
+}
+//-----------------------------------------------------------------------
+MultiShape& MultiShape::simplify(Real tolerance, SimplificationMethod method)
+{
+	int shapeCount = (int)mShapes.size();
+	std::vector<const std::vector<Vector2>*> polylines(shapeCount);
+	std::vector<bool> closed(shapeCount);
+	std::vector<std::vector<char> > keep(shapeCount);
+	for (int i = 0; i < shapeCount; ++i)
+	{
+		polylines[i] = &mShapes[i].getPointsReference();
+		closed[i] = mShapes[i].isClosed();
+	}
+#ifdef PROCEDURAL_USE_OPENMP
+	#pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for (int i = 0; i < shapeCount; ++i)
+		PolylineSimplifier::simplify(*polylines[i], closed[i], tolerance, method, keep[i]);
+
+	// Simplified shapes may now cross each other
+	PolylineSimplifier::removeCrossings(polylines, closed, keep);
+
+	for (int i = 0; i < shapeCount; ++i)
+	{
+		std::vector<Vector2>& points = mShapes[i].getPointsReference();
+		size_t count = 0;
+		for (size_t j = 0; j < points.size(); ++j)
+			if (keep[i][j])
+				points[count++] = points[j];
+		points.resize(count);
+	}
+	return *this;
+}
+//-----------------------------------------------------------------------
+int PreparedMultiShape::_slab(Real y) const
+{
+	Real slab = (y - mOriginY) * mInvSlabHeight;
+	if (slab < 1)
+		return 0;
+	if (slab >= mSlabCount - 1)
+		return mSlabCount - 1;
+	return (int)slab;
+}
+//-----------------------------------------------------------------------
+void PreparedMultiShape::prepare(const MultiShape& multiShape)
+{
+	mMultiShape = multiShape;
+	mSlabStart.clear();
+	mAX.clear();
+	mAY.clear();
+	mBX.clear();
+	mBY.clear();
+	mShapeIndex.clear();
+	mSegmentIndex.clear();
+	mIsOutsideInside = multiShape.getShapeCount() > 0 && !multiShape.isOutsideRealOutside();
+
+	// Horizontal segments are never crossed by the horizontal line of a query, so they are left out
+	size_t segmentCount = 0;
+	Real minY = std::numeric_limits<Real>::max();
+	Real maxY = -std::numeric_limits<Real>::max();
+	for (unsigned int k = 0; k < mMultiShape.getShapeCount(); ++k)
+	{
+		const Shape& shape = mMultiShape.getShape(k);
+		for (size_t i = 0; i < shape.getSegCount(); ++i)
 		{
-			Vec2MultiMap::iterator removeIt = ++it;
-			if ((removeIt->second - firstSeg->first).squaredLength() < 1e-8)
-				segs.erase(removeIt);
+			const Vector2& A = shape.getPoint(i);
+			const Vector2& B = shape.getPoint(i + 1);
+			if (A.y == B.y)
+				continue;
+			segmentCount++;
+			minY = std::min(minY, std::min(A.y, B.y));
+			maxY = std::max(maxY, std::max(A.y, B.y));
 		}
-		segs.erase(firstSeg);
-		bool foundSomething = true;
-		while (!segs.empty() && foundSomething)
+	}
+	if (segmentCount == 0)
+	{
+		mSlabCount = 0;
+		return;
+	}
+	mSlabCount = (int)std::min(segmentCount, (size_t)65536);
+	mOriginY = minY;
+	mInvSlabHeight = maxY > minY ? mSlabCount / (maxY - minY) : 0;
+
+	// Counts the segments of each slab, then fills them in scan order
+	mSlabStart.assign(mSlabCount + 1, 0);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		if (pass == 1)
 		{
-			foundSomething = false;
-			Vec2MultiMap::iterator next = segs.find(headSecond);
-			if (next != segs.end())
-			{
-				foundSomething = true;
-				headSecond = next->second;
-				s.addPoint(headSecond);
-				std::pair<Vec2MultiMap::iterator, Vec2MultiMap::iterator> correspondants = segs.equal_range(headSecond);
-				for (Vec2MultiMap::iterator it = correspondants.first; it != correspondants.second;)
-				{
-					Vec2MultiMap::iterator removeIt = ++it;
-					if ((removeIt->second - next->first).squaredLength() < 1e-8)
-						segs.erase(removeIt);
-				}
-				segs.erase(next);
-			}
-			Vec2MultiMap::iterator previous = segs.find(headFirst);
-			if (previous != segs.end())
+			for (int s = 0; s < mSlabCount; ++s)
+				mSlabStart[s + 1] += mSlabStart[s];
+			size_t total = mSlabStart[mSlabCount];
+			mAX.resize(total);
+			mAY.resize(total);
+			mBX.resize(total);
+			mBY.resize(total);
+			mShapeIndex.resize(total);
+			mSegmentIndex.resize(total);
+		}
+		std::vector<size_t> fill(mSlabStart.begin(), mSlabStart.end() - 1);
+		for (unsigned int k = 0; k < mMultiShape.getShapeCount(); ++k)
+		{
+			const Shape& shape = mMultiShape.getShape(k);
+			for (size_t i = 0; i < shape.getSegCount(); ++i)
 			{
-				foundSomething = true;
-				s.insertPoint(0, previous->second);
-				headFirst = previous->second;
-				std::pair<Vec2MultiMap::iterator, Vec2MultiMap::iterator> correspondants = segs.equal_range(headFirst);
-				for (Vec2MultiMap::iterator it = correspondants.first; it != correspondants.second;)
+				const Vector2& A = shape.getPoint(i);
+				const Vector2& B = shape.getPoint(i + 1);
+				if (A.y == B.y)
+					continue;
+				int first = _slab(std::min(A.y, B.y));
+				int last = _slab(std::max(A.y, B.y));
+				for (int s = first; s <= last; ++s)
 				{
-					Vec2MultiMap::iterator removeIt = ++it;
-					if ((removeIt->second - previous->first).squaredLength() < 1e-8)
-						segs.erase(removeIt);
+					if (pass == 0)
+					{
+						mSlabStart[s + 1]++;
+						continue;
+					}
+					size_t j = fill[s]++;
+					mAX[j] = A.x;
+					mAY[j] = A.y;
+					mBX[j] = B.x;
+					mBY[j] = B.y;
+					mShapeIndex[j] = k;
+					mSegmentIndex[j] = (unsigned int)i;
 				}
-				segs.erase(previous);
 			}
 		}
-		if (s.getPoint(0).squaredDistance(s.getPoint(s.getSegCount() + 1)) < 1e-6)
+	}
+}
+//-----------------------------------------------------------------------
+bool PreparedMultiShape::isPointInside(const Vector2& point) const
+{
+	if (mSlabCount == 0)
+		return mIsOutsideInside;
+
+	// Same closest crossing search as MultiShape::isPointInside, restricted to the slab of the point
+	int slab = _slab(point.y);
+	size_t end = mSlabStart[slab + 1];
+	size_t closestSegment = end;
+	Real closestSegmentDistance = std::numeric_limits<Real>::max();
+	Real closestSegmentX = 0;
+	for (size_t j = mSlabStart[slab]; j < end; ++j)
+	{
+		Real ay = mAY[j];
+		Real by = mBY[j];
+		if ((ay - point.y)*(by - point.y) <= 0.)
 		{
-			s.getPointsReference().pop_back();
-			s.close();
+			Real x = mAX[j] + (point.y - ay)*(mBX[j] - mAX[j]) / (by - ay);
+			float dist = Math::Abs(point.x - x);
+			if (dist < closestSegmentDistance)
+			{
+				closestSegment = j;
+				closestSegmentDistance = dist;
+				closestSegmentX = x;
+			}
 		}
-		addShape(s);
 	}
+	if (closestSegment != end)
+		return _isPointInsideFromClosestSegment(point, &mMultiShape.getShape(mShapeIndex[closestSegment]), mSegmentIndex[closestSegment], Vector2(closestSegmentX, point.y));
+	return mIsOutsideInside;
+}
+//-----------------------------------------------------------------------
+void PreparedMultiShape::arePointsInside(const std::vector<Vector2>& points, std::vector<bool>& result) const
+{
+	// std::vector<bool> can't be written concurrently, so results are gathered as bytes first
+	std::vector<unsigned char> inside(points.size());
+	int count = (int)points.size();
+#ifdef PROCEDURAL_USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < count; ++i)
+		inside[i] = isPointInside(points[i]) ? 1 : 0;
+	result.assign(inside.begin(), inside.end());
 }
 
 }
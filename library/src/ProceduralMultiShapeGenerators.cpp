@@ -33,6 +33,9 @@ THE SOFTWARE.
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
+#ifdef PROCEDURAL_USE_OPENMP
+#include <omp.h>
+#endif
 #endif // PROCEDURAL_USE_FREETYPE
 
 using namespace Ogre;
@@ -43,138 +46,315 @@ namespace Procedural
 //-----------------------------------------------------------------------
 #ifdef PROCEDURAL_USE_FREETYPE
 
-MultiShape TextShape::realizeShapes()
+namespace
 {
-	MultiShape retVal;
-
-	FT_Library ftlib;
-	FT_Face face;
-	FT_GlyphSlot slot;
+/// Converts the outline of a glyph to a closed shape, in pixels
+void _decomposeGlyphOutline(const FT_Outline& outline, Shape& s)
+{
+	int nContours   = outline.n_contours;
+	int startPos    = 0;
+	char* tags     = outline.tags;
+	FT_Vector* vec = outline.points;
 
-	FT_Error error = FT_Init_FreeType(&ftlib);
-	if (error == 0)
+	for (int k = 0; k < nContours; k++)
 	{
-		error = FT_New_Face(ftlib, getFontFileByName().c_str(), 0, &face);
-		if (error == FT_Err_Unknown_File_Format)
-		{
-			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "FreeType ERROR: FT_Err_Unknown_File_Format", "Procedural::TextShape::realizeShapes()");
-		}
-		else if (error)
-		{
-			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "FreeType ERROR: FT_New_Face - " + Ogre::StringConverter::toString(error), "Procedural::TextShape::realizeShapes()");
-		}
-		else
-		{
-			FT_Set_Pixel_Sizes(face, 0, mFontSize);
+		if (k > 0) startPos = outline.contours[k-1]+1;
+		int endPos = outline.contours[k]+1;
 
-			size_t px = 0;
-			size_t py = 0;
-			slot = face->glyph;
-
-			for (size_t n = 0; n < mText.length(); n++)
+		Ogre::Vector2 lastPoint = Ogre::Vector2::ZERO;
+		for (int j = startPos; j < endPos; j++)
+		{
+			if (FT_CURVE_TAG(tags[j]) == FT_CURVE_TAG_ON)
 			{
-				error = FT_Load_Char(face, mText[n], FT_LOAD_NO_BITMAP);
-				if (error) continue;
-
-				Shape s;
-
-				int nContours   = face->glyph->outline.n_contours;
-				int startPos    = 0;
-				char* tags     = face->glyph->outline.tags;
-				FT_Vector* vec = face->glyph->outline.points;
-
-				for (int k = 0; k < nContours; k++)
+				lastPoint = Ogre::Vector2((Ogre::Real)vec[j].x, (Ogre::Real)vec[j].y);
+				s.addPoint(lastPoint / 64.0f);
+			}
+			else
+			{
+				if (FT_CURVE_TAG(tags[j]) == FT_CURVE_TAG_CUBIC)
 				{
-					if (k > 0) startPos = face->glyph->outline.contours[k-1]+1;
-					int endPos = face->glyph->outline.contours[k]+1;
-
-					Ogre::Vector2 lastPoint = Ogre::Vector2::ZERO;
-					for (int j = startPos; j < endPos; j++)
+					int prevPoint = j - 1;
+					if (j == 0) prevPoint = endPos - 1;
+					int nextIndex = j + 1;
+					if (nextIndex >= endPos) nextIndex = startPos;
+					Ogre::Vector2 nextPoint((Ogre::Real)vec[nextIndex].x, (Ogre::Real)vec[nextIndex].y);
+					if ((FT_CURVE_TAG(tags[prevPoint]) != FT_CURVE_TAG_ON) && (FT_CURVE_TAG(tags[prevPoint]) == FT_CURVE_TAG_CUBIC))
 					{
-						if (FT_CURVE_TAG(tags[j]) == FT_CURVE_TAG_ON)
+						BezierCurve2 bc;
+						bc.addPoint(Ogre::Vector2((Ogre::Real)vec[prevPoint].x, (Ogre::Real)vec[prevPoint].y) / 64.0f);
+						bc.addPoint(Ogre::Vector2((Ogre::Real)vec[j].x, (Ogre::Real)vec[j].y) / 64.0f);
+						bc.addPoint(Ogre::Vector2((Ogre::Real)vec[nextIndex].x, (Ogre::Real)vec[nextIndex].y) / 64.0f);
+						s.appendShape(bc.realizeShape());
+					}
+				}
+				else
+				{
+					Ogre::Vector2 conicPoint((Ogre::Real)vec[j].x, (Ogre::Real)vec[j].y);
+					if (j == startPos)
+					{
+						if ((FT_CURVE_TAG(tags[endPos-1]) != FT_CURVE_TAG_ON) && (FT_CURVE_TAG(tags[endPos-1]) != FT_CURVE_TAG_CUBIC))
 						{
-							lastPoint = Ogre::Vector2((Ogre::Real)vec[j].x, (Ogre::Real)vec[j].y);
-							s.addPoint(lastPoint / 64.0f);
+							Ogre::Vector2 lastConnic((Ogre::Real)vec[endPos - 1].x, (Ogre::Real)vec[endPos - 1].y);
+							lastPoint = (conicPoint + lastConnic) / 2;
 						}
-						else
+					}
+
+					int nextIndex = j + 1;
+					if (nextIndex >= endPos) nextIndex = startPos;
+
+					Ogre::Vector2 nextPoint((Ogre::Real)vec[nextIndex].x, (Ogre::Real)vec[nextIndex].y);
+
+					bool nextIsConnic = (FT_CURVE_TAG(tags[nextIndex]) != FT_CURVE_TAG_ON) && (FT_CURVE_TAG(tags[nextIndex]) != FT_CURVE_TAG_CUBIC);
+					if (nextIsConnic)
+						nextPoint = (conicPoint + nextPoint) / 2;
+
+					size_t pc = s.getPointCount();
+					BezierCurve2 bc;
+					if (pc == 0)
+						bc.addPoint(Ogre::Vector2::ZERO);
+					else
+						bc.addPoint(s.getPoint(pc - 1));
+					bc.addPoint(lastPoint / 64.0f);
+					bc.addPoint(conicPoint / 64.0f);
+					bc.addPoint(nextPoint / 64.0f);
+					if (pc == 0)
+						s.appendShape(bc.realizeShape());
+					else
+					{
+						std::vector<Ogre::Vector2> subShape = bc.realizeShape().getPoints();
+						for (std::vector<Ogre::Vector2>::iterator iter = subShape.begin(); iter != subShape.end(); iter++)
 						{
-							if (FT_CURVE_TAG(tags[j]) == FT_CURVE_TAG_CUBIC)
-							{
-								int prevPoint = j - 1;
-								if (j == 0) prevPoint = endPos - 1;
-								int nextIndex = j + 1;
-								if (nextIndex >= endPos) nextIndex = startPos;
-								Ogre::Vector2 nextPoint((Ogre::Real)vec[nextIndex].x, (Ogre::Real)vec[nextIndex].y);
-								if ((FT_CURVE_TAG(tags[prevPoint]) != FT_CURVE_TAG_ON) && (FT_CURVE_TAG(tags[prevPoint]) == FT_CURVE_TAG_CUBIC))
-								{
-									BezierCurve2 bc;
-									bc.addPoint(Ogre::Vector2((Ogre::Real)vec[prevPoint].x, (Ogre::Real)vec[prevPoint].y) / 64.0f);
-									bc.addPoint(Ogre::Vector2((Ogre::Real)vec[j].x, (Ogre::Real)vec[j].y) / 64.0f);
-									bc.addPoint(Ogre::Vector2((Ogre::Real)vec[nextIndex].x, (Ogre::Real)vec[nextIndex].y) / 64.0f);
-									s.appendShape(bc.realizeShape());
-								}
-							}
-							else
-							{
-								Ogre::Vector2 conicPoint((Ogre::Real)vec[j].x, (Ogre::Real)vec[j].y);
-								if (j == startPos)
-								{
-									if ((FT_CURVE_TAG(tags[endPos-1]) != FT_CURVE_TAG_ON) && (FT_CURVE_TAG(tags[endPos-1]) != FT_CURVE_TAG_CUBIC))
-									{
-										Ogre::Vector2 lastConnic((Ogre::Real)vec[endPos - 1].x, (Ogre::Real)vec[endPos - 1].y);
-										lastPoint = (conicPoint + lastConnic) / 2;
-									}
-								}
-
-								int nextIndex = j + 1;
-								if (nextIndex >= endPos) nextIndex = startPos;
-
-								Ogre::Vector2 nextPoint((Ogre::Real)vec[nextIndex].x, (Ogre::Real)vec[nextIndex].y);
-
-								bool nextIsConnic = (FT_CURVE_TAG(tags[nextIndex]) != FT_CURVE_TAG_ON) && (FT_CURVE_TAG(tags[nextIndex]) != FT_CURVE_TAG_CUBIC);
-								if (nextIsConnic)
-									nextPoint = (conicPoint + nextPoint) / 2;
-
-								size_t pc = s.getPointCount();
-								BezierCurve2 bc;
-								if (pc == 0)
-									bc.addPoint(Ogre::Vector2::ZERO);
-								else
-									bc.addPoint(s.getPoint(pc - 1));
-								bc.addPoint(lastPoint / 64.0f);
-								bc.addPoint(conicPoint / 64.0f);
-								bc.addPoint(nextPoint / 64.0f);
-								if (pc == 0)
-									s.appendShape(bc.realizeShape());
-								else
-								{
-									std::vector<Ogre::Vector2> subShape = bc.realizeShape().getPoints();
-									for (std::vector<Ogre::Vector2>::iterator iter = subShape.begin(); iter != subShape.end(); iter++)
-									{
-										if (iter != subShape.begin()) s.addPoint(*iter);
-									}
-								}
-
-								if (nextIsConnic) lastPoint = nextPoint;
-							}
+							if (iter != subShape.begin()) s.addPoint(*iter);
 						}
 					}
-				}
 
-				s.close();
-				s.translate((Ogre::Real)px, (Ogre::Real)py);
-				retVal.addShape(s);
-
-				px += slot->advance.x >> 6;
-				py += slot->advance.y >> 6;
+					if (nextIsConnic) lastPoint = nextPoint;
+				}
 			}
-			FT_Done_Face(face);
 		}
-		FT_Done_FreeType(ftlib);
+	}
+	s.close();
+}
+}
+//-----------------------------------------------------------------------
+struct GlyphCache::FontLibrary
+{
+	FT_Library mLibrary;
+};
+//-----------------------------------------------------------------------
+struct GlyphCache::FontFace
+{
+	FT_Face mFace;
+	unsigned int mFontSize;
+};
+//-----------------------------------------------------------------------
+struct GlyphCache::OpenMPLock
+{
+#ifdef PROCEDURAL_USE_OPENMP
+	omp_lock_t mLock;
+
+	OpenMPLock() { omp_init_lock(&mLock); }
+	~OpenMPLock() { omp_destroy_lock(&mLock); }
+	void lock() { omp_set_lock(&mLock); }
+	void unlock() { omp_unset_lock(&mLock); }
+#else
+	void lock() {}
+	void unlock() {}
+#endif
+};
+//-----------------------------------------------------------------------
+namespace
+{
+/// Holds a lock until the end of the scope, even when an exception is thrown
+template <class L>
+class _ScopedLock
+{
+	L& mLock;
+	_ScopedLock(const _ScopedLock&);
+	_ScopedLock& operator=(const _ScopedLock&);
+public:
+	explicit _ScopedLock(L& lock) : mLock(lock)
+	{
+		mLock.lock();
+	}
+	~_ScopedLock()
+	{
+		mLock.unlock();
+	}
+};
+}
+//-----------------------------------------------------------------------
+bool GlyphCache::GlyphKey::operator<(const GlyphKey& other) const
+{
+	if (mCodePoint != other.mCodePoint)
+		return mCodePoint < other.mCodePoint;
+	if (mFontSize != other.mFontSize)
+		return mFontSize < other.mFontSize;
+	return mFontFile < other.mFontFile;
+}
+//-----------------------------------------------------------------------
+GlyphCache::GlyphCache() : mLibrary(0), mMemoryUsage(0), mMemoryBudget(8 << 20), mOpenMPLock(new OpenMPLock)
+{
+}
+//-----------------------------------------------------------------------
+GlyphCache::~GlyphCache()
+{
+	clear();
+	delete mOpenMPLock;
+}
+//-----------------------------------------------------------------------
+GlyphCache& GlyphCache::getSingleton()
+{
+	static GlyphCache instance;
+	return instance;
+}
+//-----------------------------------------------------------------------
+GlyphCache::FontFace* GlyphCache::_getFace(const String& fontFile)
+{
+	std::map<String, FontFace*>::iterator it = mFaces.find(fontFile);
+	if (it != mFaces.end())
+		return it->second;
+
+	if (mLibrary == 0)
+	{
+		FT_Library library;
+		if (FT_Init_FreeType(&library) != 0)
+			OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "FreeType ERROR: FT_Init_FreeType", "Procedural::GlyphCache::_getFace(const Ogre::String&)");
+		mLibrary = new FontLibrary;
+		mLibrary->mLibrary = library;
+	}
+
+	FT_Face face;
+	FT_Error error = FT_New_Face(mLibrary->mLibrary, fontFile.c_str(), 0, &face);
+	if (error == FT_Err_Unknown_File_Format)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "FreeType ERROR: FT_Err_Unknown_File_Format", "Procedural::GlyphCache::_getFace(const Ogre::String&)");
+	else if (error)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "FreeType ERROR: FT_New_Face - " + Ogre::StringConverter::toString(error), "Procedural::GlyphCache::_getFace(const Ogre::String&)");
+
+	FontFace* fontFace = new FontFace;
+	fontFace->mFace = face;
+	fontFace->mFontSize = 0;
+	mFaces[fontFile] = fontFace;
+	return fontFace;
+}
+//-----------------------------------------------------------------------
+void GlyphCache::_evict()
+{
+	while (mMemoryUsage > mMemoryBudget && !mRecentGlyphs.empty())
+	{
+		std::map<GlyphKey, GlyphEntry>::iterator it = mGlyphs.find(mRecentGlyphs.back());
+		mMemoryUsage -= it->second.mMemory;
+		mGlyphs.erase(it);
+		mRecentGlyphs.pop_back();
+	}
+}
+//-----------------------------------------------------------------------
+bool GlyphCache::getGlyph(const String& fontFile, unsigned int fontSize, unsigned long codePoint, Glyph& glyph)
+{
+	OGRE_LOCK_MUTEX(mMutex);
+	_ScopedLock<OpenMPLock> openMPLock(*mOpenMPLock);
+
+	GlyphKey key;
+	key.mFontFile = fontFile;
+	key.mFontSize = fontSize;
+	key.mCodePoint = codePoint;
+	std::map<GlyphKey, GlyphEntry>::iterator it = mGlyphs.find(key);
+	if (it != mGlyphs.end())
+	{
+		mRecentGlyphs.splice(mRecentGlyphs.begin(), mRecentGlyphs, it->second.mRecent);
+		if (!it->second.mFound)
+			return false;
+		glyph = it->second.mGlyph;
+		return true;
+	}
+
+	FontFace* fontFace = _getFace(fontFile);
+	FT_Face face = fontFace->mFace;
+	if (fontFace->mFontSize != fontSize)
+	{
+		FT_Set_Pixel_Sizes(face, 0, fontSize);
+		fontFace->mFontSize = fontSize;
+	}
+	GlyphEntry entry;
+	entry.mFound = (FT_Load_Char(face, codePoint, FT_LOAD_NO_BITMAP) == 0);
+	if (entry.mFound)
+	{
+		_decomposeGlyphOutline(face->glyph->outline, entry.mGlyph.mOutline);
+		entry.mGlyph.mAdvanceX = face->glyph->advance.x >> 6;
+		entry.mGlyph.mAdvanceY = face->glyph->advance.y >> 6;
 	}
 	else
 	{
-		OGRE_EXCEPT(Ogre::Exception::ERR_INTERNAL_ERROR, "FreeType ERROR: FT_Init_FreeTyp", "Procedural::TextShape::realizeShapes()");
+		entry.mGlyph.mAdvanceX = 0;
+		entry.mGlyph.mAdvanceY = 0;
+	}
+	entry.mMemory = sizeof(GlyphEntry) + sizeof(GlyphKey) + fontFile.size() + entry.mGlyph.mOutline.getPointCount() * sizeof(Vector2);
+	mRecentGlyphs.push_front(key);
+	entry.mRecent = mRecentGlyphs.begin();
+	mGlyphs[key] = entry;
+	mMemoryUsage += entry.mMemory;
+	_evict();
+	if (!entry.mFound)
+		return false;
+	glyph = entry.mGlyph;
+	return true;
+}
+//-----------------------------------------------------------------------
+void GlyphCache::setMemoryBudget(size_t memoryBudget)
+{
+	OGRE_LOCK_MUTEX(mMutex);
+	_ScopedLock<OpenMPLock> openMPLock(*mOpenMPLock);
+	mMemoryBudget = memoryBudget;
+	_evict();
+}
+//-----------------------------------------------------------------------
+size_t GlyphCache::getMemoryUsage() const
+{
+	OGRE_LOCK_MUTEX(mMutex);
+	_ScopedLock<OpenMPLock> openMPLock(*mOpenMPLock);
+	return mMemoryUsage;
+}
+//-----------------------------------------------------------------------
+void GlyphCache::clear()
+{
+	OGRE_LOCK_MUTEX(mMutex);
+	_ScopedLock<OpenMPLock> openMPLock(*mOpenMPLock);
+	mGlyphs.clear();
+	mRecentGlyphs.clear();
+	mMemoryUsage = 0;
+	for (std::map<String, FontFace*>::iterator it = mFaces.begin(); it != mFaces.end(); ++it)
+	{
+		FT_Done_Face(it->second->mFace);
+		delete it->second;
+	}
+	mFaces.clear();
+	if (mLibrary)
+	{
+		FT_Done_FreeType(mLibrary->mLibrary);
+		delete mLibrary;
+		mLibrary = 0;
+	}
+}
+//-----------------------------------------------------------------------
+MultiShape TextShape::realizeShapes()
+{
+	MultiShape retVal;
+	GlyphCache& cache = GlyphCache::getSingleton();
+	Ogre::String fontFile = getFontFileByName();
+
+	size_t px = 0;
+	size_t py = 0;
+	GlyphCache::Glyph glyph;
+	for (size_t n = 0; n < mText.length(); n++)
+	{
+		if (!cache.getGlyph(fontFile, mFontSize, (unsigned char)mText[n], glyph))
+			continue;
+
+		glyph.mOutline.translate((Ogre::Real)px, (Ogre::Real)py);
+		retVal.addShape(glyph.mOutline);
+
+		px += glyph.mAdvanceX;
+		py += glyph.mAdvanceY;
 	}
 
 	return retVal;
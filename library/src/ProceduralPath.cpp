@@ -29,6 +29,7 @@ THE SOFTWARE.
 #include "ProceduralStableHeaders.h"
 #include "ProceduralPath.h"
 #include "ProceduralGeometryHelpers.h"
+#include "ProceduralPolylineResampler.h"
 #include "OgreRoot.h"
 
 using namespace Ogre;
@@ -50,7 +51,7 @@ Path Path::mergeKeysWithTrack(const Track& track) const
 	{
 		Real nextLineicPos = pathLineicPos + (mPoints[i] - mPoints[i - 1]).length();
 
-		std::map<Real, Real>::const_iterator it = track._getKeyValueAfter(lineicPos, lineicPos / totalLength, i - 1);
+		Track::KeyFrameList::const_iterator it = track._getKeyValueAfter(lineicPos, lineicPos / totalLength, i - 1);
 
 		Real nextTrackPos = it->first;
 		if (track.getAddressingMode() == Track::AM_RELATIVE_LINEIC)
@@ -72,6 +73,44 @@ Path Path::mergeKeysWithTrack(const Track& track) const
 	}
 	return outputPath;
 }
+//-----------------------------------------------------------------------
+Path& Path::simplify(Ogre::Real tolerance, SimplificationMethod method)
+{
+	std::vector<char> keep;
+	PolylineSimplifier::simplify(mPoints, mClosed, tolerance, method, keep);
+	size_t count = 0;
+	for (size_t i = 0; i < mPoints.size(); ++i)
+		if (keep[i])
+			mPoints[count++] = mPoints[i];
+	mPoints.resize(count);
+	mLengths.clear();
+	mFrames.clear();
+	return *this;
+}
+//-----------------------------------------------------------------------
+Path Path::resample(Real step, std::vector<Real>* lineicPositions) const
+{
+	if (step <= 0)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Step must be strictly positive", "Procedural::Path::resample(Ogre::Real, std::vector<Ogre::Real>*)");
+	if (mPoints.size() < 2)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "Cannot resample a path with less than 2 points", "Procedural::Path::resample(Ogre::Real, std::vector<Ogre::Real>*)");
+	Path result;
+	PolylineResampler::resample(mPoints, mClosed, getLineicPositions(), step, result.mPoints, lineicPositions);
+	result.mClosed = mClosed;
+	return result;
+}
+//-----------------------------------------------------------------------
+Path Path::resampleAdaptive(Real maxStep, Radian angleTolerance, std::vector<Real>* lineicPositions) const
+{
+	if (maxStep <= 0 || angleTolerance.valueRadians() <= 0)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Step and angle tolerance must be strictly positive", "Procedural::Path::resampleAdaptive(Ogre::Real, Ogre::Radian, std::vector<Ogre::Real>*)");
+	if (mPoints.size() < 2)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "Cannot resample a path with less than 2 points", "Procedural::Path::resampleAdaptive(Ogre::Real, Ogre::Radian, std::vector<Ogre::Real>*)");
+	Path result;
+	PolylineResampler::resampleAdaptive(mPoints, mClosed, getLineicPositions(), maxStep, angleTolerance, result.mPoints, lineicPositions);
+	result.mClosed = mClosed;
+	return result;
+}
 
 Ogre::MeshPtr Path::realizeMesh(const std::string& name) const
 {
@@ -94,110 +133,144 @@ Ogre::MeshPtr Path::realizeMesh(const std::string& name) const
 	return mesh;
 }
 
-Ogre::Vector3 Path::getPosition(Ogre::Real coord) const
+const std::vector<Ogre::Real>& Path::getLineicPositions() const
 {
+	if (mLengths.empty() && !mPoints.empty())
+	{
+		int segCount = getSegCount();
+		mLengths.resize(segCount + 1);
+		mLengths[0] = 0;
+		for (int i = 0; i < segCount; ++i)
+			mLengths[i + 1] = mLengths[i] + (getPoint(i + 1) - getPoint(i)).length();
+	}
+	return mLengths;
+}
+
+const std::vector<Ogre::Quaternion>& Path::getRotationMinimizingFrames(bool distributeTwist) const
+{
+	if (!mFrames.empty() && mFramesTwistDistributed == distributeTwist)
+		return mFrames;
+	mFrames.clear();
+	mFramesTwistDistributed = distributeTwist;
 	if (mPoints.size() < 2)
-		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "The path must at least contain 2 points", "Procedural::Path::getPosition(Ogre::Real)");
-	unsigned int i = 0;
-	while (true)
 	{
-		Ogre::Real nextLen = (getPoint(i + 1) - getPoint(i)).length();
-		if (coord > nextLen)
-			coord -= nextLen;
-		else
-			return getPosition(i, coord / nextLen);
-		if (!mClosed && i >= mPoints.size() - 2)
-			return mPoints.back();
-		i++;
+		mFrames.resize(mPoints.size(), Quaternion::IDENTITY);
+		return mFrames;
+	}
+
+	size_t frameCount = getSegCount() + 1;
+	std::vector<Vector3> tangents(frameCount);
+	for (size_t i = 0; i < frameCount; ++i)
+	{
+		tangents[i] = getAvgDirection(i);
+		if (tangents[i].isZeroLength())
+			tangents[i] = getDirectionAfter(i);
+		if (tangents[i].isZeroLength())
+			tangents[i] = i > 0 ? tangents[i - 1] : Vector3::UNIT_Z;
 	}
+
+	// Each up vector is reflected twice : by the plane bisecting the segment, then by the plane bisecting the reflected tangent and the next tangent
+	std::vector<Vector3> ups(frameCount);
+	ups[0] = Utils::_computeQuaternion(tangents[0]) * Vector3::UNIT_Y;
+	for (size_t i = 0; i + 1 < frameCount; ++i)
+	{
+		Vector3 up = ups[i];
+		Vector3 tangent = tangents[i];
+		Vector3 v1 = getPoint(i + 1) - getPoint(i);
+		Real c1 = v1.squaredLength();
+		if (c1 > 0)
+		{
+			up -= (2 / c1) * v1.dotProduct(up) * v1;
+			tangent -= (2 / c1) * v1.dotProduct(tangent) * v1;
+		}
+		Vector3 v2 = tangents[i + 1] - tangent;
+		Real c2 = v2.squaredLength();
+		if (c2 > 0)
+			up -= (2 / c2) * v2.dotProduct(up) * v2;
+
+		// Removes the rounding errors
+		up -= tangents[i + 1].dotProduct(up) * tangents[i + 1];
+		if (up.isZeroLength())
+			up = Utils::_computeQuaternion(tangents[i + 1], ups[i]) * Vector3::UNIT_Y;
+		ups[i + 1] = up.normalisedCopy();
+	}
+
+	if (mClosed && distributeTwist)
+	{
+		const Vector3& last = ups[frameCount - 1];
+		Radian twist = Math::ATan2(last.crossProduct(ups[0]).dotProduct(tangents[0]), last.dotProduct(ups[0]));
+		const std::vector<Real>& lengths = getLineicPositions();
+		Real totalLength = lengths.back();
+		if (totalLength > 0)
+			for (size_t i = 1; i < frameCount; ++i)
+				ups[i] = Quaternion(twist * (lengths[i] / totalLength), tangents[i]) * ups[i];
+	}
+
+	mFrames.resize(frameCount);
+	for (size_t i = 0; i < frameCount; ++i)
+		mFrames[i].FromAxes(ups[i].crossProduct(tangents[i]), ups[i], tangents[i]);
+	return mFrames;
 }
 
-Ogre::Real Path::getLengthAtPoint(size_t index) const
+Ogre::Vector3 Path::getPosition(Ogre::Real coord) const
 {
-	Ogre::Real length = 0;
-	for (unsigned int i = 0; i < index; ++i)
-		length += (mPoints[i + 1] - mPoints[i]).length();
-	//if (mClosed)
-	//length += (mPoints.back()-*mPoints.begin()).length();
-	return length;
+	if (mPoints.size() < 2)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "The path must at least contain 2 points", "Procedural::Path::getPosition(Ogre::Real)");
+	Ogre::Real segmentCoord;
+	size_t i = Utils::findLineicSegment(getLineicPositions(), coord, mClosed, segmentCoord);
+	return getPosition(i, segmentCoord);
+}
 
+void Path::getPositions(const std::vector<Ogre::Real>& coords, std::vector<Ogre::Vector3>& positions) const
+{
+	if (mPoints.size() < 2)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "The path must at least contain 2 points", "Procedural::Path::getPositions(const std::vector<Ogre::Real>&, std::vector<Ogre::Vector3>&)");
+	const std::vector<Ogre::Real>& lengths = getLineicPositions();
+	positions.resize(coords.size());
+	for (size_t k = 0; k < coords.size(); ++k)
+	{
+		Ogre::Real segmentCoord;
+		size_t i = Utils::findLineicSegment(lengths, coords[k], mClosed, segmentCoord);
+		const Ogre::Vector3& A = mPoints[i];
+		const Ogre::Vector3& B = getPoint(i + 1);
+		positions[k] = A + segmentCoord * (B - A);
+	}
 }
 
 Ogre::Real Path::getTotalLength() const
 {
-	Ogre::Real length = 0;
-	for (unsigned int i = 0; i < mPoints.size() - 1; ++i)
-		length += (mPoints[i + 1] - mPoints[i]).length();
-	if (mClosed)
-		length += (mPoints.back()-*mPoints.begin()).length();
-	return length;
+	if (mPoints.empty())
+		return 0;
+	return getLineicPositions().back();
 }
 
 void Path::buildFromSegmentSoup(const std::vector<Segment3D>& segList, std::vector<Path>& out)
 {
-	typedef std::multimap<Vector3, Vector3, Vector3Comparator> Vec3MultiMap;
-	Vec3MultiMap segs;
+	// Same tolerance as Vector3Comparator
+	Vector3Welder welder(1e-3f);
+	welder.reserve(segList.size());
+	std::vector<int> segmentEnds;
+	segmentEnds.reserve(2 * segList.size());
 	for (std::vector<Segment3D>::const_iterator it = segList.begin(); it != segList.end(); ++it)
 	{
-		segs.insert(std::pair<Vector3, Vector3 > (it->mA, it->mB));
-		segs.insert(std::pair<Vector3, Vector3 > (it->mB, it->mA));
+		segmentEnds.push_back(welder.weld(it->mA));
+		segmentEnds.push_back(welder.weld(it->mB));
 	}
-	while (!segs.empty())
+	std::vector<std::vector<int> > chains;
+	SegmentChainer::chain(segmentEnds, welder.size(), chains);
+
+	for (std::vector<std::vector<int> >::const_iterator it = chains.begin(); it != chains.end(); ++it)
 	{
-		Ogre::Vector3 headFirst = segs.begin()->first;
-		Ogre::Vector3 headSecond = segs.begin()->second;
-		Path p;
-		p.addPoint(headFirst).addPoint(headSecond);
-		Vec3MultiMap::iterator firstSeg = segs.begin();
-		std::pair<Vec3MultiMap::iterator, Vec3MultiMap::iterator> correspondants2 = segs.equal_range(headSecond);
-		for (Vec3MultiMap::iterator it = correspondants2.first; it != correspondants2.second;)
-		{
-			Vec3MultiMap::iterator removeIt = it++;
-			if ((removeIt->second - firstSeg->first).squaredLength() < 1e-8)
-				segs.erase(removeIt);
-		}
-		segs.erase(firstSeg);
-		bool foundSomething = true;
-		while (!segs.empty() && foundSomething)
-		{
-			foundSomething = false;
-			Vec3MultiMap::iterator next = segs.find(headSecond);
-			if (next != segs.end())
-			{
-				foundSomething = true;
-				headSecond = next->second;
-				p.addPoint(headSecond);
-				std::pair<Vec3MultiMap::iterator, Vec3MultiMap::iterator> correspondants = segs.equal_range(headSecond);
-				for (Vec3MultiMap::iterator it = correspondants.first; it != correspondants.second;)
-				{
-					Vec3MultiMap::iterator removeIt = it++;
-					if ((removeIt->second - next->first).squaredLength() < 1e-8)
-						segs.erase(removeIt);
-				}
-				segs.erase(next);
-			}
-			Vec3MultiMap::iterator previous = segs.find(headFirst);
-			if (previous != segs.end())
-			{
-				foundSomething = true;
-				p.insertPoint(0, previous->second);
-				headFirst = previous->second;
-				std::pair<Vec3MultiMap::iterator, Vec3MultiMap::iterator> correspondants = segs.equal_range(headFirst);
-				for (Vec3MultiMap::iterator it = correspondants.first; it != correspondants.second;)
-				{
-					Vec3MultiMap::iterator removeIt = it++;
-					if ((removeIt->second - previous->first).squaredLength() < 1e-8)
-						segs.erase(removeIt);
-				}
-				segs.erase(previous);
-			}
-		}
-		if (p.getPoint(0).squaredDistance(p.getPoint(p.getSegCount() + 1)) < 1e-6)
-		{
-			p.getPointsReference().pop_back();
+		out.push_back(Path());
+		Path& p = out.back();
+		bool closed = it->front() == it->back();
+		size_t pointCount = closed ? it->size() - 1 : it->size();
+		std::vector<Vector3>& points = p.getPointsReference();
+		points.reserve(pointCount);
+		for (size_t i = 0; i < pointCount; ++i)
+			points.push_back(welder.getPoint((*it)[i]));
+		if (closed)
 			p.close();
-		}
-		out.push_back(p);
 	}
 }
 
@@ -219,29 +292,198 @@ void MultiPath::_calcIntersections()
 {
 	mIntersectionsMap.clear();
 	mIntersections.clear();
-	std::map<Ogre::Vector3, PathIntersection, Vector3Comparator> pointSet;
-	for (std::vector<Path>::iterator it = mPaths.begin(); it!= mPaths.end(); ++it)
+
+	size_t pointCount = 0;
+	for (size_t i = 0; i < mPaths.size(); ++i)
+		pointCount += mPaths[i].getPoints().size();
+
+	// Same tolerance as Vector3Comparator
+	Vector3Welder welder(1e-3f);
+	welder.reserve(pointCount);
+	std::vector<int> ids;
+	std::vector<PathCoordinate> coords;
+	ids.reserve(pointCount);
+	coords.reserve(pointCount);
+	for (size_t i = 0; i < mPaths.size(); ++i)
+	{
+		const std::vector<Vector3>& points = mPaths[i].getPoints();
+		for (size_t j = 0; j < points.size(); ++j)
+		{
+			ids.push_back(welder.weld(points[j]));
+			coords.push_back(PathCoordinate(i, j));
+		}
+	}
+
+	std::vector<int> counts(welder.size(), 0);
+	for (size_t k = 0; k < ids.size(); ++k)
+		counts[ids[k]]++;
+	std::vector<int> intersectionIndex(welder.size(), -1);
+	for (size_t k = 0; k < ids.size(); ++k)
+	{
+		int id = ids[k];
+		if (counts[id] < 2)
+			continue;
+		if (intersectionIndex[id] == -1)
+		{
+			intersectionIndex[id] = mIntersections.size();
+			mIntersections.push_back(PathIntersection());
+			mIntersections.back().reserve(counts[id]);
+		}
+		mIntersections[intersectionIndex[id]].push_back(coords[k]);
+	}
+	for (std::vector<PathIntersection>::iterator it = mIntersections.begin(); it != mIntersections.end(); ++it)
+		for (PathIntersection::iterator it2 = it->begin(); it2 != it->end(); ++it2)
+			mIntersectionsMap[*it2] = *it;
+}
+//-----------------------------------------------------------------------
+namespace
+{
+/// A point to insert in a segment of a path
+struct CrossingPoint
+{
+	unsigned int pathIndex;
+	unsigned int segmentIndex;
+	Real t;
+	Vector3 position;
+
+	CrossingPoint(unsigned int _pathIndex, unsigned int _segmentIndex, Real _t, const Vector3& _position) :
+		pathIndex(_pathIndex), segmentIndex(_segmentIndex), t(_t), position(_position) {}
+
+	bool operator < (const CrossingPoint& other) const
+	{
+		if (pathIndex != other.pathIndex)
+			return pathIndex < other.pathIndex;
+		if (segmentIndex != other.segmentIndex)
+			return segmentIndex < other.segmentIndex;
+		return t < other.t;
+	}
+};
+
+inline Vector2 _toXZ(const Vector3& v)
+{
+	return Vector2(v.x, v.z);
+}
+
+/// Finds where a point lies on a segment in the XZ plane, returns false if it is not within tolerance of the segment
+bool _projectOnSegment(const Vector3& p, const Vector3& a, const Vector3& b, Real tolerance, Real& t)
+{
+	Vector2 ab = _toXZ(b) - _toXZ(a);
+	Vector2 ap = _toXZ(p) - _toXZ(a);
+	Real squaredLength = ab.squaredLength();
+	if (squaredLength == 0)
+		return false;
+	t = ap.dotProduct(ab) / squaredLength;
+	if (t < 0 || t > 1)
+		return false;
+	return (ap - t * ab).squaredLength() < tolerance * tolerance;
+}
+}
+//-----------------------------------------------------------------------
+MultiPath& MultiPath::splitAtCrossings(Real tolerance, Real maxHeightDifference)
+{
+	// Every segment of every path, with a way back to its path
+	std::vector<Segment2D> segments;
+	std::vector<unsigned int> segmentPath;
+	std::vector<unsigned int> segmentIndex;
+	for (size_t i = 0; i < mPaths.size(); ++i)
 	{
-		for (std::vector<Ogre::Vector3>::const_iterator it2 = it->getPoints().begin(); it2 != it->getPoints().end(); ++it2)
+		int segCount = mPaths[i].getSegCount();
+		for (int j = 0; j < segCount; ++j)
 		{
-			PathCoordinate pc(it-mPaths.begin(), it2-it->getPoints().begin());
-			if (pointSet.find(*it2)==pointSet.end())
+			segments.push_back(Segment2D(_toXZ(mPaths[i].getPoint(j)), _toXZ(mPaths[i].getPoint(j + 1))));
+			segmentPath.push_back(i);
+			segmentIndex.push_back(j);
+		}
+	}
+	SegmentGrid2D grid;
+	grid.build(segments);
+
+	Real squaredTolerance = tolerance * tolerance;
+	std::vector<CrossingPoint> crossings;
+	std::vector<size_t> candidates;
+	for (size_t s1 = 0; s1 < segments.size(); ++s1)
+	{
+		const Path& path1 = mPaths[segmentPath[s1]];
+		const Vector3& a1 = path1.getPoint(segmentIndex[s1]);
+		const Vector3& b1 = path1.getPoint(segmentIndex[s1] + 1);
+		Vector2 margin(tolerance, tolerance);
+		candidates.clear();
+		grid.query(Utils::min(segments[s1].mA, segments[s1].mB) - margin, Utils::max(segments[s1].mA, segments[s1].mB) + margin, candidates);
+		for (size_t k = 0; k < candidates.size(); ++k)
+		{
+			size_t s2 = candidates[k];
+			if (s2 <= s1)
+				continue;
+			const Path& path2 = mPaths[segmentPath[s2]];
+			const Vector3& a2 = path2.getPoint(segmentIndex[s2]);
+			const Vector3& b2 = path2.getPoint(segmentIndex[s2] + 1);
+
+			// Proper crossing : both segments get a new point, unless it is close to one of their ends
+			Vector2 intersection;
+			if (segments[s1].findIntersect(segments[s2], intersection))
 			{
-				PathIntersection pi;
-				pi.push_back(pc);
-				pointSet[*it2] = pi;
+				Real t1 = 0, t2 = 0;
+				_projectOnSegment(Vector3(intersection.x, 0, intersection.y), a1, b1, 1, t1);
+				_projectOnSegment(Vector3(intersection.x, 0, intersection.y), a2, b2, 1, t2);
+				Real y1 = a1.y + t1 * (b1.y - a1.y);
+				Real y2 = a2.y + t2 * (b2.y - a2.y);
+				if (Math::Abs(y1 - y2) > maxHeightDifference)
+					continue;
+				Vector3 position(intersection.x, .5f * (y1 + y2), intersection.y);
+				bool nearEnd1 = position.squaredDistance(a1) < squaredTolerance || position.squaredDistance(b1) < squaredTolerance;
+				bool nearEnd2 = position.squaredDistance(a2) < squaredTolerance || position.squaredDistance(b2) < squaredTolerance;
+				if (nearEnd1 && nearEnd2)
+					continue;
+				if (nearEnd1)
+					position = position.squaredDistance(a1) < position.squaredDistance(b1) ? a1 : b1;
+				if (nearEnd2)
+					position = position.squaredDistance(a2) < position.squaredDistance(b2) ? a2 : b2;
+				if (!nearEnd1)
+					crossings.push_back(CrossingPoint(segmentPath[s1], segmentIndex[s1], t1, position));
+				if (!nearEnd2)
+					crossings.push_back(CrossingPoint(segmentPath[s2], segmentIndex[s2], t2, position));
+				continue;
+			}
+
+			// An end of a segment lying on the other segment
+			const Vector3* ends[4] = {&a1, &b1, &a2, &b2};
+			for (int e = 0; e < 4; ++e)
+			{
+				const Vector3& p = *ends[e];
+				const Vector3& a = e < 2 ? a2 : a1;
+				const Vector3& b = e < 2 ? b2 : b1;
+				Real t;
+				if (p.squaredDistance(a) < squaredTolerance || p.squaredDistance(b) < squaredTolerance || !_projectOnSegment(p, a, b, tolerance, t))
+					continue;
+				if (Math::Abs(a.y + t * (b.y - a.y) - p.y) > maxHeightDifference)
+					continue;
+				if (e < 2)
+					crossings.push_back(CrossingPoint(segmentPath[s2], segmentIndex[s2], t, p));
+				else
+					crossings.push_back(CrossingPoint(segmentPath[s1], segmentIndex[s1], t, p));
 			}
-			else
-				pointSet[*it2].push_back(pc);
 		}
 	}
-	for (std::map<Ogre::Vector3, PathIntersection, Vector3Comparator>::iterator it = pointSet.begin(); it != pointSet.end(); ++it)
-		if (it->second.size()>1)
+
+	// Rebuilds the paths having new points
+	std::sort(crossings.begin(), crossings.end());
+	for (size_t c = 0; c < crossings.size();)
+	{
+		unsigned int pathIndex = crossings[c].pathIndex;
+		std::vector<Vector3> oldPoints = mPaths[pathIndex].getPoints();
+		std::vector<Vector3>& points = mPaths[pathIndex].getPointsReference();
+		points.clear();
+		for (size_t j = 0; j < oldPoints.size(); ++j)
 		{
-			for (PathIntersection::iterator it2 = it->second.begin(); it2!=it->second.end(); ++it2)
-				mIntersectionsMap[*it2] = it->second;
-			mIntersections.push_back(it->second);
+			points.push_back(oldPoints[j]);
+			for (; c < crossings.size() && crossings[c].pathIndex == pathIndex && crossings[c].segmentIndex == j; ++c)
+				if (points.back().squaredDistance(crossings[c].position) >= squaredTolerance)
+					points.push_back(crossings[c].position);
 		}
+	}
+
+	_calcIntersections();
+	return *this;
 }
 
 }
@@ -40,6 +40,9 @@ Path CatmullRomSpline3::realizePath()
 	Path path;
 
 	unsigned int numPoints = mClosed?mPoints.size():mPoints.size()-1;
+	SplineBasisTable basis(mNumSeg);
+	if (mTolerance <= 0)
+		path.getPointsReference().reserve(numPoints * mNumSeg + 1);
 	for (unsigned int i=0; i < numPoints; ++i)
 	{
 		const Vector3& P1 = safeGetPoint(i-1);
@@ -47,7 +50,7 @@ Path CatmullRomSpline3::realizePath()
 		const Vector3& P3 = safeGetPoint(i+1);
 		const Vector3& P4 = safeGetPoint(i+2);
 
-		computeCatmullRomPoints(P1, P2, P3, P4, mNumSeg, path.getPointsReference());
+		computeCatmullRomPoints(P1, P2, P3, P4, basis, path.getPointsReference(), mTolerance, mAngleTolerance);
 
 		if (i == mPoints.size() - 2 && !mClosed)
 			path.addPoint(P3);
@@ -67,12 +70,15 @@ Path CubicHermiteSpline3::realizePath()
 		computeTangents<Vector3>(mPoints[i], safeGetPoint(i-1).position, safeGetPoint(i+1).position);
 
 	unsigned int numPoints = mClosed ? mPoints.size() : (mPoints.size() - 1);
+	SplineBasisTable basis(mNumSeg);
+	if (mTolerance <= 0)
+		path.getPointsReference().reserve(numPoints * mNumSeg + 1);
 	for (unsigned int i = 0; i < numPoints; ++i)
 	{
 		const ControlPoint& pointBefore = mPoints[i];
 		const ControlPoint& pointAfter = safeGetPoint(i+1);
 
-		computeCubicHermitePoints(pointBefore, pointAfter, mNumSeg, path.getPointsReference());
+		computeCubicHermitePoints(pointBefore, pointAfter, basis, path.getPointsReference(), mTolerance, mAngleTolerance);
 
 		if (i == mPoints.size() - 2 && !mClosed)
 			path.addPoint(pointAfter.position);
@@ -125,9 +131,10 @@ Path RoundedCornerSpline3::realizePath()
 		Vector3 vAxis;
 		q.ToAngleAxis(angleTotal, vAxis);
 
-		for (unsigned int j=0; j<=mNumSeg; j++)
+		unsigned int numSeg = Utils::computeArcSegmentCount(vradBegin.length(), angleTotal, mNumSeg, mTolerance, mAngleTolerance);
+		for (unsigned int j=0; j<=numSeg; j++)
 		{
-			q.FromAngleAxis(angleTotal * (Real)j / (Real)mNumSeg, vAxis);
+			q.FromAngleAxis(angleTotal * (Real)j / (Real)numSeg, vAxis);
 			path.addPoint(center + q*vradBegin);
 		}
 	}
@@ -147,52 +154,24 @@ Path BezierCurve3::realizePath()
 	if (mPoints.size() < 2)
 		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "The curve must at least contain 2 points", "Procedural::BezierCurve3::realizePath()");
 
-	unsigned int* coef = new unsigned int[mPoints.size()];
-	if (mPoints.size() == 2)
-	{
-		coef[0] = 1;
-		coef[1] = 1;
-	}
-	else if (mPoints.size() == 3)
-	{
-		coef[0] = 1;
-		coef[1] = 2;
-		coef[2] = 1;
-	}
-	else if (mPoints.size() == 4)
-	{
-		coef[0] = 1;
-		coef[1] = 3;
-		coef[2] = 3;
-		coef[3] = 1;
-	}
-	else
+	BezierCurve<Vector3> curve(mPoints);
+	Path path;
+	if (mTolerance > 0)
 	{
-		for (int i = 0; i < (int)mPoints.size(); i++)
-			coef[i] = Utils::binom(mPoints.size() - 1, i);
+		computeCurvePoints(curve, mNumSeg, mTolerance, mAngleTolerance, path.getPointsReference());
+		path.addPoint(mPoints.back());
+		return path;
 	}
 
 	unsigned int div = (mPoints.size() - 1) * mNumSeg + 1;
 	Ogre::Real dt = 1.0f / (Ogre::Real)div;
 
-	Path path;
 	Ogre::Real t = 0.0f;
 	while (t < 1.0f)
 	{
-		Ogre::Real x = 0.0f;
-		Ogre::Real y = 0.0f;
-		Ogre::Real z = 0.0f;
-		for (int i = 0; i < (int)mPoints.size(); i++)
-		{
-			Ogre::Real fac = coef[i] * pow(t, i) * pow(1.0f - t, (int)mPoints.size() - 1 - i);
-			x += fac * mPoints[i].x;
-			y += fac * mPoints[i].y;
-			z += fac * mPoints[i].z;
-		}
-		path.addPoint(x, y, z);
+		path.addPoint(curve(t));
 		t += dt;
 	}
-	delete coef;
 
 	return path;
 }
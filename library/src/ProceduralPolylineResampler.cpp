@@ -0,0 +1,255 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#include "ProceduralStableHeaders.h"
+#include "ProceduralPolylineResampler.h"
+
+using namespace Ogre;
+
+namespace Procedural
+{
+//-----------------------------------------------------------------------
+namespace
+{
+inline Real _turnAngle(const Vector2& d1, const Vector2& d2)
+{
+	return Math::ATan2(Math::Abs(d1.crossProduct(d2)), d1.dotProduct(d2)).valueRadians();
+}
+
+inline Real _turnAngle(const Vector3& d1, const Vector3& d2)
+{
+	return Math::ATan2(d1.crossProduct(d2).length(), d1.dotProduct(d2)).valueRadians();
+}
+
+/// Appends a lineic position, unless it would repeat the previous one
+inline void _pushCoord(std::vector<Real>& coords, Real coord)
+{
+	if (coords.empty() || coord > coords.back())
+		coords.push_back(coord);
+}
+
+/// Walks forward along a polyline, for increasing lineic positions
+template <class T>
+struct PolylineCursor
+{
+	const std::vector<T>& mPoints;
+	const std::vector<Real>& mLengths;
+	size_t mSegment;
+
+	PolylineCursor(const std::vector<T>& points, const std::vector<Real>& lengths) : mPoints(points), mLengths(lengths), mSegment(0) {}
+
+	/// Gets the position at a lineic coordinate, which must not be before the previous one
+	T getPosition(Real coord)
+	{
+		size_t segCount = mLengths.size() - 1;
+		while (mSegment + 1 < segCount && mLengths[mSegment + 1] < coord)
+			++mSegment;
+		Real length = mLengths[mSegment + 1] - mLengths[mSegment];
+		Real t = length > 0 ? std::max((Real)0, std::min((Real)1, (coord - mLengths[mSegment]) / length)) : 0;
+		const T& a = mPoints[mSegment];
+		const T& b = mPoints[(mSegment + 1) % mPoints.size()];
+		return a + (b - a) * t;
+	}
+};
+
+template <class T>
+void _resample(const std::vector<T>& points, bool closed, const std::vector<Real>& lengths, Real step, std::vector<T>& result, std::vector<Real>* resultLengths)
+{
+	Real totalLength = lengths.back();
+	result.clear();
+	if (resultLengths)
+		resultLengths->clear();
+	// All the points coincide : a single point is given, as resampleAdaptive does
+	if (totalLength <= 0)
+	{
+		result.push_back(points[0]);
+		if (resultLengths)
+			resultLengths->push_back(0);
+		return;
+	}
+	size_t count = std::max((size_t)(closed ? 3 : 1), (size_t)Math::Floor(totalLength / step + .5f));
+	size_t last = closed ? count - 1 : count;
+	result.reserve(last + 1);
+	if (resultLengths)
+		resultLengths->reserve(last + 1);
+	PolylineCursor<T> cursor(points, lengths);
+	for (size_t k = 0; k <= last; ++k)
+	{
+		Real coord = (k == count) ? totalLength : totalLength * k / count;
+		result.push_back(cursor.getPosition(coord));
+		if (resultLengths)
+			resultLengths->push_back(coord);
+	}
+}
+
+template <class T>
+void _resampleAdaptive(const std::vector<T>& points, bool closed, const std::vector<Real>& lengths, Real maxStep, Real angleTolerance,
+                       std::vector<T>& result, std::vector<Real>* resultLengths)
+{
+	size_t n = points.size();
+	size_t segCount = lengths.size() - 1;
+	Real totalLength = lengths.back();
+
+	// Direction change at each point, the ends of open polylines having none
+	std::vector<Real> turns(n, 0);
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (!closed && (i == 0 || i == n - 1))
+			continue;
+		const T& previous = points[(i + n - 1) % n];
+		const T& next = points[(i + 1) % n];
+		T d1 = points[i] - previous;
+		T d2 = next - points[i];
+		if (d1.squaredLength() > 0 && d2.squaredLength() > 0)
+			turns[i] = _turnAngle(d1, d2);
+	}
+
+	// Points are walked from start to start + segCount, indices being taken modulo n.
+	// A closed polyline starts at a corner if it has one, so that corners always start a run.
+	size_t start = 0;
+	if (closed)
+		for (size_t i = 0; i < n; ++i)
+			if (turns[i] > angleTolerance)
+			{
+				start = i;
+				break;
+			}
+
+	std::vector<Real> unrolledLengths(segCount + 1);
+	for (size_t v = 0; v <= segCount; ++v)
+	{
+		size_t i = start + v;
+		unrolledLengths[v] = i <= segCount ? lengths[i] : totalLength + lengths[i - segCount];
+	}
+
+	// Each run between corners is divided evenly in cost, the cost growing with the length and with the direction changes
+	result.clear();
+	std::vector<Real> coords;
+	size_t runStart = 0;
+	for (size_t v = 1; v <= segCount; ++v)
+	{
+		if (v < segCount && turns[(start + v) % n] <= angleTolerance)
+			continue;
+
+		Real cost = 0;
+		for (size_t w = runStart; w < v; ++w)
+		{
+			if (w > runStart)
+				cost += turns[(start + w) % n] / angleTolerance;
+			cost += (unrolledLengths[w + 1] - unrolledLengths[w]) / maxStep;
+		}
+		size_t count = std::max((size_t)1, (size_t)Math::Ceil(cost - 1e-4f));
+		Real costBefore = 0;
+		size_t w = runStart;
+		for (size_t j = 0; j < count; ++j)
+		{
+			Real target = cost * j / count;
+			// Moves to the segment w whose cost range, after the turn at its first point, contains the target
+			while (true)
+			{
+				Real turnCost = (w > runStart) ? turns[(start + w) % n] / angleTolerance : 0;
+				Real segmentCost = (unrolledLengths[w + 1] - unrolledLengths[w]) / maxStep;
+				// All targets falling in the turn of a point are snapped to it, which must only be emitted once
+				if (target <= costBefore + turnCost)
+				{
+					_pushCoord(coords, unrolledLengths[w]);
+					break;
+				}
+				if (target <= costBefore + turnCost + segmentCost || w + 1 == v)
+				{
+					Real t = segmentCost > 0 ? std::min((Real)1, (target - costBefore - turnCost) / segmentCost) : 0;
+					_pushCoord(coords, unrolledLengths[w] + t * (unrolledLengths[w + 1] - unrolledLengths[w]));
+					break;
+				}
+				costBefore += turnCost + segmentCost;
+				++w;
+			}
+		}
+		runStart = v;
+	}
+	if (!closed)
+		_pushCoord(coords, totalLength);
+
+	// Closed polylines may have started on a corner : lineic positions are brought back in range, and the output starts from the smallest one
+	size_t first = 0;
+	if (closed)
+		for (size_t k = 0; k < coords.size(); ++k)
+		{
+			if (coords[k] >= totalLength)
+				coords[k] -= totalLength;
+			if (coords[k] < coords[first])
+				first = k;
+		}
+	std::rotate(coords.begin(), coords.begin() + first, coords.end());
+
+	// Distinct lineic positions may still land on the same point, when the source polyline repeats points
+	PolylineCursor<T> cursor(points, lengths);
+	result.reserve(coords.size());
+	size_t kept = 0;
+	for (size_t k = 0; k < coords.size(); ++k)
+	{
+		T position = cursor.getPosition(coords[k]);
+		if (!result.empty() && position == result.back())
+			continue;
+		result.push_back(position);
+		coords[kept++] = coords[k];
+	}
+	if (closed && result.size() > 1 && result.back() == result.front())
+	{
+		result.pop_back();
+		--kept;
+	}
+	coords.resize(kept);
+	if (resultLengths)
+		resultLengths->swap(coords);
+}
+}
+//-----------------------------------------------------------------------
+void PolylineResampler::resample(const std::vector<Vector2>& points, bool closed, const std::vector<Real>& lineicPositions, Real step,
+                                 std::vector<Vector2>& result, std::vector<Real>* resultLineicPositions)
+{
+	_resample(points, closed, lineicPositions, step, result, resultLineicPositions);
+}
+//-----------------------------------------------------------------------
+void PolylineResampler::resample(const std::vector<Vector3>& points, bool closed, const std::vector<Real>& lineicPositions, Real step,
+                                 std::vector<Vector3>& result, std::vector<Real>* resultLineicPositions)
+{
+	_resample(points, closed, lineicPositions, step, result, resultLineicPositions);
+}
+//-----------------------------------------------------------------------
+void PolylineResampler::resampleAdaptive(const std::vector<Vector2>& points, bool closed, const std::vector<Real>& lineicPositions, Real maxStep,
+                                         Radian angleTolerance, std::vector<Vector2>& result, std::vector<Real>* resultLineicPositions)
+{
+	_resampleAdaptive(points, closed, lineicPositions, maxStep, angleTolerance.valueRadians(), result, resultLineicPositions);
+}
+//-----------------------------------------------------------------------
+void PolylineResampler::resampleAdaptive(const std::vector<Vector3>& points, bool closed, const std::vector<Real>& lineicPositions, Real maxStep,
+                                         Radian angleTolerance, std::vector<Vector3>& result, std::vector<Real>* resultLineicPositions)
+{
+	_resampleAdaptive(points, closed, lineicPositions, maxStep, angleTolerance.valueRadians(), result, resultLineicPositions);
+}
+}
@@ -0,0 +1,348 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#include "ProceduralStableHeaders.h"
+#include "ProceduralPolylineSimplifier.h"
+#include "ProceduralGeometryHelpers.h"
+#include "ProceduralUtils.h"
+#include <queue>
+
+using namespace Ogre;
+
+namespace Procedural
+{
+//-----------------------------------------------------------------------
+namespace
+{
+inline Real _triangleArea(const Vector2& a, const Vector2& b, const Vector2& c)
+{
+	return Math::Abs((b - a).crossProduct(c - a)) * .5f;
+}
+
+inline Real _triangleArea(const Vector3& a, const Vector3& b, const Vector3& c)
+{
+	return (b - a).crossProduct(c - a).length() * .5f;
+}
+
+template <class T>
+Real _squaredDistanceToSegment(const T& p, const T& a, const T& b)
+{
+	T ab = b - a;
+	Real length = ab.squaredLength();
+	if (length == 0)
+		return p.squaredDistance(a);
+	Real t = std::max((Real)0, std::min((Real)1, (p - a).dotProduct(ab) / length));
+	return p.squaredDistance(a + ab * t);
+}
+
+/// Gets the point between first and last (excluded, indices taken modulo the point count) which is the farthest from segment [first, last]
+template <class T>
+size_t _findFarthest(const std::vector<T>& points, size_t first, size_t last, Real& squaredDistance)
+{
+	size_t n = points.size();
+	const T& a = points[first % n];
+	const T& b = points[last % n];
+	size_t farthest = first;
+	squaredDistance = -1;
+	for (size_t i = first + 1; i < last; ++i)
+	{
+		Real d = _squaredDistanceToSegment(points[i % n], a, b);
+		if (d > squaredDistance)
+		{
+			squaredDistance = d;
+			farthest = i;
+		}
+	}
+	return farthest;
+}
+
+template <class T>
+void _douglasPeucker(const std::vector<T>& points, bool closed, Real tolerance, std::vector<char>& keep)
+{
+	size_t n = points.size();
+	keep.assign(n, 0);
+	keep[0] = 1;
+
+	// A closed polyline is split at the point farthest from its first point
+	std::vector<std::pair<size_t, size_t> > ranges;
+	if (closed)
+	{
+		size_t opposite = 0;
+		for (size_t i = 1; i < n; ++i)
+			if (points[i].squaredDistance(points[0]) > points[opposite].squaredDistance(points[0]))
+				opposite = i;
+		// All the points coincide : there's nothing to simplify against, so the polyline is left as it is
+		if (opposite == 0)
+		{
+			keep.assign(n, 1);
+			return;
+		}
+		keep[opposite] = 1;
+		ranges.push_back(std::make_pair((size_t)0, opposite));
+		ranges.push_back(std::make_pair(opposite, n));
+	}
+	else
+	{
+		keep[n - 1] = 1;
+		ranges.push_back(std::make_pair((size_t)0, n - 1));
+	}
+
+	Real squaredTolerance = tolerance * tolerance;
+	while (!ranges.empty())
+	{
+		std::pair<size_t, size_t> range = ranges.back();
+		ranges.pop_back();
+		Real squaredDistance;
+		size_t farthest = _findFarthest(points, range.first, range.second, squaredDistance);
+		if (squaredDistance > squaredTolerance)
+		{
+			keep[farthest % n] = 1;
+			ranges.push_back(std::make_pair(range.first, farthest));
+			ranges.push_back(std::make_pair(farthest, range.second));
+		}
+	}
+
+	// A closed polyline flatter than the tolerance still keeps some area
+	if (closed && std::count(keep.begin(), keep.end(), 1) < 3)
+	{
+		size_t opposite = std::find(keep.begin() + 1, keep.end(), 1) - keep.begin();
+		Real squaredDistance;
+		size_t farthest = _findFarthest(points, 0, opposite, squaredDistance);
+		if (farthest == 0)
+			farthest = _findFarthest(points, opposite, n, squaredDistance);
+		keep[farthest % n] = 1;
+	}
+}
+
+template <class T>
+void _visvalingamWhyatt(const std::vector<T>& points, bool closed, Real tolerance, std::vector<char>& keep)
+{
+	size_t n = points.size();
+	keep.assign(n, 1);
+	std::vector<size_t> previous(n), next(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		previous[i] = (i + n - 1) % n;
+		next[i] = (i + 1) % n;
+	}
+
+	// Areas are only ever raised when neighbours are removed, so outdated queue entries are recognised by their value
+	typedef std::pair<Real, size_t> AreaEntry;
+	std::priority_queue<AreaEntry, std::vector<AreaEntry>, std::greater<AreaEntry> > queue;
+	std::vector<Real> areas(n, 0);
+	size_t first = closed ? 0 : 1;
+	size_t last = closed ? n : n - 1;
+	for (size_t i = first; i < last; ++i)
+	{
+		areas[i] = _triangleArea(points[previous[i]], points[i], points[next[i]]);
+		queue.push(AreaEntry(areas[i], i));
+	}
+
+	Real threshold = tolerance * tolerance;
+	size_t remaining = n;
+	size_t minimum = closed ? 3 : 2;
+	while (!queue.empty() && remaining > minimum)
+	{
+		AreaEntry entry = queue.top();
+		queue.pop();
+		size_t i = entry.second;
+		if (!keep[i] || entry.first != areas[i])
+			continue;
+		if (entry.first >= threshold)
+			break;
+		keep[i] = 0;
+		remaining--;
+		next[previous[i]] = next[i];
+		previous[next[i]] = previous[i];
+		size_t neighbours[2] = {previous[i], next[i]};
+		for (int k = 0; k < 2; ++k)
+		{
+			size_t j = neighbours[k];
+			if (!closed && (j == 0 || j == n - 1))
+				continue;
+			areas[j] = std::max(entry.first, _triangleArea(points[previous[j]], points[j], points[next[j]]));
+			queue.push(AreaEntry(areas[j], j));
+		}
+	}
+}
+
+template <class T>
+void _simplify(const std::vector<T>& points, bool closed, Real tolerance, SimplificationMethod method, std::vector<char>& keep)
+{
+	if (points.size() <= (closed ? 3u : 2u) || tolerance <= 0)
+	{
+		keep.assign(points.size(), 1);
+		return;
+	}
+	if (method == SM_VISVALINGAM_WHYATT)
+		_visvalingamWhyatt(points, closed, tolerance, keep);
+	else
+		_douglasPeucker(points, closed, tolerance, keep);
+}
+
+/// Tells whether two segments cross each other at a single point which is not one of their ends
+inline bool _isProperCrossing(const Segment2D& s1, const Segment2D& s2)
+{
+	double o1 = Predicates::orient2D(s1.mA, s1.mB, s2.mA);
+	double o2 = Predicates::orient2D(s1.mA, s1.mB, s2.mB);
+	if (!((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)))
+		return false;
+	double o3 = Predicates::orient2D(s2.mA, s2.mB, s1.mA);
+	double o4 = Predicates::orient2D(s2.mA, s2.mB, s1.mB);
+	return (o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0);
+}
+}
+//-----------------------------------------------------------------------
+void PolylineSimplifier::simplify(const std::vector<Vector2>& points, bool closed, Real tolerance, SimplificationMethod method, std::vector<char>& keep)
+{
+	_simplify(points, closed, tolerance, method, keep);
+
+	std::vector<const std::vector<Vector2>*> polylines(1, &points);
+	std::vector<bool> closedFlags(1, closed);
+	std::vector<std::vector<char> > keeps(1);
+	keeps[0].swap(keep);
+	removeCrossings(polylines, closedFlags, keeps);
+	keep.swap(keeps[0]);
+}
+//-----------------------------------------------------------------------
+void PolylineSimplifier::simplify(const std::vector<Vector3>& points, bool closed, Real tolerance, SimplificationMethod method, std::vector<char>& keep)
+{
+	_simplify(points, closed, tolerance, method, keep);
+}
+//-----------------------------------------------------------------------
+void PolylineSimplifier::removeCrossings(const std::vector<const std::vector<Vector2>*>& polylines, const std::vector<bool>& closed, std::vector<std::vector<char> >& keep)
+{
+	// Each simplified segment remembers the range of original points it replaces, the last index being taken modulo the point count
+	std::vector<Segment2D> segments;
+	std::vector<size_t> segmentPolyline, segmentFirst, segmentLast;
+	std::vector<size_t> kept;
+	Vector2 boxMin(Math::POS_INFINITY, Math::POS_INFINITY), boxMax(-Math::POS_INFINITY, -Math::POS_INFINITY);
+	for (size_t p = 0; p < polylines.size(); ++p)
+	{
+		const std::vector<Vector2>& points = *polylines[p];
+		kept.clear();
+		for (size_t i = 0; i < points.size(); ++i)
+			if (keep[p][i])
+				kept.push_back(i);
+		if (kept.size() < 2)
+			continue;
+		// Points put back later may lie anywhere along the polyline, so the grid covers all of them
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			boxMin = Utils::min(boxMin, points[i]);
+			boxMax = Utils::max(boxMax, points[i]);
+		}
+		if (closed[p])
+			kept.push_back(kept.front() + points.size());
+		for (size_t k = 0; k + 1 < kept.size(); ++k)
+		{
+			segments.push_back(Segment2D(points[kept[k]], points[kept[k + 1] % points.size()]));
+			segmentPolyline.push_back(p);
+			segmentFirst.push_back(kept[k]);
+			segmentLast.push_back(kept[k + 1]);
+		}
+	}
+	if (segments.empty())
+		return;
+
+	// A segment crossing another one is split at its farthest point, and only its two halves are inserted
+	// in the grid and checked again, as pairs of untouched segments can't start crossing.
+	// The grid is only rebuilt once the segments doubled, to keep about one segment per cell.
+	SegmentGrid2D grid;
+	grid.build(segments, boxMin, boxMax);
+	size_t builtCount = segments.size();
+	std::vector<size_t> toCheck(segments.size());
+	for (size_t i = 0; i < segments.size(); ++i)
+		toCheck[i] = i;
+	std::vector<char> checked(segments.size(), 1);
+	std::vector<char> crossed(segments.size(), 0);
+	std::vector<size_t> candidates, crossedSegments;
+	while (!toCheck.empty())
+	{
+		crossedSegments.clear();
+		for (size_t k = 0; k < toCheck.size(); ++k)
+		{
+			size_t i = toCheck[k];
+			candidates.clear();
+			grid.query(segments[i], candidates);
+			for (size_t c = 0; c < candidates.size(); ++c)
+			{
+				size_t j = candidates[c];
+				// Pairs of checked segments are only tested once
+				if (j == i || (checked[j] && j < i) || !_isProperCrossing(segments[i], segments[j]))
+					continue;
+				if (!crossed[i])
+					crossedSegments.push_back(i);
+				if (!crossed[j])
+					crossedSegments.push_back(j);
+				crossed[i] = crossed[j] = 1;
+			}
+		}
+
+		for (size_t k = 0; k < toCheck.size(); ++k)
+			checked[toCheck[k]] = 0;
+		toCheck.clear();
+		for (size_t k = 0; k < crossedSegments.size(); ++k)
+		{
+			size_t i = crossedSegments[k];
+			crossed[i] = 0;
+			if (segmentLast[i] - segmentFirst[i] < 2)
+				continue;
+			size_t p = segmentPolyline[i];
+			const std::vector<Vector2>& points = *polylines[p];
+			Real squaredDistance;
+			size_t farthest = _findFarthest(points, segmentFirst[i], segmentLast[i], squaredDistance);
+			keep[p][farthest % points.size()] = 1;
+
+			size_t half = segments.size();
+			segments.push_back(Segment2D(points[farthest % points.size()], points[segmentLast[i] % points.size()]));
+			segmentPolyline.push_back(p);
+			segmentFirst.push_back(farthest);
+			segmentLast.push_back(segmentLast[i]);
+			crossed.push_back(0);
+			checked.push_back(0);
+			segments[i] = Segment2D(points[segmentFirst[i] % points.size()], points[farthest % points.size()]);
+			segmentLast[i] = farthest;
+
+			if (segments.size() <= 2 * builtCount)
+			{
+				grid.insert(segments[i], i);
+				grid.insert(segments[half], half);
+			}
+			toCheck.push_back(i);
+			toCheck.push_back(half);
+		}
+		for (size_t k = 0; k < toCheck.size(); ++k)
+			checked[toCheck[k]] = 1;
+		if (segments.size() > 2 * builtCount)
+		{
+			grid.build(segments, boxMin, boxMax);
+			builtCount = segments.size();
+		}
+	}
+}
+}
@@ -146,6 +146,14 @@ void RoundedBoxGenerator::_addEdge(TriangleBuffer& buffer, short xPos, short yPo
 
 void RoundedBoxGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 {
+	if (mChordError > 0 && mChamferSize > 0)
+	{
+		RoundedBoxGenerator box(*this);
+		box.mChordError = 0;
+		box.mChamferNumSeg = (unsigned short)std::min(_getArcSegmentCount(mChamferSize, Radian(Math::HALF_PI), 1), (unsigned int)std::numeric_limits<unsigned short>::max());
+		box.addToTriangleBuffer(buffer);
+		return;
+	}
 	//int offset = 0;
 	// Generate the pseudo-box shape
 	PlaneGenerator pg;
@@ -37,48 +37,195 @@ using namespace Ogre;
 
 namespace Procedural
 {
-void SvgLoader::parseSvgFile(MultiShape& out, const String& fileName, const String& groupName, int segmentsNumber)
+namespace
 {
+inline bool _isSvgCommand(char c)
+{
+	return c != 0 && strchr("mMlLhHvVcCsSqQtTaAzZ", c) != NULL;
+}
+
+inline bool _isSvgNumberStart(char c)
+{
+	return ('0' <= c && c <= '9') || c == '.' || c == '-' || c == '+';
+}
+
+/// Skips everything that is neither a command nor a number, returns false at the end of the data
+inline bool _skipSvgSeparators(const char*& cursor, const char* end)
+{
+	while (cursor < end && !_isSvgCommand(*cursor) && !_isSvgNumberStart(*cursor))
+		++cursor;
+	return cursor < end;
+}
+
+/// Skips whitespace and commas, returns false at the end of the data
+inline bool _skipSvgListSeparators(const char*& cursor, const char* end)
+{
+	while (cursor < end && (isspace((unsigned char)*cursor) || *cursor == ','))
+		++cursor;
+	return cursor < end;
+}
+
+/// Parses a number in place, as defined by the SVG grammar : "10-5" and ".5.5" are both two numbers
+bool _parseSvgNumber(const char*& cursor, const char* end, Real& value)
+{
+	const char* p = cursor;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+	double mantissa = 0.;
+	int exponent = 0;
+	bool hasDigits = false;
+	for (; p < end && '0' <= *p && *p <= '9'; ++p, hasDigits = true)
+		mantissa = mantissa * 10. + (*p - '0');
+	if (p < end && *p == '.')
+		for (++p; p < end && '0' <= *p && *p <= '9'; ++p, hasDigits = true, --exponent)
+			mantissa = mantissa * 10. + (*p - '0');
+	if (!hasDigits)
+		return false;
+	// The exponent only belongs to the number if it has digits, otherwise "e" is left to be skipped
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+		bool negativeExponent = false;
+		if (q < end && (*q == '-' || *q == '+'))
+		{
+			negativeExponent = (*q == '-');
+			++q;
+		}
+		if (q < end && '0' <= *q && *q <= '9')
+		{
+			int e = 0;
+			for (; q < end && '0' <= *q && *q <= '9'; ++q)
+				e = std::min(e * 10 + (*q - '0'), 1000);
+			exponent += negativeExponent ? -e : e;
+			p = q;
+		}
+	}
+	if (exponent < 0)
+		mantissa /= pow(10., -exponent);
+	else if (exponent > 0)
+		mantissa *= pow(10., exponent);
+	value = (Real)(negative ? -mantissa : mantissa);
+	cursor = p;
+	return true;
+}
+}
+//-----------------------------------------------------------------------
+void SvgLoader::parseSvgFile(MultiShape& out, const String& fileName, const String& groupName, int segmentsNumber, Real tolerance)
+{
+	if (tolerance < 0)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Tolerance must not be negative", "Procedural::SvgLoader::parseSvgFile(Procedural::MultiShape&, const Ogre::String&, const Ogre::String&, int, Ogre::Real)");
 	mNumSeg = segmentsNumber;
+	mTolerance = tolerance;
 
 	rapidxml::xml_document<> XMLDoc;    // character type defaults to char
 	DataStreamPtr stream = ResourceGroupManager::getSingleton().openResource(fileName, groupName);
-	char* svg = strdup(stream->getAsString().c_str());
-	XMLDoc.parse<0>(svg);
+	// rapidxml parses in place, and the document points into that buffer until it goes out of scope
+	String content = stream->getAsString();
+	std::vector<char> svg(content.c_str(), content.c_str() + content.size() + 1);
+	XMLDoc.parse<0>(&svg[0]);
 
 	rapidxml::xml_node<>* pXmlRoot = XMLDoc.first_node("svg");
 	if (pXmlRoot == NULL) return;
+	std::vector<SvgElement> elements;
 	rapidxml::xml_node<>* pXmlChildNode = pXmlRoot->first_node();
 	while ( pXmlChildNode != NULL )
 	{
-		parseChildNode(out, pXmlChildNode);
+		gatherElements(elements, pXmlChildNode, SvgTransform());
 		pXmlChildNode = pXmlChildNode->next_sibling();
 	}
+
+	// Elements don't depend on each other : each one is flattened into its own multishape
+	int elementCount = (int)elements.size();
+	std::vector<MultiShape> elementShapes(elementCount);
+#ifdef PROCEDURAL_USE_OPENMP
+	// Exceptions can't cross the parallel region : failed elements are re-run serially, so that they throw from there
+	std::vector<char> failed(elementCount, 0);
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < elementCount; i++)
+	{
+		try
+		{
+			parseElement(elementShapes[i], elements[i]);
+		}
+		catch (...)
+		{
+			failed[i] = 1;
+		}
+	}
+	for (int i = 0; i < elementCount; i++)
+		if (failed[i])
+		{
+			elementShapes[i] = MultiShape();
+			parseElement(elementShapes[i], elements[i]);
+		}
+#else
+	for (int i = 0; i < elementCount; i++)
+		parseElement(elementShapes[i], elements[i]);
+#endif
+
+	for (int i = 0; i < elementCount; i++)
+		out.addMultiShape(elementShapes[i]);
 }
 
 //-----------------------------------------------------------------------
-void SvgLoader::parseChildNode(MultiShape& out, rapidxml::xml_node<>* pChild)
+void SvgLoader::gatherElements(std::vector<SvgElement>& elements, rapidxml::xml_node<>* pNode, const SvgTransform& groupTransform)
 {
+	if (pNode->type() != rapidxml::node_element)
+		return;
+	SvgElement element;
+	element.mNode = pNode;
+	// The node's own transform applies first, and also moves all its children
+	element.mTransform = groupTransform * getAttribTransform(pNode);
+	elements.push_back(element);
+
+	rapidxml::xml_node<>* pSubChildNode = pNode->first_node();
+	while ( pSubChildNode != NULL )
+	{
+		gatherElements(elements, pSubChildNode, element.mTransform);
+		pSubChildNode = pSubChildNode->next_sibling();
+	}
+}
+
+//-----------------------------------------------------------------------
+void SvgLoader::parseElement(MultiShape& out, const SvgElement& element)
+{
+	rapidxml::xml_node<>* pChild = element.mNode;
+	const SvgTransform& transform = element.mTransform;
+	// Curves are flattened before the transform, which stretches their deviation by at most its largest scale
+	Real tolerance = mTolerance;
+	Real maxScale = transform.getMaxScale();
+	if (maxScale > 0)
+		tolerance /= maxScale;
 	std::string name = pChild->name();
 	if (name.size() > 3)
 	{
 		if (stricmp(name.c_str(), "rect") == 0)
 			parseRect(out, pChild);
 		else if (stricmp(name.c_str(), "circle") == 0)
-			parseCircle(out, pChild);
+			parseCircle(out, pChild, tolerance);
 		else if (stricmp(name.c_str(), "ellipse") == 0)
-			parseEllipse(out, pChild);
+			parseEllipse(out, pChild, tolerance);
 		else if (stricmp(name.c_str(), "polygon") == 0 || stricmp(name.c_str(), "polyline") == 0)
 			parsePolygon(out, pChild);
 		else if (stricmp(name.c_str(), "path") == 0)
-			parsePath(out, pChild); // svg path is a shape
+			parsePath(out, pChild, tolerance); // svg path is a shape
 	}
 
-	rapidxml::xml_node<>* pSubChildNode = pChild->first_node();
-	while ( pSubChildNode != NULL )
+	if (transform.isIdentity())
+		return;
+	for (unsigned int i = 0; i < out.getShapeCount(); i++)
 	{
-		parseChildNode(out, pSubChildNode);
-		pSubChildNode = pSubChildNode->next_sibling();
+		Shape& shape = out.getShape(i);
+		std::vector<Vector2>& points = shape.getPointsReference();
+		for (size_t j = 0; j < points.size(); j++)
+			points[j] = transform.apply(points[j]);
+		// A mirroring transform reverses the winding of the shape
+		if (transform.a * transform.d - transform.b * transform.c < 0)
+			shape.switchSide();
 	}
 }
 
@@ -96,44 +243,42 @@ void SvgLoader::parseRect(MultiShape& out, rapidxml::xml_node<>* pRectNode)
 	position.y = getAttribReal(pRectNode, "y");
 	// Our rectangle are centered, but svg rectangles are defined by their corners
 	position += .5f*Vector2(width,height);
-	Vector2 trans = getAttribTranslate(pRectNode);
-	position += trans;
 	s.translate(position);
 
 	out.addShape(s);
 }
 
 //-----------------------------------------------------------------------
-void SvgLoader::parseCircle(MultiShape& out, rapidxml::xml_node<>* pCircleNode)
+void SvgLoader::parseCircle(MultiShape& out, rapidxml::xml_node<>* pCircleNode, Real tolerance)
 {
 	Real r = getAttribReal(pCircleNode, "r");
 	if (r <= 0.0f) return;
-	Shape s = CircleShape().setNumSeg(mNumSeg).setRadius(r).realizeShape();
+	// A coarse tolerance must still leave a closed shape with an area
+	unsigned int numSeg = std::max(3u, Utils::computeArcSegmentCount(r, Radian(Math::TWO_PI), mNumSeg, tolerance, Radian(Math::PI)));
+	Shape s = CircleShape().setNumSeg(numSeg).setRadius(r).realizeShape();
 //	if(pCircleNode->first_attribute("id"))
 	//	ss.id = pCircleNode->first_attribute("id")->value();
 	Vector2 position;
 	position.x = getAttribReal(pCircleNode, "cx");
 	position.y = getAttribReal(pCircleNode, "cy");
-	Vector2 trans = getAttribTranslate(pCircleNode);
-	position += trans;
 	s.translate(position);
 	out.addShape(s);
 }
 
 //-----------------------------------------------------------------------
-void SvgLoader::parseEllipse(MultiShape& out, rapidxml::xml_node<>* pEllipseNode)
+void SvgLoader::parseEllipse(MultiShape& out, rapidxml::xml_node<>* pEllipseNode, Real tolerance)
 {
 	Real rx = getAttribReal(pEllipseNode, "rx");
 	Real ry = getAttribReal(pEllipseNode, "ry");
 	if (rx <= 0.0f || ry <= 0.0f) return;
-	Shape s = EllipseShape().setNumSeg(mNumSeg).setRadiusX(rx).setRadiusY(ry).realizeShape();
+	// An ellipse is a circle squashed along one axis, which can only bring it closer to its chords
+	unsigned int numSeg = std::max(3u, Utils::computeArcSegmentCount(std::max(rx, ry), Radian(Math::TWO_PI), mNumSeg, tolerance, Radian(Math::PI)));
+	Shape s = EllipseShape().setNumSeg(numSeg).setRadiusX(rx).setRadiusY(ry).realizeShape();
 //	if(pEllipseNode->first_attribute("id"))
 	//	ss.id = pEllipseNode->first_attribute("id")->value();
 	Vector2 position;
 	position.x = getAttribReal(pEllipseNode, "cx");
 	position.y = getAttribReal(pEllipseNode, "cy");
-	Vector2 trans = getAttribTranslate(pEllipseNode);
-	position += trans;
 	s.translate(position);
 	out.addShape(s);
 }
@@ -141,38 +286,31 @@ void SvgLoader::parseEllipse(MultiShape& out, rapidxml::xml_node<>* pEllipseNode
 //-----------------------------------------------------------------------
 void SvgLoader::parsePolygon(MultiShape& out, rapidxml::xml_node<>* pPolygonNode)
 {
-	if (pPolygonNode->first_attribute("points"))
+	rapidxml::xml_attribute<>* pPoints = pPolygonNode->first_attribute("points");
+	if (pPoints)
 	{
-		if (pPolygonNode->first_attribute("points")->value_size() < 3) return;
-		std::string temp = xtrim(pPolygonNode->first_attribute("points")->value());
-		std::vector<std::string> pts = split(temp, std::string(" "));
-		if (pts.size() == 0) return;
+		if (pPoints->value_size() < 3) return;
+		const char* cursor = pPoints->value();
+		const char* end = cursor + pPoints->value_size();
 		Shape s;
-		for (size_t i = 0; i < pts.size() - 1; i+=2)
-			s.addPoint(StringConverter::parseReal(pts[i + 0]), StringConverter::parseReal(pts[i + 1]));
+		Real x, y;
+		while (_skipSvgSeparators(cursor, end) && _parseSvgNumber(cursor, end, x)
+		        && _skipSvgSeparators(cursor, end) && _parseSvgNumber(cursor, end, y))
+			s.addPoint(x, y);
 		if (s.getPoints().size() == 0) return;
 		s.close();
 //		if(pPolygonNode->first_attribute("id"))
 		//		ss.id = pPolygonNode->first_attribute("id")->value();
-		s.translate(getAttribTranslate(pPolygonNode));
 		out.addShape(s);
 	}
 }
 //-----------------------------------------------------------------------
-void SvgLoader::parsePath(MultiShape& out, rapidxml::xml_node<>* pPathNode)
+void SvgLoader::parsePath(MultiShape& out, rapidxml::xml_node<>* pPathNode, Real tolerance)
 {
-	if (pPathNode->first_attribute("d"))
+	rapidxml::xml_attribute<>* pData = pPathNode->first_attribute("d");
+	if (pData)
 	{
-		std::string temp = xtrim(pPathNode->first_attribute("d")->value()," .-0123456789mMlLhHvVcCsSqQtTaAzZ");
-		std::vector<std::string> parts = split(temp, std::string(" "));
-		for (size_t i = 0; i < parts.size(); i++)
-			if (parts[i].size() > 1 && !(parts[i][0] == '-' || ('0' <= parts[i][0] && parts[i][0] <= '9')))
-			{
-				parts.insert(parts.begin() + i + 1, parts[i].c_str() + 1);
-				parts[i].erase(1, parts[i].size());
-			}
-
-		SvgLoaderPath sp(parts, mNumSeg);
+		SvgLoaderPath sp(pData->value(), pData->value_size(), mNumSeg, tolerance);
 		if (!sp.isValid()) return;
 		Shape ss = sp.getSvgShape();
 		Vector2 line = ss.getPoint(1) - ss.getPoint(0);
@@ -184,7 +322,6 @@ void SvgLoader::parsePath(MultiShape& out, rapidxml::xml_node<>* pPathNode)
 
 		//if(pPathNode->first_attribute("id"))
 		//	ss.id = pPathNode->first_attribute("id")->value();
-		ss.translate(getAttribTranslate(pPathNode));
 		out.addShape(ss);
 	}
 }
@@ -206,7 +343,7 @@ Real SvgLoader::getAttribReal(rapidxml::xml_node<>* pNode, const String& attrib,
 			}
 		// convert
 		Real retVal = StringConverter::parseReal(tmp);
-		delete tmp;
+		delete[] tmp;
 		return retVal;
 	}
 	else
@@ -214,27 +351,67 @@ Real SvgLoader::getAttribReal(rapidxml::xml_node<>* pNode, const String& attrib,
 }
 
 //-----------------------------------------------------------------------
-Vector2 SvgLoader::getAttribTranslate(rapidxml::xml_node<>* pNode)
+SvgLoader::SvgTransform SvgLoader::getAttribTransform(rapidxml::xml_node<>* pNode)
 {
-	if (pNode->first_attribute("transform"))
+	SvgTransform transform;
+	rapidxml::xml_attribute<>* pTransform = pNode->first_attribute("transform");
+	if (!pTransform)
+		return transform;
+	// A transform list is applied from right to left : each new transform is composed after the previous ones
+	const char* cursor = pTransform->value();
+	const char* end = cursor + pTransform->value_size();
+	while (_skipSvgListSeparators(cursor, end))
 	{
-		std::string temp(pNode->first_attribute("transform")->value());
-		int begin = temp.find("translate(");
-		if (begin==std::string::npos)
-			return Vector2::ZERO;
-		begin+=10;
-		int end = temp.find(")", begin);
-		if (end == std::string::npos)
-			return Vector2::ZERO;
-		std::string temp2 = temp.substr(begin, end-begin);
-		std::vector<std::string> parts = split(xtrim(temp2.c_str()), std::string(" "));
-		if (parts.size() == 2)
-			return Vector2(StringConverter::parseReal(parts[0]), StringConverter::parseReal(parts[1]));
+		const char* nameStart = cursor;
+		while (cursor < end && isalpha((unsigned char)*cursor))
+			++cursor;
+		std::string name(nameStart, cursor);
+		while (cursor < end && *cursor != '(')
+			++cursor;
+		if (cursor == end)
+			break;
+		++cursor;
+		Real args[6];
+		size_t argCount = 0;
+		while (_skipSvgListSeparators(cursor, end) && *cursor != ')')
+		{
+			Real value;
+			if (!_parseSvgNumber(cursor, end, value))
+			{
+				++cursor;
+				continue;
+			}
+			if (argCount < 6)
+				args[argCount] = value;
+			++argCount;
+		}
+		if (cursor < end)
+			++cursor;
+
+		if (name == "matrix" && argCount == 6)
+			transform = transform * SvgTransform(args[0], args[1], args[2], args[3], args[4], args[5]);
+		else if (name == "translate" && (argCount == 1 || argCount == 2))
+			transform = transform * SvgTransform(1, 0, 0, 1, args[0], argCount == 2 ? args[1] : 0);
+		else if (name == "scale" && (argCount == 1 || argCount == 2))
+			transform = transform * SvgTransform(args[0], 0, 0, argCount == 2 ? args[1] : args[0], 0, 0);
+		else if (name == "rotate" && (argCount == 1 || argCount == 3))
+		{
+			Radian angle = Degree(args[0]);
+			Real cosA = Math::Cos(angle);
+			Real sinA = Math::Sin(angle);
+			SvgTransform rotation(cosA, sinA, -sinA, cosA, 0, 0);
+			if (argCount == 3)
+				rotation = SvgTransform(1, 0, 0, 1, args[1], args[2]) * rotation * SvgTransform(1, 0, 0, 1, -args[1], -args[2]);
+			transform = transform * rotation;
+		}
+		else if (name == "skewX" && argCount == 1)
+			transform = transform * SvgTransform(1, 0, Math::Tan(Degree(args[0]).valueRadians()), 1, 0, 0);
+		else if (name == "skewY" && argCount == 1)
+			transform = transform * SvgTransform(1, Math::Tan(Degree(args[0]).valueRadians()), 0, 1, 0, 0);
 		else
-			return Vector2::ZERO;
+			Utils::log("SvgLoader : ignoring unsupported transform " + name + " in " + pTransform->value());
 	}
-	else
-		return Vector2::ZERO;
+	return transform;
 }
 
 //-----------------------------------------------------------------------
@@ -299,23 +476,24 @@ std::string SvgLoader::xtrim(const char* val, const char* achar, char rchar)
 		if (!valid) tmp[i] = rchar;
 	}
 	std::string temp(tmp);
-	delete tmp;
+	delete[] tmp;
 	return temp;
 }
 
 //-----------------------------------------------------------------------
-SvgLoader::SvgLoaderPath::SvgLoaderPath(std::vector<std::string> p, unsigned int ns)
-	: parts(p), mNumSeg(ns), px(0.0f), py(0.0f), index(0)
+SvgLoader::SvgLoaderPath::SvgLoaderPath(const char* data, size_t size, unsigned int ns, Real tolerance)
+	: mCursor(data), mEnd(data + size), point(Vector2::ZERO), mNumSeg(ns), mTolerance(tolerance), px(0.0f), py(0.0f)
 {
 	char lastCmd = 0;
 
-	while (index < p.size())
+	while (_skipSvgSeparators(mCursor, mEnd))
 	{
+		const char* tokenBegin = mCursor;
 		try
 		{
-			char newCmd = parts[index][0];
+			char newCmd = *mCursor;
 			bool next = true;
-			if (lastCmd != newCmd && newCmd != '.' && newCmd != '-' && (newCmd < '0' || newCmd > '9') && curve.size() > 3
+			if (lastCmd != newCmd && !_isSvgNumberStart(newCmd) && curve.size() > 3
 			        && ((lastCmd =='c' || lastCmd == 'C') && (newCmd =='s' || newCmd == 'S') || (lastCmd =='q' || lastCmd == 'Q') && (newCmd =='t' || newCmd == 'T')))
 			{
 				// finish curve
@@ -386,7 +564,7 @@ SvgLoader::SvgLoaderPath::SvgLoaderPath(std::vector<std::string> p, unsigned int
 			case 'z':
 			case 'Z':
 				shape.close();
-				index++;
+				mCursor++;
 				break;
 			default:
 				newCmd = lastCmd;
@@ -458,14 +636,34 @@ SvgLoader::SvgLoaderPath::SvgLoaderPath(std::vector<std::string> p, unsigned int
 		catch (...)
 		{
 		}
+		// Numbers following a command that takes none are ignored
+		if (mCursor == tokenBegin)
+			mCursor++;
 	}
 	if (curve.size() > 0) finishCurve(lastCmd);
 }
+//-----------------------------------------------------------------------
+bool SvgLoader::SvgLoaderPath::parseReal(Real* var)
+{
+	if (var == NULL) return false;
+	if (!_skipSvgSeparators(mCursor, mEnd)) return false;
+	return _parseSvgNumber(mCursor, mEnd, *var);
+}
+//-----------------------------------------------------------------------
+bool SvgLoader::SvgLoaderPath::parseFlag(bool* var)
+{
+	if (var == NULL) return false;
+	if (!_skipSvgSeparators(mCursor, mEnd)) return false;
+	if (*mCursor != '0' && *mCursor != '1') return false;
+	*var = (*mCursor == '1');
+	mCursor++;
+	return true;
+}
 
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseArcTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Real rx = 0.0f;
 	if (!parseReal(&rx))
 		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseCurveSTo");
@@ -475,12 +673,12 @@ void SvgLoader::SvgLoaderPath::parseArcTo(bool rel, bool next)
 	Real x_axis_rotation = 0.0f;
 	if (!parseReal(&x_axis_rotation))
 		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseCurveSTo");
-	Real large_arc_flag = 0.0f;
-	if (!parseReal(&large_arc_flag))
-		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseCurveSTo");
-	Real sweep_flag = 0.0f;
-	if (!parseReal(&sweep_flag))
-		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseCurveSTo");
+	bool largeArc = false;
+	if (!parseFlag(&largeArc))
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a flag", "parseArcTo");
+	bool clockwise = false;
+	if (!parseFlag(&clockwise))
+		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a flag", "parseArcTo");
 	Real x = 0.0f;
 	if (!parseReal(&x))
 		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseCurveSTo");
@@ -491,8 +689,6 @@ void SvgLoader::SvgLoaderPath::parseArcTo(bool rel, bool next)
 	Real RadiansPerDegree = Math::PI / 180.0f;
 	Real epx = rel ? point.x + x : x;
 	Real epy = rel ? point.y + y : y;
-	bool largeArc = (large_arc_flag > 0);
-	bool clockwise = (sweep_flag > 0);
 
 	if (epx == point.x && epy == point.y)
 		return;
@@ -547,8 +743,7 @@ void SvgLoader::SvgLoaderPath::parseArcTo(bool rel, bool next)
 	Real startX = point.x;
 	Real startY = point.y;
 
-	BezierCurve2 bezier;
-	bezier.addPoint(startX, startY);
+	// Each part of at most a quarter turn is approximated by its own cubic curve
 	for (int i = 0; i < segments; ++i)
 	{
 		Real cosTheta1 = cos(theta1);
@@ -566,27 +761,25 @@ void SvgLoader::SvgLoaderPath::parseArcTo(bool rel, bool next)
 		Real dxe = t * (cosPhi * rx * sinTheta2 + sinPhi * ry * cosTheta2);
 		Real dye = t * (sinPhi * rx * sinTheta2 - cosPhi * ry * cosTheta2);
 
+		BezierCurve2 bezier;
+		bezier.setNumSeg(mNumSeg);
+		if (mTolerance > 0)
+			bezier.setTolerance(mTolerance).setAngleTolerance(Radian(Math::PI));
+		bezier.addPoint(startX, startY);
 		bezier.addPoint(startX + dx1, startY + dy1);
 		bezier.addPoint(endpointX + dxe, endpointY + dye);
+		// The last part ends exactly on the end point
+		if (i + 1 < segments)
+			bezier.addPoint(endpointX, endpointY);
+		else
+			bezier.addPoint(epx, epy);
+		appendPoints(bezier.realizeShape());
 
 		theta1 = theta2;
 		startX = endpointX;
 		startY = endpointY;
 	}
 	point = Vector2(epx, epy);
-	bezier.addPoint(point);
-	bezier.setNumSeg(mNumSeg);
-	std::vector<Vector2> pointList = bezier.realizeShape().getPoints();
-	Vector2 lp = shape.getPoint(shape.getPoints().size() - 1);
-	for (std::vector<Vector2>::iterator iter = pointList.begin(); iter != pointList.end(); iter++)
-	{
-		if (iter == pointList.begin())
-		{
-			if (*iter != lp) shape.addPoint(*iter);
-		}
-		else
-			shape.addPoint(*iter);
-	}
 }
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::finishCurve(char lc)
@@ -604,28 +797,32 @@ void SvgLoader::SvgLoaderPath::finishCurve(char lc)
 		if (i + 3 >= curve.size()) break;
 		BezierCurve2 bc2;
 		bc2.setNumSeg(mNumSeg);
+		// Only the deviation matters : small curves get few points whatever they turn by
+		if (mTolerance > 0)
+			bc2.setTolerance(mTolerance).setAngleTolerance(Radian(Math::PI));
 		bc2.addPoint(curve[i + 0]);
 		bc2.addPoint(curve[i + 1]);
 		bc2.addPoint(curve[i + 2]);
 		bc2.addPoint(curve[i + 3]);
-		Shape bc2shape = bc2.realizeShape();
-		Vector2 lp = shape.getPoint(shape.getPoints().size() - 1);
-		for (std::vector<Vector2>::iterator iter = bc2shape.getPoints().begin(); iter != bc2shape.getPoints().end(); iter++)
-		{
-			if (iter == bc2shape.getPoints().begin())
-			{
-				if (*iter != lp) shape.addPoint(*iter);
-			}
-			else
-				shape.addPoint(*iter);
-		}
+		appendPoints(bc2.realizeShape());
 	}
 	curve.clear();
 }
 //-----------------------------------------------------------------------
+void SvgLoader::SvgLoaderPath::appendPoints(const Shape& piece)
+{
+	const std::vector<Vector2>& piecePoints = piece.getPointsReference();
+	if (piecePoints.empty()) return;
+	std::vector<Vector2>& points = shape.getPointsReference();
+	std::vector<Vector2>::const_iterator first = piecePoints.begin();
+	if (!points.empty() && *first == points.back())
+		++first;
+	points.insert(points.end(), first, piecePoints.end());
+}
+//-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseCurveSTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Vector2 offset = Vector2::ZERO;
 	if (rel) offset = point;
 
@@ -658,7 +855,7 @@ void SvgLoader::SvgLoaderPath::parseCurveSTo(bool rel, bool next)
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseCurveQTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Vector2 offset = Vector2::ZERO;
 	if (rel) offset = point;
 
@@ -681,7 +878,7 @@ void SvgLoader::SvgLoaderPath::parseCurveQTo(bool rel, bool next)
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseCurveTTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Vector2 offset = Vector2::ZERO;
 	if (rel) offset = point;
 
@@ -707,7 +904,7 @@ void SvgLoader::SvgLoaderPath::parseCurveTTo(bool rel, bool next)
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseCurveCTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Vector2 offset = Vector2::ZERO;
 	if (rel) offset = point;
 
@@ -737,19 +934,22 @@ void SvgLoader::SvgLoaderPath::parseCurveCTo(bool rel, bool next)
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseMoveTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Real x,y;
 	if (!parseReal(&x))
 		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseMoveTo");
 	if (!parseReal(&y))
 		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseMoveTo");
-	point = Vector2(x, y);
+	if (rel)
+		point = Vector2(point.x + x, point.y + y);
+	else
+		point = Vector2(x, y);
 	shape.addPoint(point);
 }
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseLineTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Real x = 0.0f;
 	if (!parseReal(&x))
 		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseLineTo");
@@ -765,7 +965,7 @@ void SvgLoader::SvgLoaderPath::parseLineTo(bool rel, bool next)
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseHLineTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Real x = 0.0f;
 	if (!parseReal(&x))
 		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseHLineTo");
@@ -778,7 +978,7 @@ void SvgLoader::SvgLoaderPath::parseHLineTo(bool rel, bool next)
 //-----------------------------------------------------------------------
 void SvgLoader::SvgLoaderPath::parseVLineTo(bool rel, bool next)
 {
-	if (next) index++;
+	if (next) mCursor++;
 	Real y = 0.0f;
 	if (!parseReal(&y))
 		OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Expecting a Real number", "parseVLineTo");
@@ -28,7 +28,9 @@ THE SOFTWARE.
 #include "ProceduralStableHeaders.h"
 #include "ProceduralShape.h"
 #include "ProceduralGeometryHelpers.h"
+#include "ProceduralPolylineResampler.h"
 #include "ProceduralPath.h"
+#include "ProceduralShapeOffsetter.h"
 #include "OgreSceneManager.h"
 #include "OgreRoot.h"
 
@@ -65,18 +67,31 @@ bool Shape::isOutsideRealOutside() const
 //-----------------------------------------------------------------------
 void Shape::_findAllIntersections(const Shape& other, std::vector<IntersectionInShape>& intersections) const
 {
-	for (unsigned short i=0; i<getSegCount(); i++)
+	// Only test segment pairs sharing a cell of a grid built over the other shape,
+	// in the same (i, j) order as an exhaustive search would
+	std::vector<Segment2D> otherSegments;
+	otherSegments.reserve(other.getSegCount());
+	for (size_t j=0; j<other.getSegCount(); j++)
+		otherSegments.push_back(Segment2D(other.getPoint(j), other.getPoint(j+1)));
+	SegmentGrid2D grid;
+	grid.build(otherSegments);
+
+	std::vector<size_t> candidates;
+	for (size_t i=0; i<getSegCount(); i++)
 	{
 		Segment2D seg1(getPoint(i), getPoint(i+1));
 
-		for (unsigned short j=0; j<other.getSegCount(); j++)
+		candidates.clear();
+		grid.query(seg1, candidates);
+		for (std::vector<size_t>::iterator it = candidates.begin(); it != candidates.end(); ++it)
 		{
-			Segment2D seg2(other.getPoint(j), other.getPoint(j+1));
+			size_t j = *it;
+			const Segment2D& seg2 = otherSegments[j];
 
 			Vector2 intersect;
 			if (seg1.findIntersect(seg2, intersect))
 			{
-				IntersectionInShape inter(i, j, intersect);
+				IntersectionInShape inter((unsigned int)i, (unsigned int)j, intersect);
 				// check if intersection is "borderline" : too near to a vertex
 				if (seg1.mA.squaredDistance(intersect)<1e-8)
 				{
@@ -468,36 +483,93 @@ void Shape::_appendToManualObject(ManualObject* manual) const
 //-----------------------------------------------------------------------
 MultiShape Shape::thicken(Real amount)
 {
-	if (!mClosed)
+	return ShapeOffsetter().thicken(*this, amount);
+}
+//-----------------------------------------------------------------------
+const std::vector<Real>& Shape::getLineicPositions() const
+{
+	if (mLengths.empty() && !mPoints.empty())
 	{
-		Shape s;
-		s.setOutSide(mOutSide);
-		for (unsigned int i=0; i<mPoints.size(); i++)
-			s.addPoint(mPoints[i]+amount*getAvgNormal(i));
-		for (int i=mPoints.size()-1; i>=0; i--)
-			s.addPoint(mPoints[i]-amount*getAvgNormal(i));
-		s.close();
-		return MultiShape().addShape(s);
+		size_t segCount = getSegCount();
+		mLengths.resize(segCount + 1);
+		mLengths[0] = 0;
+		for (size_t i = 0; i < segCount; ++i)
+			mLengths[i + 1] = mLengths[i] + (getPoint(i + 1) - getPoint(i)).length();
 	}
-	else
+	return mLengths;
+}
+//-----------------------------------------------------------------------
+Real Shape::getTotalLength() const
+{
+	if (mPoints.empty())
+		return 0;
+	return getLineicPositions().back();
+}
+//-----------------------------------------------------------------------
+Vector2 Shape::getPosition(Real coord) const
+{
+	if (mPoints.size() < 2)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "The shape must at least contain 2 points", "Procedural::Shape::getPosition(Ogre::Real)");
+	Real segmentCoord;
+	size_t i = Utils::findLineicSegment(getLineicPositions(), coord, mClosed, segmentCoord);
+	return getPosition(i, segmentCoord);
+}
+//-----------------------------------------------------------------------
+void Shape::getPositions(const std::vector<Real>& coords, std::vector<Vector2>& positions) const
+{
+	if (mPoints.size() < 2)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "The shape must at least contain 2 points", "Procedural::Shape::getPositions(const std::vector<Ogre::Real>&, std::vector<Ogre::Vector2>&)");
+	const std::vector<Real>& lengths = getLineicPositions();
+	positions.resize(coords.size());
+	for (size_t k = 0; k < coords.size(); ++k)
 	{
-		MultiShape ms;
-		Shape s1;
-		for (unsigned int i=0; i<mPoints.size(); i++)
-			s1.addPoint(mPoints[i]+amount*getAvgNormal(i));
-		s1.close();
-		s1.setOutSide(mOutSide);
-		ms.addShape(s1);
-		Shape s2;
-		for (unsigned int i=0; i<mPoints.size(); i++)
-			s2.addPoint(mPoints[i]-amount*getAvgNormal(i));
-		s2.close();
-		s2.setOutSide(mOutSide==SIDE_LEFT?SIDE_RIGHT:SIDE_LEFT);
-		ms.addShape(s2);
-		return ms;
+		Real segmentCoord;
+		size_t i = Utils::findLineicSegment(lengths, coords[k], mClosed, segmentCoord);
+		const Vector2& A = mPoints[i];
+		const Vector2& B = getPoint(i + 1);
+		positions[k] = A + segmentCoord * (B - A);
 	}
 }
 //-----------------------------------------------------------------------
+Shape& Shape::simplify(Real tolerance, SimplificationMethod method)
+{
+	std::vector<char> keep;
+	PolylineSimplifier::simplify(mPoints, mClosed, tolerance, method, keep);
+	size_t count = 0;
+	for (size_t i = 0; i < mPoints.size(); ++i)
+		if (keep[i])
+			mPoints[count++] = mPoints[i];
+	mPoints.resize(count);
+	mLengths.clear();
+	return *this;
+}
+//-----------------------------------------------------------------------
+Shape Shape::resample(Real step, std::vector<Real>* lineicPositions) const
+{
+	if (step <= 0)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Step must be strictly positive", "Procedural::Shape::resample(Ogre::Real, std::vector<Ogre::Real>*)");
+	if (mPoints.size() < 2)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "Cannot resample a shape with less than 2 points", "Procedural::Shape::resample(Ogre::Real, std::vector<Ogre::Real>*)");
+	Shape result;
+	PolylineResampler::resample(mPoints, mClosed, getLineicPositions(), step, result.mPoints, lineicPositions);
+	result.mClosed = mClosed;
+	result.setOutSide(mOutSide);
+	return result;
+}
+//-----------------------------------------------------------------------
+Shape Shape::resampleAdaptive(Real maxStep, Radian angleTolerance, std::vector<Real>* lineicPositions) const
+{
+	if (maxStep <= 0 || angleTolerance.valueRadians() <= 0)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "Step and angle tolerance must be strictly positive", "Procedural::Shape::resampleAdaptive(Ogre::Real, Ogre::Radian, std::vector<Ogre::Real>*)");
+	if (mPoints.size() < 2)
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "Cannot resample a shape with less than 2 points", "Procedural::Shape::resampleAdaptive(Ogre::Real, Ogre::Radian, std::vector<Ogre::Real>*)");
+	Shape result;
+	PolylineResampler::resampleAdaptive(mPoints, mClosed, getLineicPositions(), maxStep, angleTolerance, result.mPoints, lineicPositions);
+	result.mClosed = mClosed;
+	result.setOutSide(mOutSide);
+	return result;
+}
+//-----------------------------------------------------------------------
 Path Shape::convertToPath() const
 {
 	Path p;
@@ -537,7 +609,7 @@ Shape Shape::mergeKeysWithTrack(const Track& track) const
 	{
 		Real nextLineicPos = shapeLineicPos + (mPoints[i] - mPoints[i-1]).length();
 
-		std::map<Real,Real>::const_iterator it = track._getKeyValueAfter(lineicPos, lineicPos/totalLength, i-1);
+		Track::KeyFrameList::const_iterator it = track._getKeyValueAfter(lineicPos, lineicPos/totalLength, i-1);
 
 		Real nextTrackPos = it->first;
 		if (track.getAddressingMode() == Track::AM_RELATIVE_LINEIC)
@@ -0,0 +1,457 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#include "ProceduralStableHeaders.h"
+#include "ProceduralShapeClipper.h"
+#include "ProceduralGeometryHelpers.h"
+
+using namespace Ogre;
+
+namespace Procedural
+{
+//-----------------------------------------------------------------------
+namespace
+{
+/// Edge of the arrangement, going from its lowest vertex (by y, then by x) to its highest one
+struct ArrangementEdge
+{
+	int mLow;
+	int mHigh;
+	/// Change of the winding number of each group when crossing the edge from its left to its right
+	int mDelta[2];
+	/// Winding number of each group on the right of the edge
+	int mWindRight[2];
+};
+
+/// State shared by the sweep line comparisons
+struct SweepContext
+{
+	const std::vector<Vector2>* mPoints;
+	const std::vector<ArrangementEdge>* mEdges;
+	/// Current position of the sweep line
+	Real mY;
+	/// Abscissa of the probe, which is represented by edge index -1
+	Real mProbeX;
+
+	Real x(int e) const
+	{
+		if (e == -1)
+			return mProbeX;
+		const Vector2& low = (*mPoints)[(*mEdges)[e].mLow];
+		const Vector2& high = (*mPoints)[(*mEdges)[e].mHigh];
+		if (mY == high.y)
+			return high.x;
+		return low.x + (mY - low.y) * (high.x - low.x) / (high.y - low.y);
+	}
+};
+
+/// Orders the edges crossing the sweep line from left to right, then by direction just above the line
+struct SweepOrder
+{
+	const SweepContext* mContext;
+
+	SweepOrder(const SweepContext* context) : mContext(context) {}
+
+	bool operator()(int a, int b) const
+	{
+		Real xa = mContext->x(a);
+		Real xb = mContext->x(b);
+		if (xa != xb)
+			return xa < xb;
+		if (a != -1 && b != -1)
+		{
+			const std::vector<Vector2>& points = *mContext->mPoints;
+			const ArrangementEdge& ea = (*mContext->mEdges)[a];
+			const ArrangementEdge& eb = (*mContext->mEdges)[b];
+			Vector2 da = points[ea.mHigh] - points[ea.mLow];
+			Vector2 db = points[eb.mHigh] - points[eb.mLow];
+			Real ca = da.x * db.y;
+			Real cb = db.x * da.y;
+			if (ca != cb)
+				return ca < cb;
+		}
+		return a < b;
+	}
+};
+
+inline bool _isLower(const Vector2& a, const Vector2& b)
+{
+	return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
+/// Tells whether p, which lies on the line through a and b, is strictly between them
+inline bool _isStrictlyBetween(const Vector2& p, const Vector2& a, const Vector2& b)
+{
+	return (p - a).dotProduct(b - a) > 0 && (p - b).dotProduct(a - b) > 0;
+}
+
+/// Orders the points of a segment by their position along it
+struct AlongSegment
+{
+	Vector2 mOrigin;
+	Vector2 mDirection;
+
+	AlongSegment(const Vector2& origin, const Vector2& direction) : mOrigin(origin), mDirection(direction) {}
+
+	bool operator()(const Vector2& a, const Vector2& b) const
+	{
+		return (a - mOrigin).dotProduct(mDirection) < (b - mOrigin).dotProduct(mDirection);
+	}
+};
+
+/// Orders edges by the y of one of their vertices
+struct EdgeByVertexY
+{
+	const std::vector<Vector2>* mPoints;
+	const std::vector<ArrangementEdge>* mEdges;
+	bool mUseHigh;
+
+	EdgeByVertexY(const std::vector<Vector2>* points, const std::vector<ArrangementEdge>* edges, bool useHigh) :
+		mPoints(points), mEdges(edges), mUseHigh(useHigh) {}
+
+	Real y(int e) const
+	{
+		const ArrangementEdge& edge = (*mEdges)[e];
+		return (*mPoints)[mUseHigh ? edge.mHigh : edge.mLow].y;
+	}
+
+	bool operator()(int a, int b) const
+	{
+		return y(a) < y(b);
+	}
+};
+}
+//-----------------------------------------------------------------------
+void ShapeClipper::_addShape(int group, const Shape& shape)
+{
+	if (!shape.isClosed())
+		OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "All shapes must be closed", "Procedural::ShapeClipper::_addShape(int, const Procedural::Shape&)");
+	mShapes[group].push_back(shape);
+}
+//-----------------------------------------------------------------------
+bool ShapeClipper::_isFilled(int winding) const
+{
+	switch (mFillRule)
+	{
+	case FR_EVEN_ODD:
+		return (winding % 2) != 0;
+	case FR_POSITIVE:
+		return winding > 0;
+	case FR_NEGATIVE:
+		return winding < 0;
+	default:
+		return winding != 0;
+	}
+}
+//-----------------------------------------------------------------------
+MultiShape ShapeClipper::execute(ClipOperation operation) const
+{
+	// Gather the input edges, oriented so that the filled side of each shape is on their left
+	std::vector<Segment2D> segments;
+	std::vector<int> groups;
+	Vector2 boxMin(std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max());
+	Vector2 boxMax = -boxMin;
+	for (int g = 0; g < 2; ++g)
+		for (size_t s = 0; s < mShapes[g].size(); ++s)
+		{
+			const std::vector<Vector2>& points = mShapes[g][s].getPointsReference();
+			bool reverse = mShapes[g][s].getOutSide() == SIDE_LEFT;
+			for (size_t i = 0; i < points.size(); ++i)
+			{
+				const Vector2& a = points[i];
+				const Vector2& b = points[(i + 1) % points.size()];
+				if (a == b)
+					continue;
+				segments.push_back(reverse ? Segment2D(b, a) : Segment2D(a, b));
+				groups.push_back(g);
+				boxMin.makeFloor(a);
+				boxMax.makeCeil(a);
+			}
+		}
+	MultiShape result;
+	if (segments.empty())
+		return result;
+
+	// Split edges at their mutual intersections, touching points and overlaps
+	std::vector<std::vector<Vector2> > cuts(segments.size());
+	SegmentGrid2D grid;
+	grid.build(segments);
+	std::vector<size_t> candidates;
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		const Vector2& a1 = segments[i].mA;
+		const Vector2& b1 = segments[i].mB;
+		candidates.clear();
+		grid.query(segments[i], candidates);
+		for (size_t k = 0; k < candidates.size(); ++k)
+		{
+			size_t j = candidates[k];
+			if (j <= i)
+				continue;
+			const Vector2& a2 = segments[j].mA;
+			const Vector2& b2 = segments[j].mB;
+			double o1 = Predicates::orient2D(a1, b1, a2);
+			double o2 = Predicates::orient2D(a1, b1, b2);
+			double o3 = Predicates::orient2D(a2, b2, a1);
+			double o4 = Predicates::orient2D(a2, b2, b1);
+			if (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0)))
+			{
+				Vector2 intersection = a2 + (b2 - a2) * (Real)(o1 / (o1 - o2));
+				cuts[i].push_back(intersection);
+				cuts[j].push_back(intersection);
+				continue;
+			}
+			// Touching or overlapping segments : split each one at the other's endpoints
+			if (o1 == 0 && _isStrictlyBetween(a2, a1, b1))
+				cuts[i].push_back(a2);
+			if (o2 == 0 && _isStrictlyBetween(b2, a1, b1))
+				cuts[i].push_back(b2);
+			if (o3 == 0 && _isStrictlyBetween(a1, a2, b2))
+				cuts[j].push_back(a1);
+			if (o4 == 0 && _isStrictlyBetween(b1, a2, b2))
+				cuts[j].push_back(b1);
+		}
+	}
+
+	// Weld the split points and merge identical sub-edges, summing their winding changes
+	Real extent = std::max(boxMax.x - boxMin.x, boxMax.y - boxMin.y);
+	Vector2Welder welder(std::max(extent * 1e-6f, std::numeric_limits<Real>::min() * 1e6f));
+	welder.reserve(segments.size() * 2);
+	std::vector<ArrangementEdge> edges;
+	edges.reserve(segments.size());
+	IndexHashMap edgeIds(segments.size());
+	std::vector<int> chain;
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		const Vector2& a = segments[i].mA;
+		const Vector2& b = segments[i].mB;
+		std::sort(cuts[i].begin(), cuts[i].end(), AlongSegment(a, b - a));
+		chain.clear();
+		chain.push_back(welder.weld(a));
+		for (size_t k = 0; k < cuts[i].size(); ++k)
+			chain.push_back(welder.weld(cuts[i][k]));
+		chain.push_back(welder.weld(b));
+		for (size_t k = 0; k + 1 < chain.size(); ++k)
+		{
+			int from = chain[k];
+			int to = chain[k + 1];
+			if (from == to)
+				continue;
+			bool forward = _isLower(welder.getPoint(from), welder.getPoint(to));
+			uint64 key = IndexHashMap::pairKey(from, to);
+			int id = edgeIds.find(key);
+			if (id == -1)
+			{
+				id = (int)edges.size();
+				ArrangementEdge edge;
+				edge.mLow = forward ? from : to;
+				edge.mHigh = forward ? to : from;
+				edge.mDelta[0] = edge.mDelta[1] = 0;
+				edge.mWindRight[0] = edge.mWindRight[1] = 0;
+				edges.push_back(edge);
+				edgeIds.insert(key, id);
+			}
+			edges[id].mDelta[groups[i]] += forward ? -1 : 1;
+		}
+	}
+	std::vector<Vector2> points(welder.size());
+	for (size_t i = 0; i < points.size(); ++i)
+		points[i] = welder.getPoint((int)i);
+
+	// Sweep the arrangement from bottom to top to get the winding numbers on both sides of each edge
+	std::vector<int> rising, falling, horizontal;
+	for (size_t e = 0; e < edges.size(); ++e)
+	{
+		if (edges[e].mDelta[0] == 0 && edges[e].mDelta[1] == 0)
+			continue;
+		if (points[edges[e].mLow].y == points[edges[e].mHigh].y)
+			horizontal.push_back((int)e);
+		else
+		{
+			rising.push_back((int)e);
+			falling.push_back((int)e);
+		}
+	}
+	std::sort(rising.begin(), rising.end(), EdgeByVertexY(&points, &edges, false));
+	std::sort(horizontal.begin(), horizontal.end(), EdgeByVertexY(&points, &edges, false));
+	std::sort(falling.begin(), falling.end(), EdgeByVertexY(&points, &edges, true));
+
+	SweepContext context;
+	context.mPoints = &points;
+	context.mEdges = &edges;
+	context.mY = 0;
+	context.mProbeX = 0;
+	typedef std::set<int, SweepOrder> SweepStatus;
+	SweepStatus status = SweepStatus(SweepOrder(&context));
+	std::vector<SweepStatus::iterator> positions(edges.size(), status.end());
+	std::vector<int> inserted;
+	size_t r = 0, f = 0, h = 0;
+	while (r < rising.size() || h < horizontal.size())
+	{
+		Real y = std::numeric_limits<Real>::max();
+		if (r < rising.size())
+			y = points[edges[rising[r]].mLow].y;
+		if (h < horizontal.size())
+			y = std::min(y, points[edges[horizontal[h]].mLow].y);
+		if (f < falling.size())
+			y = std::min(y, points[edges[falling[f]].mHigh].y);
+		context.mY = y;
+
+		// Horizontal edges take the winding just below them from the edge on their left
+		for (; h < horizontal.size() && points[edges[horizontal[h]].mLow].y == y; ++h)
+		{
+			ArrangementEdge& edge = edges[horizontal[h]];
+			context.mProbeX = (points[edge.mLow].x + points[edge.mHigh].x) * .5f;
+			SweepStatus::iterator it = status.lower_bound(-1);
+			int below[2] = {0, 0};
+			if (it != status.begin())
+			{
+				--it;
+				below[0] = edges[*it].mWindRight[0];
+				below[1] = edges[*it].mWindRight[1];
+			}
+			edge.mWindRight[0] = below[0];
+			edge.mWindRight[1] = below[1];
+		}
+
+		for (; f < falling.size() && points[edges[falling[f]].mHigh].y == y; ++f)
+			status.erase(positions[falling[f]]);
+
+		// New edges take the winding on their left from their neighbour, from left to right
+		inserted.clear();
+		for (; r < rising.size() && points[edges[rising[r]].mLow].y == y; ++r)
+		{
+			positions[rising[r]] = status.insert(rising[r]).first;
+			inserted.push_back(rising[r]);
+		}
+		std::sort(inserted.begin(), inserted.end(), SweepOrder(&context));
+		for (size_t k = 0; k < inserted.size(); ++k)
+		{
+			ArrangementEdge& edge = edges[inserted[k]];
+			SweepStatus::iterator it = positions[inserted[k]];
+			int left[2] = {0, 0};
+			if (it != status.begin())
+			{
+				--it;
+				left[0] = edges[*it].mWindRight[0];
+				left[1] = edges[*it].mWindRight[1];
+			}
+			edge.mWindRight[0] = left[0] + edge.mDelta[0];
+			edge.mWindRight[1] = left[1] + edge.mDelta[1];
+		}
+	}
+
+	// Keep the edges separating the result from the rest, oriented so that the result is on their left
+	std::vector<int> from, to;
+	std::vector<std::vector<int> > outgoing(points.size());
+	for (size_t e = 0; e < edges.size(); ++e)
+	{
+		const ArrangementEdge& edge = edges[e];
+		if (edge.mDelta[0] == 0 && edge.mDelta[1] == 0)
+			continue;
+		bool inside[2];
+		for (int side = 0; side < 2; ++side)
+		{
+			bool inSubject = _isFilled(edge.mWindRight[0] - (side == 0 ? edge.mDelta[0] : 0));
+			bool inClip = _isFilled(edge.mWindRight[1] - (side == 0 ? edge.mDelta[1] : 0));
+			switch (operation)
+			{
+			case CO_UNION:
+				inside[side] = inSubject || inClip;
+				break;
+			case CO_INTERSECTION:
+				inside[side] = inSubject && inClip;
+				break;
+			case CO_DIFFERENCE:
+				inside[side] = inSubject && !inClip;
+				break;
+			default:
+				inside[side] = inSubject != inClip;
+			}
+		}
+		if (inside[0] == inside[1])
+			continue;
+		outgoing[inside[0] ? edge.mLow : edge.mHigh].push_back((int)from.size());
+		from.push_back(inside[0] ? edge.mLow : edge.mHigh);
+		to.push_back(inside[0] ? edge.mHigh : edge.mLow);
+	}
+
+	// Link boundary edges into contours, always turning as much to the left as possible
+	// so that contours touching at a vertex are kept apart
+	std::vector<bool> used(from.size(), false);
+	std::vector<Vector2> contour, simplified;
+	for (size_t first = 0; first < from.size(); ++first)
+	{
+		if (used[first])
+			continue;
+		contour.clear();
+		int current = (int)first;
+		while (current != -1)
+		{
+			used[current] = true;
+			contour.push_back(points[from[current]]);
+			int vertex = to[current];
+			if (vertex == from[first])
+				break;
+			Vector2 incoming = points[vertex] - points[from[current]];
+			int next = -1;
+			Real bestAngle = 0;
+			for (size_t k = 0; k < outgoing[vertex].size(); ++k)
+			{
+				int candidate = outgoing[vertex][k];
+				if (used[candidate])
+					continue;
+				Vector2 direction = points[to[candidate]] - points[vertex];
+				Real angle = Math::ATan2(incoming.crossProduct(direction), incoming.dotProduct(direction)).valueRadians();
+				if (next == -1 || angle > bestAngle)
+				{
+					next = candidate;
+					bestAngle = angle;
+				}
+			}
+			current = next;
+		}
+
+		// Remove the points lying in the middle of straight lines
+		simplified.clear();
+		for (size_t i = 0; i < contour.size(); ++i)
+		{
+			const Vector2& previous = simplified.empty() ? contour.back() : simplified.back();
+			if (Predicates::orient2D(previous, contour[i], contour[(i + 1) % contour.size()]) != 0)
+				simplified.push_back(contour[i]);
+		}
+		if (simplified.size() < 3)
+			continue;
+		Shape shape;
+		for (size_t i = 0; i < simplified.size(); ++i)
+			shape.addPoint(simplified[i]);
+		shape.close();
+		result.addShape(shape);
+	}
+	return result;
+}
+}
@@ -39,6 +39,9 @@ Shape CubicHermiteSpline2::realizeShape()
 	Shape shape;
 
 	unsigned int numPoints = mClosed ? mPoints.size() : (mPoints.size() - 1);
+	SplineBasisTable basis(mNumSeg);
+	if (mTolerance <= 0)
+		shape.getPointsReference().reserve(numPoints * mNumSeg + 1);
 	//Precompute tangents
 	for (unsigned int i = 0; i < mPoints.size(); ++i)
 		computeTangents<Vector2>(mPoints[i], safeGetPoint(i-1).position, safeGetPoint(i+1).position);
@@ -48,7 +51,7 @@ Shape CubicHermiteSpline2::realizeShape()
 		const ControlPoint& pointBefore = mPoints[i];
 		const ControlPoint& pointAfter = safeGetPoint(i+1);
 
-		computeCubicHermitePoints(pointBefore, pointAfter, mNumSeg, shape.getPointsReference());
+		computeCubicHermitePoints(pointBefore, pointAfter, basis, shape.getPointsReference(), mTolerance, mAngleTolerance);
 
 		if (i == mPoints.size() - 2 && !mClosed)
 		{
@@ -67,6 +70,9 @@ Shape CatmullRomSpline2::realizeShape()
 	Shape shape;
 
 	unsigned int numPoints = mClosed ? mPoints.size() : (mPoints.size() - 1);
+	SplineBasisTable basis(mNumSeg);
+	if (mTolerance <= 0)
+		shape.getPointsReference().reserve(numPoints * mNumSeg + 1);
 	for (unsigned int i = 0; i < numPoints; ++i)
 	{
 		const Vector2& P1 = safeGetPoint(i-1);
@@ -74,7 +80,7 @@ Shape CatmullRomSpline2::realizeShape()
 		const Vector2& P3 = safeGetPoint(i+1);
 		const Vector2& P4 = safeGetPoint(i+2);
 
-		computeCatmullRomPoints(P1, P2, P3, P4, mNumSeg, shape.getPointsReference());
+		computeCatmullRomPoints(P1, P2, P3, P4, basis, shape.getPointsReference(), mTolerance, mAngleTolerance);
 
 		if (i == mPoints.size() - 2 && !mClosed)
 		{
@@ -94,6 +100,9 @@ Shape KochanekBartelsSpline2::realizeShape()
 	Shape shape;
 
 	unsigned int numPoints = mClosed ? mPoints.size() : (mPoints.size() - 1);
+	SplineBasisTable basis(mNumSeg);
+	if (mTolerance <= 0)
+		shape.getPointsReference().reserve(numPoints * mNumSeg + 1);
 	for (unsigned int i = 0; i < numPoints; ++i)
 	{
 		const ControlPoint& P1 = safeGetPoint(i-1);
@@ -101,7 +110,7 @@ Shape KochanekBartelsSpline2::realizeShape()
 		const ControlPoint& P3 = safeGetPoint(i+1);
 		const ControlPoint& P4 = safeGetPoint(i+2);
 
-		computeKochanekBartelsPoints(P1, P2, P3, P4, mNumSeg, shape.getPointsReference());
+		computeKochanekBartelsPoints(P1, P2, P3, P4, basis, shape.getPointsReference(), mTolerance, mAngleTolerance);
 
 		if (i == mPoints.size() - 2 && !mClosed)
 		{
@@ -151,9 +160,10 @@ Shape RoundedCornerSpline2::realizeShape()
 		if (vradBegin.crossProduct(vradEnd)<0)
 			angleTotal = -angleTotal;
 
-		for (unsigned int j=0; j<=mNumSeg; j++)
+		unsigned int numSeg = Utils::computeArcSegmentCount(vradBegin.length(), angleTotal, mNumSeg, mTolerance, mAngleTolerance);
+		for (unsigned int j=0; j<=numSeg; j++)
 		{
-			Vector2 deltaVector = Utils::rotateVector2(vradBegin, (Real)j * angleTotal / (Real)mNumSeg);
+			Vector2 deltaVector = Utils::rotateVector2(vradBegin, (Real)j * angleTotal / (Real)numSeg);
 			shape.addPoint(center + deltaVector);
 		}
 	}
@@ -174,50 +184,24 @@ Shape BezierCurve2::realizeShape()
 	if (mPoints.size() < 2)
 		OGRE_EXCEPT(Ogre::Exception::ERR_INVALID_STATE, "The curve must at least contain 2 points", "Procedural::BezierCurve2::realizePath()");
 
-	unsigned int* coef = new unsigned int[mPoints.size()];
-	if (mPoints.size() == 2)
-	{
-		coef[0] = 1;
-		coef[1] = 1;
-	}
-	else if (mPoints.size() == 3)
-	{
-		coef[0] = 1;
-		coef[1] = 2;
-		coef[2] = 1;
-	}
-	else if (mPoints.size() == 4)
-	{
-		coef[0] = 1;
-		coef[1] = 3;
-		coef[2] = 3;
-		coef[3] = 1;
-	}
-	else
+	BezierCurve<Vector2> curve(mPoints);
+	Shape shape;
+	if (mTolerance > 0)
 	{
-		for (unsigned int i = 0; i < mPoints.size(); i++)
-			coef[i] = Utils::binom(mPoints.size() - 1, i);
+		computeCurvePoints(curve, mNumSeg, mTolerance, mAngleTolerance, shape.getPointsReference());
+		shape.addPoint(mPoints.back());
+		return shape;
 	}
 
 	unsigned int div = (mPoints.size() - 1) * mNumSeg + 1;
 	Ogre::Real dt = 1.0f / (Ogre::Real)div;
 
-	Shape shape;
 	Ogre::Real t = 0.0f;
 	while (t < 1.0f)
 	{
-		Ogre::Real x = 0.0f;
-		Ogre::Real y = 0.0f;
-		for (int i = 0; i < (int)mPoints.size(); i++)
-		{
-			Ogre::Real fac = coef[i] * pow(t, i) * pow(1.0f - t, (int)mPoints.size() - 1 - i);
-			x += fac * mPoints[i].x;
-			y += fac * mPoints[i].y;
-		}
-		shape.addPoint(x, y);
+		shape.addPoint(curve(t));
 		t += dt;
 	}
-	delete coef;
 
 	return shape;
 }
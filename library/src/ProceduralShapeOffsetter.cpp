@@ -0,0 +1,243 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of ogre-procedural
+
+For the latest info, see http://code.google.com/p/ogre-procedural/
+
+Copyright (c) 2010-2013 Michael Broutin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+ */
+#include "ProceduralStableHeaders.h"
+#include "ProceduralShapeOffsetter.h"
+#include "ProceduralShapeClipper.h"
+
+using namespace Ogre;
+
+namespace Procedural
+{
+//-----------------------------------------------------------------------
+namespace
+{
+/// Copies the points of a shape without consecutive duplicates, optionally in reverse order
+void _getContour(const Shape& shape, bool reverse, std::vector<Vector2>& result)
+{
+	const std::vector<Vector2>& points = shape.getPointsReference();
+	result.clear();
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		const Vector2& p = points[reverse ? points.size() - 1 - i : i];
+		if (result.empty() || result.back() != p)
+			result.push_back(p);
+	}
+	if (shape.isClosed() && result.size() > 1 && result.front() == result.back())
+		result.pop_back();
+}
+
+/// Gets the unit normal on the right of the direction from a to b
+inline Vector2 _rightNormal(const Vector2& a, const Vector2& b)
+{
+	Vector2 d = (b - a).normalisedCopy();
+	return Vector2(d.y, -d.x);
+}
+}
+//-----------------------------------------------------------------------
+void ShapeOffsetter::_addJoin(const Vector2& point, const Vector2& normal1, const Vector2& normal2, Real delta, bool cap, std::vector<Vector2>& result) const
+{
+	// Normals pointing to the offset side, which is on the right of the contour for positive deltas
+	Real radius = Math::Abs(delta);
+	Vector2 n1 = delta > 0 ? normal1 : -normal1;
+	Vector2 n2 = delta > 0 ? normal2 : -normal2;
+	Real cross = normal1.crossProduct(normal2);
+	Real dot = normal1.dotProduct(normal2);
+
+	if (cap && mJoinType == JT_MITER)
+	{
+		result.push_back(point + n1 * radius);
+		result.push_back(point + n2 * radius);
+		return;
+	}
+	if (!cap)
+	{
+		// Almost straight
+		if (dot > 0 && Math::Abs(cross) < 1e-4f)
+		{
+			result.push_back(point + (n1 + n2) * (radius / (1 + dot)));
+			return;
+		}
+		// Concave corner : going through the original point makes the loop between both offset edges
+		// wind the same way as the rest of the outline, so the final union removes it
+		if (cross * delta < 0)
+		{
+			result.push_back(point + n1 * radius);
+			result.push_back(point);
+			result.push_back(point + n2 * radius);
+			return;
+		}
+	}
+
+	JoinType joinType = mJoinType;
+	if (joinType == JT_MITER)
+	{
+		if (!cap && 1 + dot >= 2 / (mMiterLimit * mMiterLimit))
+		{
+			result.push_back(point + (n1 + n2) * (radius / (1 + dot)));
+			return;
+		}
+		joinType = JT_SQUARE;
+	}
+	if (joinType == JT_SQUARE)
+	{
+		// Cut the corner by a line perpendicular to the bisector, at the offset distance
+		Vector2 bisector = n1 + n2;
+		if (bisector.squaredLength() < 1e-12f)
+			bisector = Vector2(-normal1.y, normal1.x);
+		bisector.normalise();
+		Vector2 corner = point + bisector * radius;
+		Vector2 tangent(-bisector.y, bisector.x);
+		Real d1 = tangent.dotProduct(n1);
+		Real d2 = tangent.dotProduct(n2);
+		Real t1 = Math::Abs(d1) > 1e-6f ? radius * (1 - bisector.dotProduct(n1)) / d1 : 0;
+		Real t2 = Math::Abs(d2) > 1e-6f ? radius * (1 - bisector.dotProduct(n2)) / d2 : 0;
+		result.push_back(corner + tangent * t1);
+		result.push_back(corner + tangent * t2);
+		return;
+	}
+
+	// Round join : the arc turns left around the corner for positive deltas, right for negative ones
+	Real angle = Math::ATan2(cross, dot).valueRadians();
+	if (delta > 0 && angle <= 0)
+		angle += Math::TWO_PI;
+	else if (delta < 0 && angle >= 0)
+		angle -= Math::TWO_PI;
+	Real step = Math::PI * .5f;
+	if (mTolerance < radius)
+		step = std::min(step, 2 * Math::ACos(1 - mTolerance / radius).valueRadians());
+	int stepCount = std::max(1, (int)Math::Ceil(Math::Abs(angle) / step));
+	Real c = Math::Cos(angle / stepCount);
+	Real s = Math::Sin(angle / stepCount);
+	Vector2 v = n1;
+	for (int i = 0; i <= stepCount; ++i)
+	{
+		result.push_back(point + v * radius);
+		v = Vector2(v.x * c - v.y * s, v.x * s + v.y * c);
+	}
+}
+//-----------------------------------------------------------------------
+void ShapeOffsetter::_offsetContour(const std::vector<Vector2>& points, bool open, Real delta, std::vector<Vector2>& result) const
+{
+	result.clear();
+	if (points.size() < 2)
+		return;
+
+	// An open contour is offset as the closed contour going back and forth along it, with caps at both ends
+	std::vector<Vector2> loop(points);
+	size_t lastCap = 0;
+	if (open)
+	{
+		lastCap = points.size() - 1;
+		for (size_t i = points.size() - 2; i > 0; --i)
+			loop.push_back(points[i]);
+	}
+	size_t n = loop.size();
+	for (size_t i = 0; i < n; ++i)
+	{
+		const Vector2& previous = loop[(i + n - 1) % n];
+		const Vector2& next = loop[(i + 1) % n];
+		bool cap = open && (i == 0 || i == lastCap);
+		_addJoin(loop[i], _rightNormal(previous, loop[i]), _rightNormal(loop[i], next), delta, cap, result);
+	}
+}
+//-----------------------------------------------------------------------
+MultiShape ShapeOffsetter::_merge(const std::vector<std::vector<Vector2> >& contours) const
+{
+	ShapeClipper clipper;
+	clipper.setFillRule(ShapeClipper::FR_POSITIVE);
+	for (size_t i = 0; i < contours.size(); ++i)
+	{
+		if (contours[i].size() < 3)
+			continue;
+		Shape shape;
+		shape.getPointsReference() = contours[i];
+		shape.close();
+		clipper.addSubject(shape);
+	}
+	return clipper.execute(ShapeClipper::CO_UNION);
+}
+//-----------------------------------------------------------------------
+MultiShape ShapeOffsetter::offset(const MultiShape& shapes, Real delta) const
+{
+	for (unsigned int i = 0; i < shapes.getShapeCount(); ++i)
+		if (!shapes.getShape(i).isClosed())
+			OGRE_EXCEPT(Ogre::Exception::ERR_INVALIDPARAMS, "All shapes must be closed", "Procedural::ShapeOffsetter::offset(const Procedural::MultiShape&, Ogre::Real)");
+
+	// Contours are oriented with the inside on their left, so that the outside is on the right
+	int shapeCount = (int)shapes.getShapeCount();
+	std::vector<std::vector<Vector2> > contours(shapeCount);
+#ifdef PROCEDURAL_USE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		std::vector<Vector2> points;
+#ifdef PROCEDURAL_USE_OPENMP
+		#pragma omp for schedule(dynamic, 16)
+#endif
+		for (int i = 0; i < shapeCount; ++i)
+		{
+			const Shape& shape = shapes.getShape(i);
+			_getContour(shape, shape.getOutSide() == SIDE_LEFT, points);
+			_offsetContour(points, false, delta, contours[i]);
+		}
+	}
+	return _merge(contours);
+}
+//-----------------------------------------------------------------------
+MultiShape ShapeOffsetter::thicken(const MultiShape& shapes, Real amount) const
+{
+	Real radius = Math::Abs(amount);
+	if (radius == 0)
+		return MultiShape();
+
+	// Closed shapes are offset on both sides, the inner side being reversed so that it makes a hole
+	int shapeCount = (int)shapes.getShapeCount();
+	std::vector<std::vector<Vector2> > contours(2 * shapeCount);
+#ifdef PROCEDURAL_USE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		std::vector<Vector2> points;
+#ifdef PROCEDURAL_USE_OPENMP
+		#pragma omp for schedule(dynamic, 16)
+#endif
+		for (int i = 0; i < shapeCount; ++i)
+		{
+			const Shape& shape = shapes.getShape(i);
+			_getContour(shape, false, points);
+			_offsetContour(points, !shape.isClosed(), radius, contours[2 * i]);
+			if (shape.isClosed())
+			{
+				std::reverse(points.begin(), points.end());
+				_offsetContour(points, false, radius, contours[2 * i + 1]);
+			}
+		}
+	}
+	return _merge(contours);
+}
+}
@@ -35,6 +35,15 @@ namespace Procedural
 {
 void SphereGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 {
+	if (mChordError > 0)
+	{
+		SphereGenerator sphere(*this);
+		sphere.mChordError = 0;
+		sphere.mNumRings = _getArcSegmentCount(mRadius, Radian(Math::PI), 2);
+		sphere.mNumSegments = _getArcSegmentCount(mRadius, Radian(Math::TWO_PI), 3);
+		sphere.addToTriangleBuffer(buffer);
+		return;
+	}
 	buffer.rebaseOffset();
 	buffer.estimateVertexCount((mNumRings+1)*(mNumSegments+1));
 	buffer.estimateIndexCount(mNumRings*(mNumSegments+1)*6);
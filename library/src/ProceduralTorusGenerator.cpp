@@ -35,6 +35,15 @@ namespace Procedural
 {
 void TorusGenerator::addToTriangleBuffer(TriangleBuffer& buffer) const
 {
+	if (mChordError > 0)
+	{
+		TorusGenerator torus(*this);
+		torus.mChordError = 0;
+		torus.mNumSegSection = _getArcSegmentCount(mSectionRadius, Radian(Math::TWO_PI), 3);
+		torus.mNumSegCircle = _getArcSegmentCount(mRadius + mSectionRadius, Radian(Math::TWO_PI), 3);
+		torus.addToTriangleBuffer(buffer);
+		return;
+	}
 	buffer.rebaseOffset();
 	buffer.estimateVertexCount((mNumSegCircle+1)*(mNumSegSection+1));
 	buffer.estimateIndexCount((mNumSegCircle)*(mNumSegSection+1)*6);
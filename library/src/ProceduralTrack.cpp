@@ -32,41 +32,62 @@ using namespace Ogre;
 
 namespace Procedural
 {
-Real Track::getValue(Real pos) const
+namespace
+{
+struct KeyFrameBefore
 {
-	std::map<Real, Real>::const_iterator itAfter = _getKeyValueAfter(pos);
-	std::map<Real, Real>::const_iterator itBefore = _getKeyValueBefore(pos);
+	bool operator()(Real pos, const std::pair<Real, Real>& keyFrame) const
+	{
+		return pos < keyFrame.first;
+	}
+};
 
-	if (itAfter==itBefore)
-		return itBefore->second;
-	if (itAfter==mKeyFrames.begin())
-		return itAfter->second;
+/// Number of keys not greater than pos
+inline size_t _upperBound(const Track::KeyFrameList& keyFrames, Real pos)
+{
+	return std::upper_bound(keyFrames.begin(), keyFrames.end(), pos, KeyFrameBefore()) - keyFrames.begin();
+}
+}
+//-----------------------------------------------------------------------
+Real Track::_interpolate(Real pos, size_t upper) const
+{
+	if (upper == 0)
+		return mKeyFrames.front().second;
+	if (upper == mKeyFrames.size())
+		return mKeyFrames.back().second;
 
-	Real x1 = itBefore->first;
-	Real y1 = itBefore->second;
-	Real x2 = itAfter->first;
-	Real y2 = itAfter->second;
+	Real x1 = mKeyFrames[upper-1].first;
+	Real y1 = mKeyFrames[upper-1].second;
+	Real x2 = mKeyFrames[upper].first;
+	Real y2 = mKeyFrames[upper].second;
 	return (pos-x1)/(x2-x1)*(y2-y1)+y1;
 }
-
-std::map<Real, Real>::const_iterator Track::_getKeyValueBefore(Real pos) const
+//-----------------------------------------------------------------------
+Real Track::getValue(Real pos) const
 {
-	std::map<Real, Real>::const_iterator it = mKeyFrames.upper_bound(pos);
-	if (it==mKeyFrames.begin())
-		return it;
-	else
-		return --it;
+	return _interpolate(pos, _upperBound(mKeyFrames, pos));
 }
-
-std::map<Real, Real>::const_iterator Track::_getKeyValueAfter(Real pos) const
+//-----------------------------------------------------------------------
+void Track::getValues(const std::vector<Real>& positions, std::vector<Real>& values) const
 {
-	std::map<Real, Real>::const_iterator it = mKeyFrames.upper_bound(pos);
-	if (it==mKeyFrames.end())
-		return --it;
-	else
-		return it;
+	values.resize(positions.size());
+	Evaluator evaluator(*this);
+	for (size_t i = 0; i < positions.size(); ++i)
+		values[i] = evaluator.getValue(positions[i]);
 }
-
+//-----------------------------------------------------------------------
+Track::KeyFrameList::const_iterator Track::_getKeyValueBefore(Real pos) const
+{
+	size_t upper = _upperBound(mKeyFrames, pos);
+	return mKeyFrames.begin() + (upper == 0 ? 0 : upper - 1);
+}
+//-----------------------------------------------------------------------
+Track::KeyFrameList::const_iterator Track::_getKeyValueAfter(Real pos) const
+{
+	size_t upper = _upperBound(mKeyFrames, pos);
+	return mKeyFrames.begin() + (upper == mKeyFrames.size() ? upper - 1 : upper);
+}
+//-----------------------------------------------------------------------
 Real Track::getValue(Real absPos, Real relPos, unsigned int index) const
 {
 	if (mAddressingMode == AM_ABSOLUTE_LINEIC)
@@ -75,8 +96,8 @@ Real Track::getValue(Real absPos, Real relPos, unsigned int index) const
 		return getValue(relPos);
 	return getValue((Real)index);
 }
-
-std::map<Real, Real>::const_iterator Track::_getKeyValueBefore(Real absPos, Real relPos, unsigned int index) const
+//-----------------------------------------------------------------------
+Track::KeyFrameList::const_iterator Track::_getKeyValueBefore(Real absPos, Real relPos, unsigned int index) const
 {
 	if (mAddressingMode == AM_ABSOLUTE_LINEIC)
 		return _getKeyValueBefore(absPos);
@@ -84,8 +105,8 @@ std::map<Real, Real>::const_iterator Track::_getKeyValueBefore(Real absPos, Real
 		return _getKeyValueBefore(relPos);
 	return _getKeyValueBefore((Real)index);
 }
-
-std::map<Real, Real>::const_iterator Track::_getKeyValueAfter(Real absPos, Real relPos, unsigned int index) const
+//-----------------------------------------------------------------------
+Track::KeyFrameList::const_iterator Track::_getKeyValueAfter(Real absPos, Real relPos, unsigned int index) const
 {
 	if (mAddressingMode == AM_ABSOLUTE_LINEIC)
 		return _getKeyValueAfter(absPos);
@@ -93,5 +114,25 @@ std::map<Real, Real>::const_iterator Track::_getKeyValueAfter(Real absPos, Real
 		return _getKeyValueAfter(relPos);
 	return _getKeyValueAfter((Real)index);
 }
+//-----------------------------------------------------------------------
+Real Track::Evaluator::getValue(Real pos)
+{
+	const KeyFrameList& keyFrames = mTrack.mKeyFrames;
+	if (mUpper > 0 && keyFrames[mUpper-1].first > pos)
+		mUpper = _upperBound(keyFrames, pos);
+	else
+		while (mUpper < keyFrames.size() && keyFrames[mUpper].first <= pos)
+			++mUpper;
+	return mTrack._interpolate(pos, mUpper);
+}
+//-----------------------------------------------------------------------
+Real Track::Evaluator::getValue(Real absPos, Real relPos, unsigned int index)
+{
+	if (mTrack.mAddressingMode == AM_ABSOLUTE_LINEIC)
+		return getValue(absPos);
+	if (mTrack.mAddressingMode == AM_RELATIVE_LINEIC)
+		return getValue(relPos);
+	return getValue((Real)index);
+}
 
 }
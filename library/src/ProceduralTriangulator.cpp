@@ -79,17 +79,12 @@ bool Triangulator::Triangle::isPointInside(const Vector2& point)
 //-----------------------------------------------------------------------
 Triangulator::Triangle::InsideType Triangulator::Triangle::isPointInsideCircumcircle(const Vector2& pt)
 {
-	Vector2 v0=p(0);
-	Vector2 v1=p(1);
-	Vector2 v2=p(2);
-	Matrix4 m (v0.x, v0.y, v0.squaredLength(), 1.,
-	           v1.x, v1.y, v1.squaredLength(), 1.,
-	           v2.x, v2.y, v2.squaredLength(), 1.,
-	           pt.x, pt.y, pt.squaredLength(), 1.);
-	Real det = m.determinant();
+	double magnitude;
+	double det = Predicates::inCircle(p(0), p(1), p(2), pt, &magnitude);
 	if (det>=0)
 		return IT_INSIDE;
-	if (det>-1e-3)
+	// Points very close to the circle are double-checked by the caller, the tolerance being relative to the points' scale
+	if (det>-1e-4*magnitude)
 		return IT_BORDERLINEOUTSIDE;
 	return IT_OUTSIDE;
 }
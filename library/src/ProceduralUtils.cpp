@@ -61,4 +61,19 @@ Quaternion Utils::_computeQuaternion(const Ogre::Vector3& direction, const Ogre:
 	q.FromAxes( xVec, yVec, zVec);
 	return q;
 }
+//-----------------------------------------------------------------------
+size_t Utils::findLineicSegment(const std::vector<Real>& lineicPositions, Real coord, bool loop, Real& segmentCoord)
+{
+	Real totalLength = lineicPositions.back();
+	if (loop && totalLength > 0 && (coord < 0 || coord > totalLength))
+		coord -= Math::Floor(coord / totalLength) * totalLength;
+	coord = std::max((Real)0, std::min(coord, totalLength));
+
+	// First point whose position is not before coord, the segment ending there contains coord
+	std::vector<Real>::const_iterator it = std::lower_bound(lineicPositions.begin() + 1, lineicPositions.end() - 1, coord);
+	size_t i = it - lineicPositions.begin() - 1;
+	Real length = lineicPositions[i + 1] - lineicPositions[i];
+	segmentCoord = length > 0 ? std::min((Real)1, (coord - lineicPositions[i]) / length) : 0;
+	return i;
+}
 }
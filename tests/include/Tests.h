@@ -143,6 +143,34 @@ class Unit_Tests : public BaseApplication
 		}
 	};
 	/* --------------------------------------------------------------------------- */
+	class Test_CSGTree : public Unit_Test
+	{
+	public:
+		Test_CSGTree(SceneManager* sn) : Unit_Test(sn) {}
+
+		String getDescription()
+		{
+			return "CSG tree";
+		}
+
+		void initImpl()
+		{
+			CSGTree tree;
+			std::vector<int> operands;
+			operands.push_back(tree.addLeaf(BoxGenerator().setSize(Vector3(6,3,.5))));
+			for (int i=0; i<4; i++)
+				operands.push_back(tree.addLeaf(BoxGenerator().setSize(Vector3(.8,1,1)).setPosition(-2.1+1.4*i,.3,0)));
+			int wall = tree.addOperation(Boolean::BT_DIFFERENCE, operands);
+			int trim = tree.addLeaf(CylinderGenerator().setRadius(.4).setHeight(7).setOrientation(Quaternion(Degree(90), Vector3::UNIT_Z)).setPosition(3.5,1.5,0));
+			tree.setRoot(tree.addOperation(Boolean::BT_UNION, wall, trim));
+			putMesh(tree.realizeMesh(), 1);
+
+			// Only the modified window and its ancestors are recomputed
+			tree.setLeaf(operands[1], BoxGenerator().setSize(Vector3(.8,2,1)).setPosition(-2.1,0,0));
+			putMesh(tree.buildTriangleBuffer().translate(0,4,0).transformToMesh(Utils::getName()), 1);
+		}
+	};
+	/* --------------------------------------------------------------------------- */
 	class Test_Primitives : public Unit_Test
 	{
 	public: